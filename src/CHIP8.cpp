@@ -1,9 +1,14 @@
 #include "CHIP8.hpp"
 
+const int CHIP8::compiledBlockQueueSize;
+
 CHIP8::CHIP8(CHIP8_Mediator& Mediator)
-    : RAM(4096), V(16), STACK(stackSize), mediator(Mediator),
-        frameBuffer(CHIP8_CONSTANTS::frameHeight, std::vector<bool>(CHIP8_CONSTANTS::frameWidth, false)),
-        rng(std::chrono::high_resolution_clock::now().time_since_epoch().count())
+    : V(16), STACK(stackSize), mediator(Mediator),
+        frameBuffer(CHIP8_CONSTANTS::frameHeight, 0),
+        defaultRNG(std::chrono::high_resolution_clock::now().time_since_epoch().count()), rng(&defaultRNG),
+        tracer(nullptr), faultLog(&CHIP8_FaultLog::global()), displayWait(false),
+        timing(CHIP8_Timing::Instructions), instructionsPerFrame(defaultInstructionsPerFrame), engine(CHIP8_Engine::Interpreter),
+        blockCompiler(&CHIP8_BlockCompiler::global()), sequentialPC(0)
 {
     this->reset();
 }
@@ -29,14 +34,27 @@ bool CHIP8::loadMemoryImage(std::string filename)
     if(fileLengthInBytes + memoryImageOffset > RAM.size())
         return false;
 
-    memoryImageFile.read((char*)(RAM.data() + memoryImageOffset), fileLengthInBytes);
+    std::vector<uint8_t> image(fileLengthInBytes);
+    memoryImageFile.read((char*)image.data(), fileLengthInBytes);
     
+    return loadMemoryImage(image.data(), image.size());
+}
+
+bool CHIP8::loadMemoryImage(const uint8_t* image, std::size_t size)
+{
+    if(size + memoryImageOffset > RAM.size())
+        return false;
+
+    RAM.write(memoryImageOffset, image, size);
+    rehashMemory();
+    clearDecodeCaches();
+
     return true;
 }
 
 void CHIP8::reset()
 {
-    std::fill(RAM.begin(), RAM.end(), 0);
+    RAM.clear();
     std::fill(V.begin(), V.end(), 0);
     I = 0;
     PC = 0x200;
@@ -47,6 +65,15 @@ void CHIP8::reset()
     delayTimer = 0;
     soundTimer = 0;
 
+    cycleCount = 0;
+    reportedCycles = 0;
+    fault = CHIP8_Fault{ CHIP8_FaultKind::None, 0, 0, 0 };
+    std::fill(frameBuffer.begin(), frameBuffer.end(), 0);
+    dirtyRows = 0;
+
+    waitingForKey = false;
+    frameProgress = 0;
+
     std::vector<uint8_t> font = {
         0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
         0x20, 0x60, 0x20, 0x20, 0x70, // 1
@@ -66,49 +93,694 @@ void CHIP8::reset()
         0xF0, 0x80, 0xF0, 0x80, 0x80  // F
     };
     
-    std::copy(font.begin(), font.end(), RAM.begin());
+    RAM.write(0, font.data(), font.size());
+    rehashMemory();
+    clearDecodeCaches();
+}
+
+CHIP8_State CHIP8::saveState() const
+{
+    CHIP8_State state;
+    state.RAM = RAM;
+    state.V = V;
+    state.I = I;
+    state.PC = PC;
+    state.STACK = STACK;
+    state.SP = SP;
+    state.delayTimer = delayTimer;
+    state.soundTimer = soundTimer;
+    state.rngState = rng->getState();
+    state.frameBuffer = frameBuffer;
+    state.cycleCount = cycleCount;
+    state.fault = fault;
+    state.memoryHash = memoryHash;
+    return state;
+}
+
+void CHIP8::loadState(const CHIP8_State& state)
+{
+    restoreState(state);
+    publishFrame();
+}
+
+void CHIP8::restoreState(const CHIP8_State& state)
+{
+    RAM = state.RAM;
+    V = state.V;
+    I = state.I;
+    PC = state.PC;
+    STACK = state.STACK;
+    SP = state.SP;
+    delayTimer = state.delayTimer;
+    soundTimer = state.soundTimer;
+    rng->setState(state.rngState);
+    frameBuffer = state.frameBuffer;
+    cycleCount = state.cycleCount;
+    reportedCycles = cycleCount;
+    fault = state.fault;
+
+    waitingForKey = false;
+    frameProgress = 0;
+
+    memoryHash = state.memoryHash;
+    clearDecodeCaches();
+
+    dirtyRows = CHIP8_CONSTANTS::allRowsDirty;
+}
+
+void CHIP8::setRNG(CHIP8_RNG* RNG)
+{
+    rng = RNG != nullptr ? RNG : &defaultRNG;
+}
+
+void CHIP8::seedRNG(uint64_t seed)
+{
+    rng->seed(seed);
 }
 
 void CHIP8::run()
 {
+    if(timing == CHIP8_Timing::CosmacVIP)
+    {
+        runPaced();
+        return;
+    }
+
     std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
 
-    while(mediator.shouldCHIP8Stop() == false)
+    while(mediator.shouldCHIP8Stop() == false && hasFaulted() == false)
     {
-        if(PC < 0x200 || PC >= RAM.size())
-        {
-            std::cout << "TRIED TO ACCESS THE FORBIDDEN MEMORY!";
-            mediator.stopCHIP8();
-        }
-        else
-            clockCycle();
+        step();
+
+        if(waitingForKey)
+            mediator.waitForKeyPress();
         
         auto duration = std::chrono::high_resolution_clock::now() - start;
 
         if(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() 
                 >= CHIP8_CONSTANTS::timersTickDurationInMiliseconds)
         {
-            if(delayTimer)
-                delayTimer--;
+            tickTimers();
+            start = std::chrono::high_resolution_clock::now();
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+CHIP8_YieldReason CHIP8::runFrame()
+{
+    if(timing == CHIP8_Timing::CosmacVIP)
+        return runTimedFrame();
+
+    while(frameProgress < instructionsPerFrame)
+    {
+        if(hasFaulted())
+            return CHIP8_YieldReason::Fault;
+        if(mediator.shouldCHIP8Stop())
+            return CHIP8_YieldReason::Stopped;
+
+        const uint64_t optimized = executeOptimized(instructionsPerFrame - frameProgress);
+        if(optimized)
+        {
+            frameProgress += optimized;
+            continue;
+        }
+
+        step();
+
+        if(waitingForKey)
+            return CHIP8_YieldReason::KeyWait;
+
+        frameProgress++;
+    }
+
+    frameProgress = 0;
+    tickTimers();
+
+    return CHIP8_YieldReason::FrameEnd;
+}
+
+CHIP8_YieldReason CHIP8::runTimedFrame()
+{
+    while(frameProgress < CHIP8_TIMING::cyclesPerFrame)
+    {
+        if(hasFaulted())
+            return CHIP8_YieldReason::Fault;
+        if(mediator.shouldCHIP8Stop())
+            return CHIP8_YieldReason::Stopped;
+
+        const uint16_t previousPC = PC;
+        const uint16_t opcode = fetch(PC);
+
+        step();
+
+        if(waitingForKey)
+            return CHIP8_YieldReason::KeyWait;
+
+        frameProgress += CHIP8_TIMING::getCycleCost(opcode, previousPC, PC);
+
+        //the VIP interpreter waits for the display interrupt before it draws a sprite
+        if(displayWait && (opcode & 0xf000) == 0xd000)
+            frameProgress = std::max(frameProgress, (int)CHIP8_TIMING::cyclesPerFrame);
+    }
+
+    //cycles past the end of the frame are taken from the next one
+    frameProgress -= CHIP8_TIMING::cyclesPerFrame;
+    tickTimers();
+
+    return CHIP8_YieldReason::FrameEnd;
+}
+
+void CHIP8::setEngine(CHIP8_Engine Engine)
+{
+    engine = Engine;
+
+    if(engine == CHIP8_Engine::Fused)
+        fusionCache.resize(RAM.size());
+    else
+        std::vector<CHIP8_FusedInstruction>().swap(fusionCache);
+
+    if(engine == CHIP8_Engine::Tiered)
+    {
+        //a new queue, blocks still being compiled for an earlier one are dropped with it
+        compiledBlocks = std::make_shared<CHIP8_CompiledBlockQueue>(compiledBlockQueueSize);
+        blockCounters.resize(RAM.size());
+        blockTable.resize(RAM.size());
+        blockCoverage.resize(RAM.size());
+    }
+    else
+    {
+        compiledBlocks.reset();
+        std::vector<uint16_t>().swap(blockCounters);
+        std::vector<CHIP8_CompiledBlockPtr>().swap(blockTable);
+        std::vector<uint8_t>().swap(blockCoverage);
+    }
+
+    clearDecodeCaches();
+}
+
+CHIP8_Engine CHIP8::getEngine() const
+{
+    return engine;
+}
+
+void CHIP8::setBlockCompiler(CHIP8_BlockCompiler* BlockCompiler)
+{
+    blockCompiler = BlockCompiler != nullptr ? BlockCompiler : &CHIP8_BlockCompiler::global();
+
+    //the earlier compiler may still push to the old queue, each queue keeps a single producer
+    if(engine == CHIP8_Engine::Tiered)
+    {
+        compiledBlocks = std::make_shared<CHIP8_CompiledBlockQueue>(compiledBlockQueueSize);
+        std::fill(blockCounters.begin(), blockCounters.end(), 0);
+    }
+}
+
+std::size_t CHIP8::getCompiledBlockCount()
+{
+    if(compiledBlocks)
+        installCompiledBlocks();
+
+    return blockTable.size() - std::count(blockTable.begin(), blockTable.end(), nullptr);
+}
+
+uint16_t CHIP8::fetch(uint16_t address) const
+{
+    return (uint16_t(RAM[address]) << 8) | uint16_t(RAM[address + 1]);
+}
+
+CHIP8_FusedInstruction CHIP8::decodeFusion(uint16_t address) const
+{
+    CHIP8_FusedInstruction decoded = { CHIP8_Fusion::None, { 0, 0, 0, 0 } };
+
+    //every instruction of a sequence has to lie inside the program area
+    int length = 0;
+    while(length < 4 && CHIP8_Memory::canExecute(address + 2 * length))
+    {
+        decoded.opcodes[length] = fetch(address + 2 * length);
+        length++;
+    }
+
+    const uint16_t* op = decoded.opcodes;
+
+    if(length == 4 && (op[0] & 0xf000) == 0x6000 && (op[1] & 0xf000) == 0x6000
+        && (op[2] & 0xf000) == 0xa000 && (op[3] & 0xf000) == 0xd000)
+        decoded.fusion = CHIP8_Fusion::LoadLoadIndexDraw;
+    else if(length >= 3 && (op[0] & 0xf0ff) == 0xf007 && (op[1] & 0xf000) == 0x3000
+        && getX(op[1]) == getX(op[0]) && op[2] == (0x1000 | address))
+        decoded.fusion = CHIP8_Fusion::TimerPoll;
+    else if(length >= 2 && (op[0] & 0xf000) == 0x7000 && (op[1] & 0xf000) == 0x3000)
+        decoded.fusion = CHIP8_Fusion::AddSkipEqual;
+    else if(length >= 2 && (op[0] & 0xf000) == 0x7000 && (op[1] & 0xf000) == 0x4000)
+        decoded.fusion = CHIP8_Fusion::AddSkipNotEqual;
+
+    return decoded;
+}
+
+void CHIP8::clearDecodeCaches()
+{
+    const CHIP8_FusedInstruction unknown = { CHIP8_Fusion::Unknown, { 0, 0, 0, 0 } };
+    std::fill(fusionCache.begin(), fusionCache.end(), unknown);
+
+    std::fill(blockCounters.begin(), blockCounters.end(), 0);
+    std::fill(blockTable.begin(), blockTable.end(), nullptr);
+    std::fill(blockCoverage.begin(), blockCoverage.end(), 0);
+    sequentialPC = 0;
+}
+
+uint64_t CHIP8::executeOptimized(uint64_t budget)
+{
+    //a tracer has to see every instruction on its own
+    if(tracer)
+        return 0;
+
+    switch(engine)
+    {
+        case CHIP8_Engine::Fused:
+            return executeFused(budget);
+        case CHIP8_Engine::Tiered:
+            return executeTiered(budget);
+        default:
+            return 0;
+    }
+}
+
+uint64_t CHIP8::executeFused(uint64_t budget)
+{
+    if(CHIP8_Memory::canExecute(PC) == false)
+        return 0;
+
+    CHIP8_FusedInstruction& decoded = fusionCache[PC];
+    if(decoded.fusion == CHIP8_Fusion::Unknown)
+        decoded = decodeFusion(PC);
+
+    const uint16_t* op = decoded.opcodes;
+    waitingForKey = false;
+
+    switch(decoded.fusion)
+    {
+        case CHIP8_Fusion::LoadLoadIndexDraw:
+            if(budget < 4)
+                return 0;
+            V[getX(op[0])] = getNN(op[0]);
+            V[getX(op[1])] = getNN(op[1]);
+            I = getNNN(op[2]);
+            drawSprite(op[3]);
+            PC += 8;
+            cycleCount += 4;
+            return 4;
+
+        case CHIP8_Fusion::TimerPoll:
+        {
+            if(budget < 3)
+                return 0;
 
-            if(soundTimer)
+            const uint8_t x = getX(op[0]);
+            V[x] = delayTimer;
+            if(V[x] == getNN(op[1]))
             {
-                mediator.setSoundEffect();
-                soundTimer--;
+                PC += 6;
+                cycleCount += 2;
+                return 2;
             }
-            else
-                mediator.unsetSoundEffect();
-            
-            start = std::chrono::high_resolution_clock::now();
+
+            //nothing changes until the timers tick, whole iterations of the loop are skipped at once
+            const uint64_t instructions = budget - budget % 3;
+            cycleCount += instructions;
+            return instructions;
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        case CHIP8_Fusion::AddSkipEqual:
+        case CHIP8_Fusion::AddSkipNotEqual:
+        {
+            if(budget < 2)
+                return 0;
+
+            V[getX(op[0])] += getNN(op[0]);
+            const bool equal = V[getX(op[1])] == getNN(op[1]);
+            PC += equal == (decoded.fusion == CHIP8_Fusion::AddSkipEqual) ? 6 : 4;
+            cycleCount += 2;
+            return 2;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+uint64_t CHIP8::executeTiered(uint64_t budget)
+{
+    if(compiledBlocks->empty() == false)
+        installCompiledBlocks();
+
+    if(CHIP8_Memory::canExecute(PC) == false)
+        return 0;
+
+    const CHIP8_CompiledBlock* block = blockTable[PC].get();
+    if(block)
+        return executeBlock(*block, budget);
+
+    //only block entries are counted, i.e. addresses reached by a jump, skip, call, return or another block
+    uint16_t& counter = blockCounters[PC];
+    if(PC != sequentialPC && counter < tierUpThreshold && ++counter == tierUpThreshold)
+    {
+        std::vector<uint8_t> source(std::min<std::size_t>(2 * CHIP8_BlockCompiler::maxBlockInstructions, RAM.size() - PC));
+        RAM.read(PC, source.data(), source.size());
+        blockCompiler->submit(compiledBlocks, PC, std::move(source));
+    }
+
+    sequentialPC = PC + 2;
+    return 0;
+}
+
+uint64_t CHIP8::executeBlock(const CHIP8_CompiledBlock& block, uint64_t budget)
+{
+    waitingForKey = false;
+
+    uint64_t executed = 0;
+    for(const CHIP8_CompiledOp& op : block.ops)
+    {
+        if(executed == budget)
+            break;
+        executed++;
+
+        uint8_t& VX = V[op.x];
+        const uint8_t VY = V[op.y];
+
+        switch(op.kind)
+        {
+            case CHIP8_CompiledOpKind::ClearScreen:
+                for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+                {
+                    if(frameBuffer[y])
+                    {
+                        xorFrameRow(y, frameBuffer[y]);
+                        dirtyRows |= 1u << y;
+                    }
+                }
+                if(displayWait == false && dirtyRows)
+                    publishFrame();
+                break;
+
+            case CHIP8_CompiledOpKind::Jump:
+                PC = op.operand - 2;
+                break;
+            case CHIP8_CompiledOpKind::SkipEqualImmediate:
+                PC += VX == op.operand ? 2 : 0;
+                break;
+            case CHIP8_CompiledOpKind::SkipNotEqualImmediate:
+                PC += VX != op.operand ? 2 : 0;
+                break;
+            case CHIP8_CompiledOpKind::SkipEqual:
+                PC += VX == VY ? 2 : 0;
+                break;
+            case CHIP8_CompiledOpKind::SkipNotEqual:
+                PC += VX != VY ? 2 : 0;
+                break;
+
+            case CHIP8_CompiledOpKind::LoadImmediate:
+                VX = op.operand;
+                break;
+            case CHIP8_CompiledOpKind::AddImmediate:
+                VX += op.operand;
+                break;
+
+            //VF is written before VX, exactly like the interpreter does
+            case CHIP8_CompiledOpKind::Move:
+                VX = VY;
+                break;
+            case CHIP8_CompiledOpKind::Or:
+                VX |= VY;
+                break;
+            case CHIP8_CompiledOpKind::And:
+                VX &= VY;
+                break;
+            case CHIP8_CompiledOpKind::Xor:
+                VX ^= VY;
+                break;
+            case CHIP8_CompiledOpKind::Add:
+                V[0xf] = (int)VX + (int)VY > 0xff ? 1 : 0;
+                VX = V[op.x] + V[op.y];
+                break;
+            case CHIP8_CompiledOpKind::Sub:
+                V[0xf] = VX > VY ? 1 : 0;
+                VX = V[op.x] - V[op.y];
+                break;
+            case CHIP8_CompiledOpKind::ShiftRight:
+                V[0xf] = VX & 0x1;
+                VX = V[op.x] >> 1;
+                break;
+            case CHIP8_CompiledOpKind::SubReverse:
+                V[0xf] = VY > VX ? 1 : 0;
+                VX = V[op.y] - V[op.x];
+                break;
+            case CHIP8_CompiledOpKind::ShiftLeft:
+                V[0xf] = VX >> 7;
+                VX = V[op.x] << 1;
+                break;
+
+            case CHIP8_CompiledOpKind::LoadIndex:
+                I = op.operand;
+                break;
+            case CHIP8_CompiledOpKind::Random:
+                VX = rng->nextByte() & op.operand;
+                break;
+            case CHIP8_CompiledOpKind::Draw:
+                drawSprite(op.operand);
+                break;
+
+            case CHIP8_CompiledOpKind::LoadDelay:
+                VX = delayTimer;
+                break;
+            case CHIP8_CompiledOpKind::SetDelay:
+                delayTimer = VX;
+                break;
+            case CHIP8_CompiledOpKind::SetSound:
+                soundTimer = VX;
+                break;
+            case CHIP8_CompiledOpKind::AddIndex:
+                I += VX;
+                break;
+            case CHIP8_CompiledOpKind::LoadFont:
+                I = (uint16_t)VX * (uint16_t)5;
+                break;
+        }
+
+        PC += 2;
+    }
+
+    cycleCount += executed;
+    return executed;
+}
+
+void CHIP8::installCompiledBlocks()
+{
+    CHIP8_CompiledBlockPtr block;
+    while(compiledBlocks->tryPop(block))
+    {
+        //an empty block marks an address that stays interpreted, its counter is left saturated
+        if(block->ops.empty() || blockTable[block->start])
+            continue;
+
+        //the code may have been overwritten while the block was being compiled
+        bool current = true;
+        for(std::size_t i = 0; i < block->source.size() && current; i++)
+            current = RAM[block->start + i] == block->source[i];
+
+        if(current == false)
+        {
+            blockCounters[block->start] = 0;
+            continue;
+        }
+
+        blockTable[block->start] = block;
+        for(std::size_t i = 0; i < block->source.size(); i++)
+            blockCoverage[block->start + i]++;
+    }
+}
+
+void CHIP8::invalidateBlocks(uint16_t address)
+{
+    const int maxBlockBytes = 2 * CHIP8_BlockCompiler::maxBlockInstructions;
+
+    for(int start = std::max(0, address - maxBlockBytes + 1); start <= address; start++)
+    {
+        const CHIP8_CompiledBlockPtr& block = blockTable[start];
+        if(block == nullptr || start + block->source.size() <= address)
+            continue;
+
+        for(std::size_t i = 0; i < block->source.size(); i++)
+            blockCoverage[start + i]--;
+
+        blockTable[start] = nullptr;
+        blockCounters[start] = 0;
+    }
+}
+
+static uint64_t hashMemory(const CHIP8_Memory& RAM, const CHIP8_FrameBuffer& frameBuffer)
+{
+    uint64_t hash = 0;
+    for(int address = 0; address < CHIP8_Memory::memorySize; address++)
+        hash ^= CHIP8_HASH::RAMByte(address, RAM[address]);
+    for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+        hash ^= CHIP8_HASH::frameRow(y, frameBuffer[y]);
+    return hash;
+}
+
+void CHIP8::rehashMemory()
+{
+    memoryHash = hashMemory(RAM, frameBuffer);
+}
+
+void CHIP8::writeRAM(uint16_t address, uint8_t value)
+{
+    address &= CHIP8_Memory::addressMask;
+    memoryHash ^= CHIP8_HASH::RAMByte(address, RAM[address]) ^ CHIP8_HASH::RAMByte(address, value);
+    RAM.store(address, value);
+
+    //a cached sequence covers up to 8 bytes from its start address
+    if(fusionCache.empty() == false)
+        for(int start = std::max(0, address - 7); start <= address; start++)
+            fusionCache[start].fusion = CHIP8_Fusion::Unknown;
+
+    if(blockCoverage.empty() == false && blockCoverage[address])
+        invalidateBlocks(address);
+}
+
+void CHIP8::xorFrameRow(int y, uint64_t pixels)
+{
+    memoryHash ^= CHIP8_HASH::frameRow(y, frameBuffer[y]);
+    frameBuffer[y] ^= pixels;
+    memoryHash ^= CHIP8_HASH::frameRow(y, frameBuffer[y]);
+}
+
+const CHIP8_FrameBuffer& CHIP8::getFrameBuffer() const
+{
+    return frameBuffer;
+}
+
+bool CHIP8::isWaitingForKey() const
+{
+    return waitingForKey;
+}
+
+void CHIP8::setTiming(CHIP8_Timing Timing)
+{
+    timing = Timing;
+    frameProgress = 0;
+}
+
+CHIP8_Timing CHIP8::getTiming() const
+{
+    return timing;
+}
+
+void CHIP8::setInstructionsPerFrame(int count)
+{
+    instructionsPerFrame = count;
+}
+
+int CHIP8::getInstructionsPerFrame() const
+{
+    return instructionsPerFrame;
+}
+
+void CHIP8::tickTimers()
+{
+    if(delayTimer)
+        delayTimer--;
+
+    if(soundTimer)
+    {
+        mediator.setSoundEffect();
+        soundTimer--;
+    }
+    else
+        mediator.unsetSoundEffect();
+
+    if(dirtyRows)
+        publishFrame();
+
+    mediator.getMetrics().add(CHIP8_Metric::TimerTicks, 1);
+    reportMetrics();
+}
+
+void CHIP8::publishFrame()
+{
+    mediator.updateFrameBuffer(frameBuffer, dirtyRows);
+    dirtyRows = 0;
+}
+
+void CHIP8::reportMetrics()
+{
+    //instructions are added in batches, once per tick or runCycles() call
+    mediator.getMetrics().add(CHIP8_Metric::InstructionsExecuted, cycleCount - reportedCycles);
+    reportedCycles = cycleCount;
+}
+
+void CHIP8::setDisplayWait(bool enabled)
+{
+    displayWait = enabled;
+}
+
+void CHIP8::runPaced()
+{
+    const std::chrono::steady_clock::duration framePeriod = std::chrono::microseconds(1000000 / 60);
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now();
+
+    while(mediator.shouldCHIP8Stop() == false && hasFaulted() == false)
+    {
+        if(runFrame() == CHIP8_YieldReason::KeyWait)
+        {
+            mediator.waitForKeyPress();
+            deadline = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        //a VM that fell behind catches up at most one frame instead of running a burst
+        deadline = std::max(deadline + framePeriod, std::chrono::steady_clock::now() - framePeriod);
+        std::this_thread::sleep_until(deadline);
     }
 }
 
+void CHIP8::step()
+{
+    waitingForKey = false;
+
+    if(CHIP8_Memory::canExecute(PC) == false)
+        raiseFault(CHIP8_FaultKind::ForbiddenMemoryAccess, 0);
+    else if(tracer)
+        tracedClockCycle();
+    else
+        clockCycle();
+}
+
+uint64_t CHIP8::runCycles(uint64_t count)
+{
+    const uint64_t startCycle = cycleCount;
+
+    for(uint64_t i = 0; i < count && hasFaulted() == false; i++)
+    {
+        const uint64_t optimized = executeOptimized(count - i);
+        if(optimized)
+        {
+            i += optimized - 1;
+            continue;
+        }
+
+        step();
+        if(waitingForKey)
+            break;
+    }
+
+    reportMetrics();
+    return cycleCount - startCycle;
+}
+
 void CHIP8::clockCycle()
 {
-    const uint16_t opcode = (uint16_t(RAM.at(PC)) << 8) | uint16_t(RAM.at(PC + 1));
+    const uint16_t opcode = fetch(PC);
 
     switch (opcode & 0xf000)
     {
@@ -117,9 +789,16 @@ void CHIP8::clockCycle()
             switch (opcode)
             {
                 case 0x00e0: //Clears the screen
-                    for(auto& row : frameBuffer)
-                        std::fill(row.begin(), row.end(), false);
-                    mediator.updateFrameBuffer(frameBuffer);
+                    for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+                    {
+                        if(frameBuffer[y])
+                        {
+                            xorFrameRow(y, frameBuffer[y]);
+                            dirtyRows |= 1u << y;
+                        }
+                    }
+                    if(displayWait == false && dirtyRows)
+                        publishFrame();
                     break;
 
                 case 0x00ee: //Returns from a subroutine
@@ -130,16 +809,12 @@ void CHIP8::clockCycle()
                         SP--;
                     }
                     else
-                    {
-                        std::cout << "TRIED TO REMOVE AN ITEM FROM AN EMPTY STACK!" << std::endl;
-                        mediator.stopCHIP8();
-                    }
+                        raiseFault(CHIP8_FaultKind::StackUnderflow, opcode);
 
                 } break;
 
                 default: //Calls machine code routine at address NNN
-                    std::cout << "Calls machine code routine at address NNN - NOT IMPLEMENTED" << std::endl;
-                    mediator.stopCHIP8();
+                    raiseFault(CHIP8_FaultKind::MachineCodeRoutine, opcode);
             }
         } break;
 
@@ -155,10 +830,7 @@ void CHIP8::clockCycle()
                 PC = getNNN(opcode) - 2;
             }
             else
-            {
-                std::cout << "STACK OVERFLOW!" << std::endl;
-                mediator.stopCHIP8();
-            }
+                raiseFault(CHIP8_FaultKind::StackOverflow, opcode);
             break;
 
         case 0x3000:
@@ -230,8 +902,7 @@ void CHIP8::clockCycle()
                     break;
                 
                 default:
-                    std::cout << "OPCODE " << std::hex << (int)opcode << " DOES NOT EXISTS!" << std::endl;
-                    mediator.stopCHIP8();
+                    raiseFault(CHIP8_FaultKind::InvalidOpcode, opcode);
             }
         } break;
 
@@ -243,10 +914,7 @@ void CHIP8::clockCycle()
                     PC += 2;
             }
             else
-            {
-                std::cout << "OPCODE " << std::hex << (int)opcode << " DOES NOT EXISTS!" << std::endl;
-                mediator.stopCHIP8();
-            }
+                raiseFault(CHIP8_FaultKind::InvalidOpcode, opcode);
                 
         } break;
             
@@ -260,50 +928,33 @@ void CHIP8::clockCycle()
             break;
 
         case 0xc000:
-            V[getX(opcode)] = (uint16_t)rng() & getNN(opcode);
+            V[getX(opcode)] = rng->nextByte() & getNN(opcode);
             break;
         
         case 0xd000:
-        {
-            uint8_t n = getN(opcode);
-            uint8_t x = V[getX(opcode)];
-            uint8_t y = V[getY(opcode)];
-
-            V[0xf] = 0;
-
-            for(uint8_t i = 0; i < n; i++)
-            {
-                for(uint8_t j = 0x80; j > 0; j >>= 1)
-                {
-                    if(frameBuffer[y][x] == true && (RAM[(I + (uint16_t)i) & 0xfff] & j) != 0)
-                        V[0xf] = 1;
-                    frameBuffer[y][x] = ((int)frameBuffer[y][x] ^ ((RAM[(I + (uint16_t)i) & 0xfff] & j) != 0 ? 1 : 0)) != 0;
-                    x = (x + 1) % CHIP8_CONSTANTS::frameWidth;
-                }
-                x = V[getX(opcode)];
-                y = (y + 1) % CHIP8_CONSTANTS::frameHeight;
-            }
-
-            mediator.updateFrameBuffer(frameBuffer);
-        } break;
+            drawSprite(opcode);
+            break;
 
         case 0xe000:
         {
             switch (opcode & 0xff)
             {
                 case 0x009e:
-                    if(mediator.isKeyPressed(V[getX(opcode)]))
+                    if(V[getX(opcode)] > 0xf)
+                        raiseFault(CHIP8_FaultKind::InvalidKey, opcode);
+                    else if(mediator.isKeyPressed(V[getX(opcode)]))
                         PC += 2;
                     break;
 
                 case 0x00a1:
-                    if(mediator.isKeyReleased(V[getX(opcode)]))
+                    if(V[getX(opcode)] > 0xf)
+                        raiseFault(CHIP8_FaultKind::InvalidKey, opcode);
+                    else if(mediator.isKeyReleased(V[getX(opcode)]))
                         PC += 2;
                     break;
 
                 default:
-                    std::cout << "OPCODE " << std::hex << (int)opcode << " DOES NOT EXISTS!" << std::endl;
-                    mediator.stopCHIP8();
+                    raiseFault(CHIP8_FaultKind::InvalidOpcode, opcode);
                     break;
             }
 
@@ -318,8 +969,14 @@ void CHIP8::clockCycle()
                     break;
                 
                 case 0x0a:
-                    V[getX(opcode)] = mediator.getNewKeyPress();
-                    break;
+                {
+                    //without a pressed key the instruction is repeated when the VM resumes
+                    uint8_t key;
+                    if(mediator.tryGetKeyPress(key))
+                        V[getX(opcode)] = key;
+                    else
+                        waitingForKey = true;
+                } break;
                 
                 case 0x15:
                     delayTimer = V[getX(opcode)];
@@ -338,45 +995,185 @@ void CHIP8::clockCycle()
                     break;
                 
                 case 0x33:
-                    RAM.at(I) = V[getX(opcode)] / 100;
-                    RAM.at((I + 1) & 0xfff) = (V[getX(opcode)] / 10) % 10;
-                    RAM.at((I + 2) & 0xfff) = V[getX(opcode)] % 10;
+                    if((CHIP8_Memory::getAccess(I, 3) & CHIP8_Memory::writable) == 0)
+                    {
+                        raiseFault(CHIP8_FaultKind::ForbiddenMemoryAccess, opcode);
+                        break;
+                    }
+                    writeRAM(I, V[getX(opcode)] / 100);
+                    writeRAM(I + 1, (V[getX(opcode)] / 10) % 10);
+                    writeRAM(I + 2, V[getX(opcode)] % 10);
                     break;
                 
                 case 0x55:
-                    if(I < 0x200 || I + getX(opcode) >= 4096)
-                    {
-                        std::cout << "TRIED TO ACCESS THE FORBIDDEN MEMORY!";
-                        mediator.stopCHIP8();
-                    }
+                    if((CHIP8_Memory::getAccess(I, getX(opcode) + 1) & CHIP8_Memory::writable) == 0)
+                        raiseFault(CHIP8_FaultKind::ForbiddenMemoryAccess, opcode);
                     else
                     {
                         for(uint16_t i = 0; i <= getX(opcode); i++)
-                            RAM.at(I + i) = V[i];
+                            writeRAM(I + i, V[i]);
                     }
                     break;
                 
                 case 0x65:
-                    if(I < 0x200 || I + getX(opcode) >= 4096)
-                    {
-                        std::cout << "TRIED TO ACCESS THE FORBIDDEN MEMORY!";
-                        mediator.stopCHIP8();
-                    }
-                    else
-                    {
-                        for(uint16_t i = 0; i <= getX(opcode); i++)
-                            V[i] = RAM.at(I + i);
-                    }
+                    for(uint16_t i = 0; i <= getX(opcode); i++)
+                        V[i] = RAM[I + i];
                     break;
                 
                 default:
-                    std::cout << "OPCODE " << std::hex << (int)opcode << " DOES NOT EXISTS!" << std::endl;
-                    mediator.stopCHIP8();
+                    raiseFault(CHIP8_FaultKind::InvalidOpcode, opcode);
             }
         } break;
     }
 
+    if(hasFaulted() || waitingForKey)
+        return;
+
     PC += 2;
+    cycleCount++;
+}
+
+void CHIP8::drawSprite(uint16_t opcode)
+{
+    const uint8_t n = getN(opcode);
+    const uint8_t x = V[getX(opcode)] % CHIP8_CONSTANTS::frameWidth;
+    uint8_t y = V[getY(opcode)] % CHIP8_CONSTANTS::frameHeight;
+
+    V[0xf] = 0;
+
+    for(uint8_t i = 0; i < n; i++)
+    {
+        const uint64_t spriteRow = (uint64_t)RAM[I + i] << 56;
+
+        //rotating instead of shifting wraps the sprite around the right edge
+        const uint64_t pixels = x ? (spriteRow >> x) | (spriteRow << (64 - x)) : spriteRow;
+
+        if(pixels)
+        {
+            if(frameBuffer[y] & pixels)
+                V[0xf] = 1;
+            xorFrameRow(y, pixels);
+            dirtyRows |= 1u << y;
+        }
+
+        y = (y + 1) % CHIP8_CONSTANTS::frameHeight;
+    }
+
+    if(displayWait == false && dirtyRows)
+        publishFrame();
+}
+
+void CHIP8::tracedClockCycle()
+{
+    CHIP8_TraceRecord traceRecord;
+    traceRecord.cycle = cycleCount;
+    traceRecord.PC = PC;
+    traceRecord.opcode = fetch(PC);
+
+    uint8_t previousV[16];
+    std::copy(V.begin(), V.end(), previousV);
+
+    clockCycle();
+
+    //FX0A runs again until a key is pressed, only the run that completes is recorded
+    if(waitingForKey)
+        return;
+
+    traceRecord.I = I;
+    traceRecord.changedRegisters = 0;
+    for(int i = 0; i < 16; i++)
+    {
+        traceRecord.V[i] = V[i];
+        if(V[i] != previousV[i])
+            traceRecord.changedRegisters |= 1 << i;
+    }
+
+    tracer->record(traceRecord);
+}
+
+uint64_t CHIP8::getCycleCount() const
+{
+    return cycleCount;
+}
+
+//registers are few enough to be hashed from scratch every time
+static uint64_t hashRegisters(const std::vector<uint8_t>& V, uint16_t I, uint16_t PC,
+    const std::vector<uint16_t>& STACK, uint8_t SP, uint8_t delayTimer, uint8_t soundTimer,
+    uint64_t rngState, CHIP8_FaultKind faultKind)
+{
+    uint64_t hash = 0;
+    for(int i = 0; i < 16; i += 8)
+    {
+        uint64_t packed = 0;
+        for(int j = 0; j < 8; j++)
+            packed |= (uint64_t)V[i + j] << (8 * j);
+        hash = CHIP8_HASH::combine(hash, packed);
+    }
+
+    for(int i = 0; i < SP; i++)
+        hash = CHIP8_HASH::combine(hash, STACK[i]);
+
+    hash = CHIP8_HASH::combine(hash, (uint64_t)I | (uint64_t)PC << 16 | (uint64_t)SP << 32
+        | (uint64_t)delayTimer << 40 | (uint64_t)soundTimer << 48 | (uint64_t)faultKind << 56);
+    return CHIP8_HASH::combine(hash, rngState);
+}
+
+uint64_t CHIP8::getStateHash() const
+{
+    return memoryHash ^ hashRegisters(V, I, PC, STACK, SP, delayTimer, soundTimer, rng->getState(), fault.kind);
+}
+
+uint16_t CHIP8::getProgramCounter() const
+{
+    return PC;
+}
+
+uint16_t CHIP8::getIndexRegister() const
+{
+    return I;
+}
+
+const std::vector<uint8_t>& CHIP8::getRegisters() const
+{
+    return V;
+}
+
+const CHIP8_Memory& CHIP8::getMemory() const
+{
+    return RAM;
+}
+
+void CHIP8::setTracer(CHIP8_Tracer* Tracer)
+{
+    tracer = Tracer;
+}
+
+bool CHIP8::hasFaulted() const
+{
+    return fault.kind != CHIP8_FaultKind::None;
+}
+
+const CHIP8_Fault& CHIP8::getFault() const
+{
+    return fault;
+}
+
+void CHIP8::setFaultLog(CHIP8_FaultLog* FaultLog)
+{
+    faultLog = FaultLog;
+}
+
+void CHIP8::raiseFault(CHIP8_FaultKind kind, uint16_t opcode)
+{
+    if(hasFaulted())
+        return;
+
+    fault = CHIP8_Fault{ kind, PC, opcode, cycleCount };
+
+    if(faultLog)
+        faultLog->post(fault);
+
+    mediator.stopCHIP8();
 }
 
 uint16_t CHIP8::getNNN(uint16_t opcode)
@@ -402,4 +1199,142 @@ uint16_t CHIP8::getX(uint16_t opcode)
 uint16_t CHIP8::getY(uint16_t opcode)
 {
     return (opcode >> 4) & 0xf;
+}
+
+bool CHIP8_State::operator==(const CHIP8_State& other) const
+{
+    return RAM == other.RAM && V == other.V && I == other.I && PC == other.PC
+        && STACK == other.STACK && SP == other.SP
+        && delayTimer == other.delayTimer && soundTimer == other.soundTimer
+        && rngState == other.rngState && frameBuffer == other.frameBuffer
+        && cycleCount == other.cycleCount
+        && fault.kind == other.fault.kind && fault.PC == other.fault.PC
+        && fault.opcode == other.fault.opcode && fault.cycle == other.fault.cycle;
+}
+
+bool CHIP8_State::operator!=(const CHIP8_State& other) const
+{
+    return !(*this == other);
+}
+
+uint64_t CHIP8_State::hash() const
+{
+    //recomputed rather than taken from memoryHash, RAM may have been changed by hand
+    return hashMemory(RAM, frameBuffer) ^ hashRegisters(V, I, PC, STACK, SP, delayTimer, soundTimer, rngState, fault.kind);
+}
+
+namespace
+{
+    const char stateMagic[4] = { 'C', 'H', '8', 'S' };
+    const uint32_t stateVersion = 1;
+
+    class StateWriter
+    {
+    public:
+        std::vector<uint8_t> data;
+
+        void put(uint64_t value, int bytes)
+        {
+            for(int i = 0; i < bytes; i++)
+                data.push_back((value >> (8 * i)) & 0xff);
+        }
+    };
+
+    class StateReader
+    {
+    public:
+        const uint8_t* data;
+        std::size_t size;
+        std::size_t position;
+
+        bool get(uint64_t& value, int bytes)
+        {
+            if(position + bytes > size)
+                return false;
+
+            value = 0;
+            for(int i = 0; i < bytes; i++)
+                value |= (uint64_t)data[position + i] << (8 * i);
+            position += bytes;
+            return true;
+        }
+
+        template<typename T>
+        bool get(T& value)
+        {
+            uint64_t v;
+            if(get(v, sizeof(T)) == false)
+                return false;
+            value = (T)v;
+            return true;
+        }
+    };
+}
+
+const std::size_t CHIP8_State::serializedSize = 4 + 4 + 4096 + 16 + 2 + 2 + CHIP8::stackSize * 2 + 1 + 1 + 1
+    + 8 + CHIP8_CONSTANTS::frameHeight * 8 + 8 + 1 + 2 + 2 + 8;
+
+std::vector<uint8_t> CHIP8_State::serialize() const
+{
+    StateWriter writer;
+    writer.data.reserve(serializedSize);
+
+    writer.data.insert(writer.data.end(), stateMagic, stateMagic + sizeof(stateMagic));
+    writer.put(stateVersion, 4);
+
+    writer.data.resize(writer.data.size() + RAM.size());
+    RAM.read(0, &writer.data[writer.data.size() - RAM.size()], RAM.size());
+    writer.data.insert(writer.data.end(), V.begin(), V.end());
+    writer.put(I, 2);
+    writer.put(PC, 2);
+    for(uint16_t address : STACK)
+        writer.put(address, 2);
+    writer.put(SP, 1);
+    writer.put(delayTimer, 1);
+    writer.put(soundTimer, 1);
+    writer.put(rngState, 8);
+    for(uint64_t row : frameBuffer)
+        writer.put(row, 8);
+    writer.put(cycleCount, 8);
+    writer.put((uint8_t)fault.kind, 1);
+    writer.put(fault.PC, 2);
+    writer.put(fault.opcode, 2);
+    writer.put(fault.cycle, 8);
+
+    return writer.data;
+}
+
+bool CHIP8_State::deserialize(const uint8_t* data, std::size_t size)
+{
+    if(size != serializedSize || std::equal(stateMagic, stateMagic + sizeof(stateMagic), data) == false)
+        return false;
+
+    StateReader reader{ data, size, sizeof(stateMagic) };
+
+    uint32_t version;
+    if(reader.get(version) == false || version != stateVersion)
+        return false;
+
+    RAM.write(0, data + reader.position, 4096);
+    reader.position += 4096;
+    V.assign(data + reader.position, data + reader.position + 16);
+    reader.position += 16;
+
+    STACK.resize(CHIP8::stackSize);
+    frameBuffer.resize(CHIP8_CONSTANTS::frameHeight);
+
+    bool ok = reader.get(I) && reader.get(PC);
+    for(auto& address : STACK)
+        ok = ok && reader.get(address);
+    ok = ok && reader.get(SP) && reader.get(delayTimer) && reader.get(soundTimer) && reader.get(rngState);
+    for(auto& row : frameBuffer)
+        ok = ok && reader.get(row);
+    ok = ok && reader.get(cycleCount);
+
+    uint8_t faultKind = 0;
+    ok = ok && reader.get(faultKind) && reader.get(fault.PC) && reader.get(fault.opcode) && reader.get(fault.cycle);
+    fault.kind = (CHIP8_FaultKind)faultKind;
+    memoryHash = hashMemory(RAM, frameBuffer);
+
+    return ok && SP <= CHIP8::stackSize && faultKind <= (uint8_t)CHIP8_FaultKind::InvalidKey;
 }
\ No newline at end of file
@@ -1,4 +1,83 @@
+#pragma once
+
 #include "CHIP8_Mediator.hpp"
+#include "CHIP8_Tracer.hpp"
+#include "CHIP8_Fault.hpp"
+#include "CHIP8_RNG.hpp"
+#include "CHIP8_Hash.hpp"
+#include "CHIP8_Memory.hpp"
+#include "CHIP8_Timing.hpp"
+#include "CHIP8_BlockCompiler.hpp"
+
+enum class CHIP8_YieldReason : uint8_t
+{
+    FrameEnd,   // a whole frame was executed and the timers ticked
+    KeyWait,    // FX0A found no pressed key, it is executed again on resume
+    Fault,
+    Stopped     // the mediator asked the VM to stop
+};
+
+enum class CHIP8_Engine : uint8_t
+{
+    Interpreter,  // decodes and dispatches every instruction on its own
+    Fused,        // runs common instruction sequences with a single dispatch, see CHIP8_Fusion
+    Tiered        // interprets first, hot blocks are compiled in the background, see CHIP8_BlockCompiler
+};
+
+// instruction sequences the fused engine executes as one handler
+enum class CHIP8_Fusion : uint8_t
+{
+    Unknown,            // not decoded yet or invalidated by a write
+    None,
+    LoadLoadIndexDraw,  // 6XNN 6YNN ANNN DXYN
+    TimerPoll,          // FX07 3XNN 1NNN, jumping back to the FX07
+    AddSkipEqual,       // 7XNN 3YNN
+    AddSkipNotEqual     // 7XNN 4YNN
+};
+
+struct CHIP8_FusedInstruction
+{
+    CHIP8_Fusion fusion;
+    uint16_t opcodes[4];
+};
+
+struct CHIP8_State
+{
+    CHIP8_Memory RAM;
+    std::vector<uint8_t> V;
+    uint16_t I;
+    uint16_t PC;
+
+    std::vector<uint16_t> STACK;
+    uint8_t SP;
+
+    uint8_t delayTimer;
+    uint8_t soundTimer;
+
+    uint64_t rngState;
+
+    CHIP8_FrameBuffer frameBuffer;
+
+    uint64_t cycleCount;
+    CHIP8_Fault fault;
+
+    // the RAM and frame buffer part of hash(), so loading a state doesn't rehash 4 KB. Set by
+    // CHIP8::saveState() and deserialize(), neither serialized nor compared; a state whose
+    // RAM or frame buffer is changed by hand has to be loaded with it recomputed
+    uint64_t memoryHash;
+
+    bool operator==(const CHIP8_State& other) const;
+    bool operator!=(const CHIP8_State& other) const;
+
+    // fixed size little-endian encoding, the same on every platform
+    static const std::size_t serializedSize;
+
+    std::vector<uint8_t> serialize() const;
+    bool deserialize(const uint8_t* data, std::size_t size);
+
+    // same value as CHIP8::getStateHash() of a VM in this state, the cycle count is not hashed
+    uint64_t hash() const;
+};
 
 class CHIP8
 {
@@ -14,8 +93,14 @@ public:
 
     static const int stackSize = 16;
 
+    static const int defaultInstructionsPerFrame = 8;
+
+    // block entries after which the tiered engine submits a block for compilation
+    static const uint16_t tierUpThreshold = 16;
+    static const int compiledBlockQueueSize = 256;
+
 protected:
-    std::vector<uint8_t> RAM;
+    CHIP8_Memory RAM;
     std::vector<uint8_t> V;
     uint16_t I;
     uint16_t PC;
@@ -26,19 +111,126 @@ protected:
     uint8_t delayTimer;
     uint8_t soundTimer;
 
-    std::mt19937 rng;
+    CHIP8_XorShiftRNG defaultRNG;
+    CHIP8_RNG* rng;
 
-    std::vector<std::vector<bool>> frameBuffer;
+    CHIP8_FrameBuffer frameBuffer;
+    uint32_t dirtyRows; // rows changed since the last publishFrame()
     CHIP8_Mediator& mediator;
+
+    // XOR of CHIP8_HASH::RAMByte() and CHIP8_HASH::frameRow() over RAM and the frame buffer,
+    // kept up to date by writeRAM() and xorFrameRow()
+    uint64_t memoryHash;
+
+    uint64_t cycleCount;
+    uint64_t reportedCycles; // cycleCount already added to the mediator's metrics
+    CHIP8_Tracer* tracer;
+
+    CHIP8_Fault fault;
+    CHIP8_FaultLog* faultLog;
+
+    // with display wait the frame is published once per 60 Hz tick instead of after every 00E0 / DXYN
+    bool displayWait;
+
+    // runFrame() can return in the middle of a frame and continue from here; progress counts
+    // instructions or, with CHIP8_Timing::CosmacVIP, machine cycles
+    CHIP8_Timing timing;
+    int instructionsPerFrame;
+    int frameProgress;
+    bool waitingForKey;
+
+    // decoded sequence starting at every address, only allocated for the fused engine
+    CHIP8_Engine engine;
+    std::vector<CHIP8_FusedInstruction> fusionCache;
+
+    // tiered engine state, only allocated while it is selected
+    CHIP8_BlockCompiler* blockCompiler;
+    std::shared_ptr<CHIP8_CompiledBlockQueue> compiledBlocks;
+    std::vector<uint16_t> blockCounters;       // entries per address, tierUpThreshold once submitted
+    std::vector<CHIP8_CompiledBlockPtr> blockTable;
+    std::vector<uint8_t> blockCoverage;        // installed blocks covering each byte
+    uint16_t sequentialPC;                     // PC reached without a jump, not counted as a block entry
 public:
     CHIP8(CHIP8_Mediator& Mediator);
     ~CHIP8();
 
     bool loadMemoryImage(std::string filename);
+    bool loadMemoryImage(const uint8_t* image, std::size_t size);
     void reset();
 
+    CHIP8_State saveState() const;
+    void loadState(const CHIP8_State& state);
+    // loadState() without publishing the frame, for VMs run without a display like the ones of
+    // CHIP8_Search; the next published frame has every row
+    void restoreState(const CHIP8_State& state);
+
+    void setRNG(CHIP8_RNG* RNG);
+    void seedRNG(uint64_t seed);
+
     void run();
 
+    void step();
+    uint64_t runCycles(uint64_t count);
+    void tickTimers();
+
+    CHIP8_YieldReason runFrame();
+    bool isWaitingForKey() const;
+
+    const CHIP8_FrameBuffer& getFrameBuffer() const;
+    void setInstructionsPerFrame(int count);
+    int getInstructionsPerFrame() const;
+
+    void setDisplayWait(bool enabled);
+
+    // CosmacVIP makes the instructions per frame follow from the instructions' cycle costs,
+    // run() and runFrame() then use the interpreter whatever the engine
+    void setTiming(CHIP8_Timing Timing);
+    CHIP8_Timing getTiming() const;
+
+    // the fused engine is used by runCycles() and runFrame() while no tracer is set
+    void setEngine(CHIP8_Engine Engine);
+    CHIP8_Engine getEngine() const;
+
+    void setBlockCompiler(CHIP8_BlockCompiler* BlockCompiler); // nullptr selects the global compiler
+    std::size_t getCompiledBlockCount();
+
+    uint64_t getCycleCount() const;
+    uint64_t getStateHash() const;
+
+    uint16_t getProgramCounter() const;
+    uint16_t getIndexRegister() const;
+    const std::vector<uint8_t>& getRegisters() const;
+    const CHIP8_Memory& getMemory() const;
+
+    void setTracer(CHIP8_Tracer* Tracer);
+
+    bool hasFaulted() const;
+    const CHIP8_Fault& getFault() const;
+    void setFaultLog(CHIP8_FaultLog* FaultLog);
+
 protected:
+    void publishFrame();
+    void reportMetrics();
+    void rehashMemory();
+    void writeRAM(uint16_t address, uint8_t value);
+    void xorFrameRow(int y, uint64_t pixels);
+
+    void raiseFault(CHIP8_FaultKind kind, uint16_t opcode);
+
     void clockCycle();
+    CHIP8_YieldReason runTimedFrame();
+    void runPaced();
+    void tracedClockCycle();
+    void drawSprite(uint16_t opcode);
+
+    uint16_t fetch(uint16_t address) const;
+    CHIP8_FusedInstruction decodeFusion(uint16_t address) const;
+    void clearDecodeCaches();
+    uint64_t executeOptimized(uint64_t budget);
+    uint64_t executeFused(uint64_t budget);
+
+    uint64_t executeTiered(uint64_t budget);
+    uint64_t executeBlock(const CHIP8_CompiledBlock& block, uint64_t budget);
+    void installCompiledBlocks();
+    void invalidateBlocks(uint16_t address);
 };
\ No newline at end of file
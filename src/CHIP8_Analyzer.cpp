@@ -0,0 +1,445 @@
+#include "CHIP8_Analyzer.hpp"
+
+#include <sstream>
+#include <iomanip>
+
+const CHIP8_BasicBlock* CHIP8_Analysis::findBlock(uint16_t address) const
+{
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), address,
+        [](uint16_t a, const CHIP8_BasicBlock& block){
+            return a < block.start;
+        });
+
+    if(it == blocks.begin())
+        return nullptr;
+
+    --it;
+    return address < it->end ? &*it : nullptr;
+}
+
+CHIP8_Analyzer::CHIP8_Analyzer(const uint8_t* rom, std::size_t size)
+    : memory(memorySize, 0)
+{
+    if(size + CHIP8::memoryImageOffset > memorySize)
+        size = memorySize - CHIP8::memoryImageOffset;
+
+    std::copy(rom, rom + size, memory.begin() + CHIP8::memoryImageOffset);
+    romEnd = CHIP8::memoryImageOffset + size;
+}
+
+uint16_t CHIP8_Analyzer::fetch(uint16_t address) const
+{
+    return (uint16_t(memory[address & 0xfff]) << 8) | uint16_t(memory[(address + 1) & 0xfff]);
+}
+
+bool CHIP8_Analyzer::isValid(uint16_t opcode)
+{
+    switch (opcode & 0xf000)
+    {
+        case 0x0000:
+            return opcode == 0x00e0 || opcode == 0x00ee;
+
+        case 0x5000:
+        case 0x9000:
+            return CHIP8::getN(opcode) == 0;
+
+        case 0x8000:
+            return CHIP8::getN(opcode) <= 0x7 || CHIP8::getN(opcode) == 0xe;
+
+        case 0xe000:
+            return CHIP8::getNN(opcode) == 0x9e || CHIP8::getNN(opcode) == 0xa1;
+
+        case 0xf000:
+            switch (CHIP8::getNN(opcode))
+            {
+                case 0x07: case 0x0a: case 0x15: case 0x18: case 0x1e:
+                case 0x29: case 0x33: case 0x55: case 0x65:
+                    return true;
+                default:
+                    return false;
+            }
+
+        default:
+            return true;
+    }
+}
+
+bool CHIP8_Analyzer::isSkip(uint16_t opcode)
+{
+    switch (opcode & 0xf000)
+    {
+        case 0x3000:
+        case 0x4000:
+        case 0x5000:
+        case 0x9000:
+        case 0xe000:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool CHIP8_Analyzer::endsBlock(uint16_t opcode)
+{
+    switch (opcode & 0xf000)
+    {
+        case 0x1000:
+        case 0x2000:
+        case 0xb000:
+            return true;
+        default:
+            return opcode == 0x00ee || isSkip(opcode) || isValid(opcode) == false;
+    }
+}
+
+CHIP8_Analysis CHIP8_Analyzer::analyze() const
+{
+    CHIP8_Analysis analysis;
+    analysis.romEnd = romEnd;
+    analysis.instructionStart.assign(memorySize, false);
+
+    std::vector<bool> leader(memorySize, false);
+    std::vector<bool> invalid(memorySize, false);
+    std::vector<uint16_t> worklist;
+
+    auto addTarget = [&](uint16_t address){
+        address &= 0xfff;
+        if(leader[address] == false)
+        {
+            leader[address] = true;
+            worklist.push_back(address);
+        }
+    };
+
+    addTarget(CHIP8::memoryImageOffset);
+
+    //find every reachable instruction
+    while(worklist.empty() == false)
+    {
+        uint16_t address = worklist.back();
+        worklist.pop_back();
+
+        while(true)
+        {
+            if(address < CHIP8::memoryImageOffset || address + 1 >= romEnd || isValid(fetch(address)) == false)
+            {
+                if(invalid[address & 0xfff] == false)
+                {
+                    invalid[address & 0xfff] = true;
+                    analysis.invalidInstructions.push_back(address);
+                }
+                break;
+            }
+
+            if(analysis.instructionStart[address])
+                break;
+            analysis.instructionStart[address] = true;
+
+            const uint16_t opcode = fetch(address);
+
+            if((opcode & 0xf000) == 0x1000)
+                addTarget(CHIP8::getNNN(opcode));
+            else if((opcode & 0xf000) == 0x2000)
+            {
+                addTarget(CHIP8::getNNN(opcode));
+                addTarget(address + 2);
+            }
+            else if(isSkip(opcode))
+            {
+                addTarget(address + 2);
+                addTarget(address + 4);
+            }
+            else if((opcode & 0xf000) == 0xb000)
+                analysis.indirectJumps.push_back(address);
+
+            if(endsBlock(opcode))
+                break;
+
+            address += 2;
+        }
+    }
+
+    //split the reachable code into basic blocks
+    for(uint16_t start = 0; start < memorySize; start++)
+    {
+        if(leader[start] == false || analysis.instructionStart[start] == false)
+            continue;
+
+        CHIP8_BasicBlock block;
+        block.start = start;
+
+        uint16_t address = start;
+        while(true)
+        {
+            const uint16_t opcode = fetch(address);
+            analysis.instructions.push_back(address);
+
+            if(endsBlock(opcode))
+            {
+                block.end = address + 2;
+
+                switch (opcode & 0xf000)
+                {
+                    case 0x1000:
+                        block.terminator = CHIP8_BlockTerminator::Jump;
+                        block.successors.push_back(CHIP8::getNNN(opcode));
+                        break;
+
+                    case 0x2000:
+                        block.terminator = CHIP8_BlockTerminator::Call;
+                        block.successors.push_back(CHIP8::getNNN(opcode));
+                        block.successors.push_back(address + 2);
+                        break;
+
+                    case 0xb000:
+                        block.terminator = CHIP8_BlockTerminator::Indirect;
+                        break;
+
+                    default:
+                        if(opcode == 0x00ee)
+                            block.terminator = CHIP8_BlockTerminator::Return;
+                        else
+                        {
+                            block.terminator = CHIP8_BlockTerminator::Skip;
+                            block.successors.push_back(address + 2);
+                            block.successors.push_back(address + 4);
+                        }
+                }
+                break;
+            }
+
+            const uint16_t next = address + 2;
+            if(next >= memorySize || analysis.instructionStart[next] == false)
+            {
+                block.end = next;
+                block.terminator = CHIP8_BlockTerminator::Invalid;
+                break;
+            }
+            if(leader[next])
+            {
+                block.end = next;
+                block.terminator = CHIP8_BlockTerminator::Fallthrough;
+                block.successors.push_back(next);
+                break;
+            }
+
+            address = next;
+        }
+
+        analysis.blocks.push_back(block);
+    }
+
+    std::sort(analysis.instructions.begin(), analysis.instructions.end());
+    analysis.instructions.erase(std::unique(analysis.instructions.begin(), analysis.instructions.end()),
+        analysis.instructions.end());
+    std::sort(analysis.invalidInstructions.begin(), analysis.invalidInstructions.end());
+    std::sort(analysis.indirectJumps.begin(), analysis.indirectJumps.end());
+
+    //every ROM byte that is not part of a reachable instruction is data
+    std::vector<bool> code(memorySize, false);
+    for(uint16_t address : analysis.instructions)
+    {
+        code[address] = true;
+        code[(address + 1) & 0xfff] = true;
+    }
+
+    for(uint16_t address = CHIP8::memoryImageOffset; address < romEnd; address++)
+    {
+        if(code[address])
+            continue;
+
+        if(analysis.dataRegions.empty() == false && analysis.dataRegions.back().end == address)
+            analysis.dataRegions.back().end++;
+        else
+            analysis.dataRegions.push_back(CHIP8_MemoryRange{ address, uint16_t(address + 1) });
+    }
+
+    findStores(analysis);
+
+    return analysis;
+}
+
+void CHIP8_Analyzer::findStores(CHIP8_Analysis& analysis) const
+{
+    std::vector<bool> code(memorySize, false);
+    for(uint16_t address : analysis.instructions)
+    {
+        code[address] = true;
+        code[(address + 1) & 0xfff] = true;
+    }
+
+    //I is only tracked inside a block, it is unknown at every block entry
+    for(const CHIP8_BasicBlock& block : analysis.blocks)
+    {
+        bool knownI = false;
+        uint16_t I = 0;
+
+        for(uint16_t address = block.start; address < block.end; address += 2)
+        {
+            const uint16_t opcode = fetch(address);
+            uint16_t length = 0;
+
+            if((opcode & 0xf000) == 0xa000)
+            {
+                knownI = true;
+                I = CHIP8::getNNN(opcode);
+            }
+            else if((opcode & 0xf0ff) == 0xf01e || (opcode & 0xf0ff) == 0xf029)
+                knownI = false;
+            else if((opcode & 0xf0ff) == 0xf033)
+                length = 3;
+            else if((opcode & 0xf0ff) == 0xf055)
+                length = CHIP8::getX(opcode) + 1;
+
+            if(length == 0)
+                continue;
+
+            if(knownI == false)
+            {
+                analysis.unresolvedStores.push_back(address);
+                continue;
+            }
+
+            for(uint16_t i = 0; i < length; i++)
+            {
+                if(code[(I + i) & 0xfff])
+                {
+                    analysis.selfModifyingStores.push_back(CHIP8_StoreInfo{ address,
+                        CHIP8_MemoryRange{ I, uint16_t(I + length) } });
+                    break;
+                }
+            }
+        }
+    }
+}
+
+std::string CHIP8_Analyzer::disassemble(uint16_t opcode)
+{
+    std::ostringstream out;
+    out << std::uppercase << std::hex;
+
+    const uint16_t x = CHIP8::getX(opcode);
+    const uint16_t y = CHIP8::getY(opcode);
+    const uint16_t n = CHIP8::getN(opcode);
+    const uint16_t nn = CHIP8::getNN(opcode);
+    const uint16_t nnn = CHIP8::getNNN(opcode);
+
+    static const char* arithmetic[] = { "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr };
+
+    if(isValid(opcode) == false)
+    {
+        out << "DW 0x" << std::setfill('0') << std::setw(4) << opcode;
+        return out.str();
+    }
+
+    switch (opcode & 0xf000)
+    {
+        case 0x0000: out << (opcode == 0x00e0 ? "CLS" : "RET"); break;
+        case 0x1000: out << "JP 0x" << nnn; break;
+        case 0x2000: out << "CALL 0x" << nnn; break;
+        case 0x3000: out << "SE V" << x << ", 0x" << nn; break;
+        case 0x4000: out << "SNE V" << x << ", 0x" << nn; break;
+        case 0x5000: out << "SE V" << x << ", V" << y; break;
+        case 0x6000: out << "LD V" << x << ", 0x" << nn; break;
+        case 0x7000: out << "ADD V" << x << ", 0x" << nn; break;
+        case 0x8000: out << arithmetic[n] << " V" << x << ", V" << y; break;
+        case 0x9000: out << "SNE V" << x << ", V" << y; break;
+        case 0xa000: out << "LD I, 0x" << nnn; break;
+        case 0xb000: out << "JP V0, 0x" << nnn; break;
+        case 0xc000: out << "RND V" << x << ", 0x" << nn; break;
+        case 0xd000: out << "DRW V" << x << ", V" << y << ", 0x" << n; break;
+        case 0xe000: out << (nn == 0x9e ? "SKP V" : "SKNP V") << x; break;
+        case 0xf000:
+            switch (nn)
+            {
+                case 0x07: out << "LD V" << x << ", DT"; break;
+                case 0x0a: out << "LD V" << x << ", K"; break;
+                case 0x15: out << "LD DT, V" << x; break;
+                case 0x18: out << "LD ST, V" << x; break;
+                case 0x1e: out << "ADD I, V" << x; break;
+                case 0x29: out << "LD F, V" << x; break;
+                case 0x33: out << "LD B, V" << x; break;
+                case 0x55: out << "LD [I], V" << x; break;
+                case 0x65: out << "LD V" << x << ", [I]"; break;
+            }
+            break;
+    }
+
+    return out.str();
+}
+
+const char* CHIP8_Analyzer::getTerminatorName(CHIP8_BlockTerminator terminator)
+{
+    switch (terminator)
+    {
+        case CHIP8_BlockTerminator::Fallthrough: return "fallthrough";
+        case CHIP8_BlockTerminator::Jump: return "jump";
+        case CHIP8_BlockTerminator::Call: return "call";
+        case CHIP8_BlockTerminator::Return: return "return";
+        case CHIP8_BlockTerminator::Skip: return "skip";
+        case CHIP8_BlockTerminator::Indirect: return "indirect";
+        case CHIP8_BlockTerminator::Invalid: return "invalid";
+    }
+    return "unknown";
+}
+
+std::string CHIP8_Analyzer::toJSON(const CHIP8_Analysis& analysis, const CHIP8_Analyzer& analyzer)
+{
+    std::ostringstream out;
+
+    auto list = [&](const std::vector<uint16_t>& values){
+        out << "[";
+        for(std::size_t i = 0; i < values.size(); i++)
+            out << (i ? ", " : "") << values[i];
+        out << "]";
+    };
+
+    out << "{\n  \"entry\": " << CHIP8::memoryImageOffset << ",\n  \"rom_end\": " << analysis.romEnd << ",\n";
+
+    out << "  \"instructions\": [";
+    for(std::size_t i = 0; i < analysis.instructions.size(); i++)
+    {
+        const uint16_t address = analysis.instructions[i];
+        const uint16_t opcode = analyzer.fetch(address);
+        out << (i ? "," : "") << "\n    {\"address\": " << address << ", \"opcode\": " << opcode
+            << ", \"text\": \"" << disassemble(opcode) << "\"}";
+    }
+    out << "\n  ],\n";
+
+    out << "  \"blocks\": [";
+    for(std::size_t i = 0; i < analysis.blocks.size(); i++)
+    {
+        const CHIP8_BasicBlock& block = analysis.blocks[i];
+        out << (i ? "," : "") << "\n    {\"start\": " << block.start << ", \"end\": " << block.end
+            << ", \"terminator\": \"" << getTerminatorName(block.terminator) << "\", \"successors\": ";
+        list(block.successors);
+        out << "}";
+    }
+    out << "\n  ],\n";
+
+    out << "  \"data_regions\": [";
+    for(std::size_t i = 0; i < analysis.dataRegions.size(); i++)
+        out << (i ? ", " : "") << "{\"start\": " << analysis.dataRegions[i].start
+            << ", \"end\": " << analysis.dataRegions[i].end << "}";
+    out << "],\n";
+
+    out << "  \"self_modifying_stores\": [";
+    for(std::size_t i = 0; i < analysis.selfModifyingStores.size(); i++)
+    {
+        const CHIP8_StoreInfo& store = analysis.selfModifyingStores[i];
+        out << (i ? ", " : "") << "{\"address\": " << store.address << ", \"target_start\": "
+            << store.target.start << ", \"target_end\": " << store.target.end << "}";
+    }
+    out << "],\n";
+
+    out << "  \"unresolved_stores\": ";
+    list(analysis.unresolvedStores);
+    out << ",\n  \"indirect_jumps\": ";
+    list(analysis.indirectJumps);
+    out << ",\n  \"invalid_instructions\": ";
+    list(analysis.invalidInstructions);
+    out << "\n}\n";
+
+    return out.str();
+}
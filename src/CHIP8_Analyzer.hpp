@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CHIP8.hpp"
+
+enum class CHIP8_BlockTerminator : uint8_t
+{
+    Fallthrough,  // next instruction is the start of another block
+    Jump,         // 1NNN
+    Call,         // 2NNN, successors are the subroutine and the return site
+    Return,       // 00EE
+    Skip,         // 3XNN, 4XNN, 5XY0, 9XY0, EX9E, EXA1
+    Indirect,     // BNNN, target depends on V0
+    Invalid       // invalid opcode or execution leaves the ROM
+};
+
+struct CHIP8_BasicBlock
+{
+    uint16_t start;
+    uint16_t end; // address after the last instruction
+    CHIP8_BlockTerminator terminator;
+    std::vector<uint16_t> successors;
+};
+
+struct CHIP8_MemoryRange
+{
+    uint16_t start;
+    uint16_t end; // exclusive
+};
+
+struct CHIP8_StoreInfo
+{
+    uint16_t address;     // FX33 / FX55 instruction
+    CHIP8_MemoryRange target;
+};
+
+struct CHIP8_Analysis
+{
+    uint16_t romEnd;
+
+    std::vector<uint16_t> instructions;          // reachable instruction addresses, sorted
+    std::vector<CHIP8_BasicBlock> blocks;        // sorted by start
+    std::vector<CHIP8_MemoryRange> dataRegions;  // ROM bytes never reached as code
+    std::vector<CHIP8_StoreInfo> selfModifyingStores;
+    std::vector<uint16_t> unresolvedStores;      // stores whose I is not known statically
+    std::vector<uint16_t> indirectJumps;
+    std::vector<uint16_t> invalidInstructions;
+
+    // index by address: true when a reachable instruction starts there
+    std::vector<bool> instructionStart;
+
+    const CHIP8_BasicBlock* findBlock(uint16_t address) const;
+};
+
+// Recursive-descent disassembler building a control-flow graph of the ROM from 0x200.
+class CHIP8_Analyzer
+{
+public:
+    static const int memorySize = 4096;
+
+private:
+    std::vector<uint8_t> memory;
+    uint16_t romEnd;
+
+public:
+    CHIP8_Analyzer(const uint8_t* rom, std::size_t size);
+
+    CHIP8_Analysis analyze() const;
+
+    uint16_t fetch(uint16_t address) const;
+
+    static std::string disassemble(uint16_t opcode);
+    static std::string toJSON(const CHIP8_Analysis& analysis, const CHIP8_Analyzer& analyzer);
+    static const char* getTerminatorName(CHIP8_BlockTerminator terminator);
+
+    static bool isValid(uint16_t opcode);
+    static bool isSkip(uint16_t opcode);
+    static bool endsBlock(uint16_t opcode);
+
+private:
+    void findStores(CHIP8_Analysis& analysis) const;
+};
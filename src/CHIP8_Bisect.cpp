@@ -0,0 +1,417 @@
+#include "CHIP8_Bisect.hpp"
+#include "CHIP8_Analyzer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+const uint64_t CHIP8_Bisect::defaultCheckpointFrames;
+const uint64_t CHIP8_Bisect::defaultRNGSeed;
+const int CHIP8_Bisect::reportedAddresses;
+
+void CHIP8_InputLog::hold(uint64_t frame, uint16_t keyMask)
+{
+    if(changes.empty() == false && changes.back().first == frame)
+        changes.back().second = keyMask;
+    else if(getKeyMask(frame) != keyMask)
+        changes.push_back(std::make_pair(frame, keyMask));
+}
+
+uint16_t CHIP8_InputLog::getKeyMask(uint64_t frame) const
+{
+    auto next = std::upper_bound(changes.begin(), changes.end(), frame,
+        [](uint64_t value, const std::pair<uint64_t, uint16_t>& change){
+            return value < change.first;
+        });
+    return next == changes.begin() ? 0 : (next - 1)->second;
+}
+
+std::size_t CHIP8_InputLog::getChangeCount() const
+{
+    return changes.size();
+}
+
+CHIP8_InputLog CHIP8_InputLog::fromFrames(const std::vector<uint16_t>& inputs)
+{
+    CHIP8_InputLog log;
+    for(std::size_t frame = 0; frame < inputs.size(); frame++)
+        log.hold(frame, inputs[frame]);
+    return log;
+}
+
+bool CHIP8_InputLog::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if(file.is_open() == false)
+        return false;
+
+    changes.clear();
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        if(line.empty() || line[0] == '#' || line[0] == '\r')
+            continue;
+
+        std::istringstream fields(line);
+        uint64_t frame;
+        unsigned keyMask;
+        const bool parsed = (bool)(fields >> std::dec >> frame >> std::hex >> keyMask);
+        if(parsed == false || keyMask > 0xffff
+            || (changes.empty() == false && frame < changes.back().first))
+        {
+            changes.clear();
+            return false;
+        }
+        hold(frame, (uint16_t)keyMask);
+    }
+    return true;
+}
+
+bool CHIP8_InputLog::save(const std::string& path) const
+{
+    std::ofstream file(path);
+    if(file.is_open() == false)
+        return false;
+
+    file << "# FRAME KEY_MASK\n" << std::uppercase << std::setfill('0');
+    for(const std::pair<uint64_t, uint16_t>& change : changes)
+        file << std::dec << change.first << " " << std::hex << std::setw(4) << change.second << "\n";
+    return file.good();
+}
+
+namespace
+{
+    // restores the progress into a frame as well, which CHIP8::restoreState() starts over
+    class ReplayVM : public CHIP8
+    {
+    public:
+        struct Checkpoint
+        {
+            CHIP8_State state;
+            int frameProgress;
+            bool waitingForKey;
+        };
+
+        ReplayVM(CHIP8_Mediator& Mediator)
+            : CHIP8(Mediator) { }
+
+        Checkpoint save() const
+        {
+            return Checkpoint{ saveState(), frameProgress, waitingForKey };
+        }
+
+        void restore(const Checkpoint& checkpoint)
+        {
+            restoreState(checkpoint.state);
+            frameProgress = checkpoint.frameProgress;
+            waitingForKey = checkpoint.waitingForKey;
+        }
+
+        // the first count instructions of a frame, on the engine runFrame() would use
+        void runInstructions(uint64_t count)
+        {
+            if(timing == CHIP8_Timing::Instructions)
+            {
+                runCycles(count);
+                return;
+            }
+
+            for(uint64_t i = 0; i < count && hasFaulted() == false; i++)
+            {
+                step();
+                if(waitingForKey)
+                    break;
+            }
+        }
+    };
+
+    struct Replay
+    {
+        CHIP8_Mediator mediator;
+        ReplayVM vm;
+        uint16_t keyMask;
+
+        Replay()
+            : vm(mediator), keyMask(0) { }
+
+        void holdKeys(uint16_t KeyMask)
+        {
+            if(KeyMask != keyMask)
+                mediator.updateKeyMask(KeyMask);
+            keyMask = KeyMask;
+        }
+
+        void runFrames(const CHIP8_InputLog& inputs, uint64_t frame, uint64_t end)
+        {
+            for(; frame < end && vm.hasFaulted() == false; frame++)
+            {
+                holdKeys(inputs.getKeyMask(frame));
+                vm.runFrame();
+            }
+        }
+    };
+
+    bool isAlike(const Replay& first, const Replay& second)
+    {
+        return first.vm.getStateHash() == second.vm.getStateHash()
+            && first.vm.getCycleCount() == second.vm.getCycleCount();
+    }
+
+    std::string formatRow(uint64_t row)
+    {
+        std::string text;
+        for(int x = CHIP8_CONSTANTS::frameWidth - 1; x >= 0; x--)
+            text += ((row >> x) & 1) ? '#' : '.';
+        return text;
+    }
+}
+
+CHIP8_Bisect::CHIP8_Bisect(const std::vector<uint8_t>& Image, const CHIP8_InputLog& Inputs)
+    : image(Image), inputs(Inputs), checkpointFrames(defaultCheckpointFrames), seed(defaultRNGSeed)
+{
+}
+
+void CHIP8_Bisect::setConfigurations(const Configuration& first, const Configuration& second)
+{
+    configurations[0] = first;
+    configurations[1] = second;
+}
+
+void CHIP8_Bisect::setCheckpointFrames(uint64_t frames)
+{
+    checkpointFrames = std::max<uint64_t>(frames, 1);
+}
+
+void CHIP8_Bisect::setSeed(uint64_t Seed)
+{
+    seed = Seed;
+}
+
+CHIP8_BisectResult CHIP8_Bisect::run(uint64_t frames)
+{
+    std::unique_ptr<Replay> replays[2];
+    ReplayVM::Checkpoint checkpoints[2];
+
+    for(int i = 0; i < 2; i++)
+    {
+        replays[i].reset(new Replay());
+        ReplayVM& vm = replays[i]->vm;
+
+        vm.setFaultLog(nullptr);
+        if(configurations[i])
+            configurations[i](vm);
+        vm.seedRNG(seed);
+        vm.loadMemoryImage(image.data(), image.size());
+        checkpoints[i] = vm.save();
+    }
+    Replay& first = *replays[0];
+    Replay& second = *replays[1];
+
+    auto restore = [&](){
+        first.vm.restore(checkpoints[0]);
+        second.vm.restore(checkpoints[1]);
+    };
+    auto keep = [&](){
+        checkpoints[0] = first.vm.save();
+        checkpoints[1] = second.vm.save();
+    };
+
+    CHIP8_BisectResult result = CHIP8_BisectResult();
+    std::ostringstream report;
+
+    if(isAlike(first, second) == false)
+    {
+        result.diverged = true;
+        result.first = first.vm.saveState();
+        result.second = second.vm.saveState();
+
+        report << "DIVERGENCE BEFORE THE FIRST FRAME\n" << describeDifference(result.first, result.second);
+        result.report = report.str();
+        return result;
+    }
+
+    //both runs advance in parallel from one checkpoint to the next while they stay alike
+    uint64_t matched = 0;
+    uint64_t mismatched = 0;
+    while(matched < frames)
+    {
+        const uint64_t end = std::min(frames, matched + checkpointFrames);
+
+        std::thread firstRun([&first, this, matched, end](){
+            first.runFrames(inputs, matched, end);
+        });
+        second.runFrames(inputs, matched, end);
+        firstRun.join();
+
+        if(isAlike(first, second) == false)
+        {
+            mismatched = end;
+            break;
+        }
+
+        matched = end;
+        keep();
+
+        //faulted alike, neither run changes any more
+        if(first.vm.hasFaulted() && second.vm.hasFaulted())
+            break;
+    }
+
+    if(mismatched == 0)
+    {
+        result.diverged = false;
+        result.frames = matched;
+        result.first = first.vm.saveState();
+        result.second = second.vm.saveState();
+
+        report << "NO DIVERGENCE IN " << matched << " FRAMES, " << first.vm.getCycleCount() << " CYCLES\n";
+        result.report = report.str();
+        return result;
+    }
+
+    //the frames between the last alike and the first mismatching checkpoint, every probe starts
+    //from the latest frame known to be alike
+    uint64_t low = matched;
+    uint64_t high = mismatched;
+    while(high - low > 1)
+    {
+        const uint64_t middle = low + (high - low) / 2;
+
+        restore();
+        first.runFrames(inputs, low, middle);
+        second.runFrames(inputs, low, middle);
+
+        if(isAlike(first, second))
+        {
+            low = middle;
+            keep();
+        }
+        else
+            high = middle;
+    }
+
+    //then the instructions of frame low, a prefix past a run's frame length stops before the
+    //timer tick, the whole frame is lengths + 1
+    const uint16_t keyMask = inputs.getKeyMask(low);
+    uint64_t lengths[2];
+    for(int i = 0; i < 2; i++)
+    {
+        replays[i]->vm.restore(checkpoints[i]);
+        replays[i]->holdKeys(keyMask);
+        replays[i]->vm.runFrame();
+        lengths[i] = replays[i]->vm.getCycleCount() - checkpoints[i].state.cycleCount;
+    }
+    const uint64_t frameLength = std::max(lengths[0], lengths[1]);
+
+    auto runPrefix = [&](uint64_t count){
+        for(int i = 0; i < 2; i++)
+        {
+            replays[i]->vm.restore(checkpoints[i]);
+            replays[i]->holdKeys(keyMask);
+            if(count > frameLength)
+                replays[i]->vm.runFrame();
+            else
+                replays[i]->vm.runInstructions(std::min(count, lengths[i]));
+        }
+    };
+
+    uint64_t lowCount = 0;
+    uint64_t highCount = frameLength + 1;
+    while(highCount - lowCount > 1)
+    {
+        const uint64_t middle = lowCount + (highCount - lowCount) / 2;
+
+        runPrefix(middle);
+        if(isAlike(first, second))
+            lowCount = middle;
+        else
+            highCount = middle;
+    }
+
+    runPrefix(highCount - 1);
+    result.before = first.vm.saveState();
+    runPrefix(highCount);
+    result.first = first.vm.saveState();
+    result.second = second.vm.saveState();
+
+    result.diverged = true;
+    result.frames = low + 1;
+    result.instruction = highCount;
+
+    const CHIP8_State& before = result.before;
+    report << "DIVERGENCE IN FRAME " << low;
+    if(highCount > frameLength)
+        report << " AT THE TIMER TICK ENDING IT\n";
+    else
+    {
+        const uint16_t opcode = (uint16_t(before.RAM[before.PC]) << 8) | before.RAM[before.PC + 1];
+        report << " AT INSTRUCTION " << highCount << " OF THE FRAME, CYCLE " << before.cycleCount << "\n"
+            << std::hex << std::uppercase << std::setfill('0')
+            << std::setw(3) << before.PC << "  " << std::setw(4) << opcode << "  " << CHIP8_Analyzer::disassemble(opcode) << "\n";
+    }
+    report << describeDifference(result.first, result.second);
+
+    result.report = report.str();
+    return result;
+}
+
+std::string CHIP8_Bisect::describeDifference(const CHIP8_State& first, const CHIP8_State& second)
+{
+    std::ostringstream text;
+    text << std::hex << std::uppercase << std::setfill('0');
+    text << "FIELD         FIRST   SECOND\n";
+
+    auto field = [&text](const std::string& name, uint64_t firstValue, uint64_t secondValue, int width){
+        if(firstValue != secondValue)
+            text << name << std::string(name.size() < 14 ? 14 - name.size() : 1, ' ')
+                << std::setw(width) << firstValue << std::string(width < 8 ? 8 - width : 1, ' ')
+                << std::setw(width) << secondValue << "\n";
+    };
+
+    for(std::size_t i = 0; i < first.V.size(); i++)
+    {
+        std::ostringstream name;
+        name << "V" << std::hex << std::uppercase << i;
+        field(name.str(), first.V[i], second.V[i], 2);
+    }
+    field("I", first.I, second.I, 3);
+    field("PC", first.PC, second.PC, 3);
+    field("SP", first.SP, second.SP, 2);
+    for(std::size_t i = 0; i < first.STACK.size(); i++)
+        field("STACK[" + std::to_string(i) + "]", first.STACK[i], second.STACK[i], 3);
+    field("DELAY", first.delayTimer, second.delayTimer, 2);
+    field("SOUND", first.soundTimer, second.soundTimer, 2);
+    field("RNG", first.rngState, second.rngState, 16);
+    field("FAULT", (int)first.fault.kind, (int)second.fault.kind, 2);
+    if(first.cycleCount != second.cycleCount)
+        text << "CYCLES        " << std::dec << first.cycleCount << "  " << second.cycleCount << std::hex << "\n";
+
+    int differentBytes = 0;
+    for(std::size_t address = 0; address < first.RAM.size(); address++)
+    {
+        if(first.RAM[address] == second.RAM[address])
+            continue;
+
+        if(differentBytes++ < reportedAddresses)
+        {
+            std::ostringstream name;
+            name << "RAM[" << std::hex << std::uppercase << std::setfill('0') << std::setw(3) << address << "]";
+            field(name.str(), first.RAM[address], second.RAM[address], 2);
+        }
+    }
+    if(differentBytes > reportedAddresses)
+        text << "... " << std::dec << differentBytes << " BYTES OF RAM DIFFER" << std::hex << "\n";
+
+    for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+    {
+        if(first.frameBuffer[y] != second.frameBuffer[y])
+            text << "ROW " << std::setw(2) << y << "  " << formatRow(first.frameBuffer[y])
+                << "\n        " << formatRow(second.frameBuffer[y]) << "\n";
+    }
+
+    return text.str();
+}
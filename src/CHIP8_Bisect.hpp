@@ -0,0 +1,75 @@
+#pragma once
+
+#include "CHIP8.hpp"
+
+#include <functional>
+
+// Key mask held during each frame of a replay, stored as the frames where it changes. Frames
+// past the last change hold the last mask.
+class CHIP8_InputLog
+{
+private:
+    std::vector<std::pair<uint64_t, uint16_t>> changes; // ascending frames
+
+public:
+    // the mask from frame on, frames have to be given in ascending order
+    void hold(uint64_t frame, uint16_t keyMask);
+    uint16_t getKeyMask(uint64_t frame) const;
+    std::size_t getChangeCount() const;
+
+    // one mask per frame, e.g. CHIP8_SearchResult::inputs
+    static CHIP8_InputLog fromFrames(const std::vector<uint16_t>& inputs);
+
+    // text, one "FRAME HEX_MASK" line per change, lines starting with # are comments
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+};
+
+struct CHIP8_BisectResult
+{
+    bool diverged;
+    uint64_t frames;      // frames replayed, up to and including the divergent one
+    uint64_t instruction; // 1-based within the divergent frame, past its length when only the timer tick differs
+
+    CHIP8_State before;   // the state both runs were in right before the divergence
+    CHIP8_State first;    // the states right after it
+    CHIP8_State second;
+
+    std::string report;
+};
+
+// Replays a ROM with an input log on two VM configurations, e.g. two engines, and finds the
+// first instruction after which their states differ. Both runs advance in parallel and
+// compare CHIP8::getStateHash() every checkpoint interval. Past the first mismatching
+// checkpoint the frames between it and the last matching one are bisected from a saved
+// checkpoint, then the instructions of the divergent frame, so only one interval is ever
+// replayed again however long the run.
+class CHIP8_Bisect
+{
+public:
+    typedef std::function<void(CHIP8& vm)> Configuration;
+
+    static const uint64_t defaultCheckpointFrames = 4096;
+    static const uint64_t defaultRNGSeed = 0x5eed;
+    static const int reportedAddresses = 16; // differing RAM bytes listed in the report
+
+private:
+    std::vector<uint8_t> image;
+    CHIP8_InputLog inputs;
+    Configuration configurations[2];
+    uint64_t checkpointFrames;
+    uint64_t seed;
+
+public:
+    CHIP8_Bisect(const std::vector<uint8_t>& Image, const CHIP8_InputLog& Inputs);
+
+    // applied to a new VM before the RNG is seeded and the ROM loaded
+    void setConfigurations(const Configuration& first, const Configuration& second);
+    void setCheckpointFrames(uint64_t frames);
+    void setSeed(uint64_t Seed);
+
+    // runFrame() once per frame, until the runs differ or both fault alike
+    CHIP8_BisectResult run(uint64_t frames);
+
+    static std::string describeDifference(const CHIP8_State& first, const CHIP8_State& second);
+};
@@ -0,0 +1,196 @@
+#include "CHIP8_BlockCompiler.hpp"
+#include "CHIP8.hpp"
+
+const int CHIP8_BlockCompiler::retryMilliseconds;
+
+CHIP8_BlockCompiler::CHIP8_BlockCompiler()
+    : compiling(false), compilerShouldStop(false)
+{
+    compilerThread = std::thread([this](){
+        compilerLoop();
+    });
+}
+
+CHIP8_BlockCompiler::~CHIP8_BlockCompiler()
+{
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+        compilerShouldStop = true;
+    }
+    pendingCV.notify_all();
+    compilerThread.join();
+}
+
+CHIP8_BlockCompiler& CHIP8_BlockCompiler::global()
+{
+    static CHIP8_BlockCompiler compiler;
+    return compiler;
+}
+
+void CHIP8_BlockCompiler::submit(std::shared_ptr<CHIP8_CompiledBlockQueue> target, uint16_t start, std::vector<uint8_t> source)
+{
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+        pending.push_back(Request{ target, start, std::move(source) });
+    }
+    pendingCV.notify_one();
+}
+
+void CHIP8_BlockCompiler::waitIdle()
+{
+    std::unique_lock<std::mutex> lck{mtx};
+    drainedCV.wait(lck, [this](){
+        return pending.empty() && compiling == false;
+    });
+}
+
+CHIP8_CompiledBlockPtr CHIP8_BlockCompiler::compile(uint16_t start, const std::vector<uint8_t>& source)
+{
+    std::shared_ptr<CHIP8_CompiledBlock> block = std::make_shared<CHIP8_CompiledBlock>();
+    block->start = start;
+
+    bool blockEnded = false;
+    std::size_t offset = 0;
+
+    for(; offset + 1 < source.size() && block->ops.size() < maxBlockInstructions && blockEnded == false; offset += 2)
+    {
+        const uint16_t opcode = (uint16_t(source[offset]) << 8) | source[offset + 1];
+        CHIP8_CompiledOp op = { CHIP8_CompiledOpKind::ClearScreen, (uint8_t)CHIP8::getX(opcode),
+            (uint8_t)CHIP8::getY(opcode), CHIP8::getNN(opcode) };
+        bool compilable = true;
+
+        switch(opcode & 0xf000)
+        {
+            case 0x0000:
+                compilable = opcode == 0x00e0;
+                break;
+            case 0x1000:
+                op.kind = CHIP8_CompiledOpKind::Jump;
+                op.operand = CHIP8::getNNN(opcode);
+                blockEnded = true;
+                break;
+            case 0x3000:
+                op.kind = CHIP8_CompiledOpKind::SkipEqualImmediate;
+                blockEnded = true;
+                break;
+            case 0x4000:
+                op.kind = CHIP8_CompiledOpKind::SkipNotEqualImmediate;
+                blockEnded = true;
+                break;
+            case 0x5000:
+                op.kind = CHIP8_CompiledOpKind::SkipEqual;
+                blockEnded = true;
+                break;
+            case 0x6000:
+                op.kind = CHIP8_CompiledOpKind::LoadImmediate;
+                break;
+            case 0x7000:
+                op.kind = CHIP8_CompiledOpKind::AddImmediate;
+                break;
+            case 0x8000:
+            {
+                static const CHIP8_CompiledOpKind arithmetic[] = {
+                    CHIP8_CompiledOpKind::Move, CHIP8_CompiledOpKind::Or, CHIP8_CompiledOpKind::And,
+                    CHIP8_CompiledOpKind::Xor, CHIP8_CompiledOpKind::Add, CHIP8_CompiledOpKind::Sub,
+                    CHIP8_CompiledOpKind::ShiftRight, CHIP8_CompiledOpKind::SubReverse
+                };
+                const uint16_t n = CHIP8::getN(opcode);
+                if(n < 8)
+                    op.kind = arithmetic[n];
+                else if(n == 0xe)
+                    op.kind = CHIP8_CompiledOpKind::ShiftLeft;
+                else
+                    compilable = false;
+            } break;
+            case 0x9000:
+                op.kind = CHIP8_CompiledOpKind::SkipNotEqual;
+                compilable = (opcode & 0x1) == 0;
+                blockEnded = true;
+                break;
+            case 0xa000:
+                op.kind = CHIP8_CompiledOpKind::LoadIndex;
+                op.operand = CHIP8::getNNN(opcode);
+                break;
+            case 0xc000:
+                op.kind = CHIP8_CompiledOpKind::Random;
+                break;
+            case 0xd000:
+                op.kind = CHIP8_CompiledOpKind::Draw;
+                op.operand = opcode;
+                break;
+            case 0xf000:
+                switch(opcode & 0xff)
+                {
+                    case 0x07: op.kind = CHIP8_CompiledOpKind::LoadDelay; break;
+                    case 0x15: op.kind = CHIP8_CompiledOpKind::SetDelay; break;
+                    case 0x18: op.kind = CHIP8_CompiledOpKind::SetSound; break;
+                    case 0x1e: op.kind = CHIP8_CompiledOpKind::AddIndex; break;
+                    case 0x29: op.kind = CHIP8_CompiledOpKind::LoadFont; break;
+                    default: compilable = false;
+                }
+                break;
+            default:
+                //2NNN, BNNN and EXNN are left to the interpreter
+                compilable = false;
+        }
+
+        if(compilable == false)
+            break;
+
+        block->ops.push_back(op);
+    }
+
+    block->source.assign(source.begin(), source.begin() + block->ops.size() * 2);
+    return block;
+}
+
+void CHIP8_BlockCompiler::compilerLoop()
+{
+    std::deque<Request> batch;
+    std::deque<Deferred> deferred;
+
+    const auto woken = [this](){
+        return pending.empty() == false || compilerShouldStop;
+    };
+
+    std::unique_lock<std::mutex> lck{mtx};
+    while(true)
+    {
+        //with blocks deferred the VM gets a moment to drain its queue before they are retried
+        if(deferred.empty())
+            pendingCV.wait(lck, woken);
+        else
+            pendingCV.wait_for(lck, std::chrono::milliseconds(retryMilliseconds), woken);
+
+        if(compilerShouldStop)
+            break;
+
+        batch.swap(pending);
+        compiling = true;
+        lck.unlock();
+
+        //a dropped block would leave its address interpreted for good, its counter stays saturated
+        for(std::size_t retries = deferred.size(); retries > 0; retries--)
+        {
+            const Deferred entry = deferred.front();
+            deferred.pop_front();
+
+            const std::shared_ptr<CHIP8_CompiledBlockQueue> target = entry.target.lock();
+            if(target && target->tryPush(entry.block) == false)
+                deferred.push_back(entry);
+        }
+
+        for(const Request& request : batch)
+        {
+            const CHIP8_CompiledBlockPtr block = compile(request.start, request.source);
+            if(request.target->tryPush(block) == false)
+                deferred.push_back(Deferred{ request.target, block });
+        }
+        batch.clear();
+
+        lck.lock();
+        compiling = false;
+        if(pending.empty())
+            drainedCV.notify_all();
+    }
+}
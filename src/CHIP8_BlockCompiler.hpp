@@ -0,0 +1,114 @@
+#pragma once
+
+#include "CHIP8_RingBuffer.hpp"
+
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+enum class CHIP8_CompiledOpKind : uint8_t
+{
+    ClearScreen,           // 00E0
+    Jump,                  // 1NNN
+    SkipEqualImmediate,    // 3XNN
+    SkipNotEqualImmediate, // 4XNN
+    SkipEqual,             // 5XY0
+    LoadImmediate,         // 6XNN
+    AddImmediate,          // 7XNN
+    Move,                  // 8XY0
+    Or,                    // 8XY1
+    And,                   // 8XY2
+    Xor,                   // 8XY3
+    Add,                   // 8XY4
+    Sub,                   // 8XY5
+    ShiftRight,            // 8XY6
+    SubReverse,            // 8XY7
+    ShiftLeft,             // 8XYE
+    SkipNotEqual,          // 9XY0
+    LoadIndex,             // ANNN
+    Random,                // CXNN
+    Draw,                  // DXYN
+    LoadDelay,             // FX07
+    SetDelay,              // FX15
+    SetSound,              // FX18
+    AddIndex,              // FX1E
+    LoadFont               // FX29
+};
+
+struct CHIP8_CompiledOp
+{
+    CHIP8_CompiledOpKind kind;
+    uint8_t x;
+    uint8_t y;
+    uint16_t operand; // NN, NNN or the whole DXYN opcode
+};
+
+// Straight-line translation of the instructions starting at start. Jumps and skips can
+// only be the last op; instructions that may fault, wait for a key or write RAM end the
+// block before them and are left to the interpreter.
+struct CHIP8_CompiledBlock
+{
+    uint16_t start;
+    std::vector<uint8_t> source; // the bytes the block was compiled from
+    std::vector<CHIP8_CompiledOp> ops;
+};
+
+typedef std::shared_ptr<const CHIP8_CompiledBlock> CHIP8_CompiledBlockPtr;
+
+// compiled blocks travel from the compiler thread to the VM thread through this queue
+typedef CHIP8_RingBuffer<CHIP8_CompiledBlockPtr> CHIP8_CompiledBlockQueue;
+
+// Compiles hot blocks on its own thread, so the VM keeps interpreting meanwhile.
+// One compiler is shared by every VM in the process unless a VM is given its own.
+class CHIP8_BlockCompiler
+{
+public:
+    static const int maxBlockInstructions = 32;
+    static const int retryMilliseconds = 1;
+
+private:
+    struct Request
+    {
+        std::shared_ptr<CHIP8_CompiledBlockQueue> target;
+        uint16_t start;
+        std::vector<uint8_t> source;
+    };
+
+    // a block the target queue was too full for, retried until the VM drains it or drops the queue
+    struct Deferred
+    {
+        std::weak_ptr<CHIP8_CompiledBlockQueue> target;
+        CHIP8_CompiledBlockPtr block;
+    };
+
+    std::mutex mtx;
+    std::condition_variable pendingCV;
+    std::condition_variable drainedCV;
+    std::deque<Request> pending;
+    bool compiling;
+    bool compilerShouldStop;
+
+    std::thread compilerThread;
+
+public:
+    CHIP8_BlockCompiler();
+    ~CHIP8_BlockCompiler();
+
+    static CHIP8_BlockCompiler& global();
+
+    // source holds the bytes from start on, the block is pushed to target when done
+    void submit(std::shared_ptr<CHIP8_CompiledBlockQueue> target, uint16_t start, std::vector<uint8_t> source);
+    // blocks waiting for room in a full queue don't count as pending
+    void waitIdle();
+
+    // returns a block without ops when the first instruction cannot be compiled
+    static CHIP8_CompiledBlockPtr compile(uint16_t start, const std::vector<uint8_t>& source);
+
+private:
+    void compilerLoop();
+};
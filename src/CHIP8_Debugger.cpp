@@ -0,0 +1,228 @@
+#include "CHIP8_Debugger.hpp"
+
+#include <algorithm>
+
+CHIP8_Debugger::CHIP8_Debugger(CHIP8& VM)
+    : vm(VM), lastStop(CHIP8_DebugStop{ CHIP8_StopReason::None, 0, 0, 0 }), cyclesSinceTick(0)
+{
+}
+
+void CHIP8_Debugger::addBreakpoint(uint16_t address)
+{
+    breakpoints.set(address & CHIP8_Memory::addressMask);
+}
+
+void CHIP8_Debugger::removeBreakpoint(uint16_t address)
+{
+    breakpoints.reset(address & CHIP8_Memory::addressMask);
+}
+
+void CHIP8_Debugger::addWatchpoint(uint16_t start, uint16_t end, CHIP8_WatchKind kind)
+{
+    for(uint16_t address = start; address < end && address < breakpoints.size(); address++)
+    {
+        if((uint8_t)kind & (uint8_t)CHIP8_WatchKind::Read)
+            readWatchpoints.set(address);
+        if((uint8_t)kind & (uint8_t)CHIP8_WatchKind::Write)
+            writeWatchpoints.set(address);
+    }
+}
+
+void CHIP8_Debugger::removeWatchpoint(uint16_t start, uint16_t end)
+{
+    for(uint16_t address = start; address < end && address < breakpoints.size(); address++)
+    {
+        readWatchpoints.reset(address);
+        writeWatchpoints.reset(address);
+    }
+}
+
+void CHIP8_Debugger::addRegisterCondition(uint8_t reg, CHIP8_RegisterCondition kind, uint8_t value)
+{
+    conditions.push_back(Condition{ (uint8_t)(reg & 0xf), kind, value });
+}
+
+void CHIP8_Debugger::clearRegisterConditions()
+{
+    conditions.clear();
+}
+
+void CHIP8_Debugger::clearAll()
+{
+    breakpoints.reset();
+    readWatchpoints.reset();
+    writeWatchpoints.reset();
+    conditions.clear();
+}
+
+bool CHIP8_Debugger::isArmed() const
+{
+    return breakpoints.any() || readWatchpoints.any() || writeWatchpoints.any() || conditions.empty() == false;
+}
+
+CHIP8_StopReason CHIP8_Debugger::stepInstruction()
+{
+    const uint16_t PC = vm.getProgramCounter();
+    if(vm.hasFaulted())
+        return stop(CHIP8_StopReason::Fault, PC);
+
+    const CHIP8_StopReason reason = executeChecked(PC, isWatchpointStop(PC) == false);
+    return reason != CHIP8_StopReason::None ? reason : stop(CHIP8_StopReason::Step, PC);
+}
+
+CHIP8_StopReason CHIP8_Debugger::continueExecution(uint64_t maxCycles)
+{
+    if(isArmed() == false)
+    {
+        //nothing to check, the VM runs at full speed up to every timer tick
+        while(maxCycles > 0 && vm.hasFaulted() == false)
+        {
+            const uint64_t batch = std::min<uint64_t>(maxCycles, vm.getInstructionsPerFrame() - cyclesSinceTick);
+            const uint64_t executed = vm.runCycles(batch);
+
+            maxCycles -= executed;
+            advanceTimers(executed);
+
+            if(vm.isWaitingForKey())
+                return stop(CHIP8_StopReason::KeyWait, vm.getProgramCounter());
+        }
+
+        if(vm.hasFaulted())
+            return stop(CHIP8_StopReason::Fault, vm.getFault().PC);
+        return stop(CHIP8_StopReason::None, vm.getProgramCounter());
+    }
+
+    //an instruction a breakpoint or watchpoint stopped is let through once, or the VM could never pass it
+    const bool resumingBreakpoint = lastStop.reason == CHIP8_StopReason::Breakpoint && lastStop.PC == vm.getProgramCounter();
+    const bool resumingWatchpoint = isWatchpointStop(vm.getProgramCounter());
+
+    for(uint64_t i = 0; i < maxCycles; i++)
+    {
+        const uint16_t PC = vm.getProgramCounter();
+        if(vm.hasFaulted())
+            return stop(CHIP8_StopReason::Fault, vm.getFault().PC);
+
+        if((i > 0 || resumingBreakpoint == false) && breakpoints.test(PC & CHIP8_Memory::addressMask))
+            return stop(CHIP8_StopReason::Breakpoint, PC);
+
+        const CHIP8_StopReason reason = executeChecked(PC, i > 0 || resumingWatchpoint == false);
+        if(reason != CHIP8_StopReason::None)
+            return reason;
+    }
+
+    return stop(CHIP8_StopReason::None, vm.getProgramCounter());
+}
+
+const CHIP8_DebugStop& CHIP8_Debugger::getLastStop() const
+{
+    return lastStop;
+}
+
+CHIP8& CHIP8_Debugger::getVM()
+{
+    return vm;
+}
+
+CHIP8_MemoryAccess CHIP8_Debugger::decodeMemoryAccess(uint16_t opcode, uint16_t I)
+{
+    const uint16_t x = CHIP8::getX(opcode);
+
+    switch(opcode & 0xf000)
+    {
+        case 0xd000:
+            return CHIP8_MemoryAccess{ I, (uint16_t)(I + CHIP8::getN(opcode)), false };
+
+        case 0xf000:
+            switch(opcode & 0xff)
+            {
+                case 0x33:
+                    return CHIP8_MemoryAccess{ I, (uint16_t)(I + 3), true };
+                case 0x55:
+                    return CHIP8_MemoryAccess{ I, (uint16_t)(I + x + 1), true };
+                case 0x65:
+                    return CHIP8_MemoryAccess{ I, (uint16_t)(I + x + 1), false };
+            }
+            break;
+    }
+
+    return CHIP8_MemoryAccess{ I, I, false };
+}
+
+const char* CHIP8_Debugger::getStopReasonName(CHIP8_StopReason reason)
+{
+    switch(reason)
+    {
+        case CHIP8_StopReason::None: return "CYCLE LIMIT";
+        case CHIP8_StopReason::Step: return "STEP";
+        case CHIP8_StopReason::Breakpoint: return "BREAKPOINT";
+        case CHIP8_StopReason::ReadWatchpoint: return "READ WATCHPOINT";
+        case CHIP8_StopReason::WriteWatchpoint: return "WRITE WATCHPOINT";
+        case CHIP8_StopReason::RegisterCondition: return "REGISTER CONDITION";
+        case CHIP8_StopReason::Fault: return "FAULT";
+        case CHIP8_StopReason::KeyWait: return "KEY WAIT";
+    }
+    return "UNKNOWN";
+}
+
+CHIP8_StopReason CHIP8_Debugger::stop(CHIP8_StopReason reason, uint16_t PC, uint16_t address, uint8_t reg)
+{
+    lastStop = CHIP8_DebugStop{ reason, PC, address, reg };
+    return reason;
+}
+
+bool CHIP8_Debugger::isWatchpointStop(uint16_t PC) const
+{
+    return (lastStop.reason == CHIP8_StopReason::ReadWatchpoint || lastStop.reason == CHIP8_StopReason::WriteWatchpoint)
+        && lastStop.PC == PC;
+}
+
+void CHIP8_Debugger::advanceTimers(uint64_t cycles)
+{
+    cyclesSinceTick += cycles;
+    while(cyclesSinceTick >= (uint64_t)vm.getInstructionsPerFrame())
+    {
+        cyclesSinceTick -= vm.getInstructionsPerFrame();
+        vm.tickTimers();
+    }
+}
+
+CHIP8_StopReason CHIP8_Debugger::executeChecked(uint16_t PC, bool checkWatchpoints)
+{
+    const CHIP8_Memory& RAM = vm.getMemory();
+    const std::vector<uint8_t>& V = vm.getRegisters();
+
+    if(checkWatchpoints && PC + 1 < CHIP8_Memory::memorySize)
+    {
+        const uint16_t opcode = (uint16_t(RAM[PC]) << 8) | RAM[PC + 1];
+        const CHIP8_MemoryAccess access = decodeMemoryAccess(opcode, vm.getIndexRegister());
+        const std::bitset<4096>& watched = access.write ? writeWatchpoints : readWatchpoints;
+
+        for(uint16_t address = access.start; address != access.end; address++)
+            if(watched.test(address & CHIP8_Memory::addressMask))
+                return stop(access.write ? CHIP8_StopReason::WriteWatchpoint : CHIP8_StopReason::ReadWatchpoint,
+                    PC, address & CHIP8_Memory::addressMask);
+    }
+
+    uint8_t before[16];
+    if(conditions.empty() == false)
+        std::copy(V.begin(), V.end(), before);
+
+    vm.step();
+
+    if(vm.hasFaulted())
+        return stop(CHIP8_StopReason::Fault, PC);
+    if(vm.isWaitingForKey())
+        return stop(CHIP8_StopReason::KeyWait, PC);
+
+    advanceTimers(1);
+
+    for(const Condition& condition : conditions)
+    {
+        const uint8_t value = V[condition.reg];
+        if(value != before[condition.reg]
+            && (condition.kind == CHIP8_RegisterCondition::Changed || value == condition.value))
+            return stop(CHIP8_StopReason::RegisterCondition, PC, 0, condition.reg);
+    }
+
+    return CHIP8_StopReason::None;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CHIP8.hpp"
+
+#include <bitset>
+
+enum class CHIP8_StopReason : uint8_t
+{
+    None,               // the cycle limit was reached
+    Step,
+    Breakpoint,
+    ReadWatchpoint,
+    WriteWatchpoint,
+    RegisterCondition,
+    Fault,
+    KeyWait             // FX0A is waiting for a key
+};
+
+enum class CHIP8_WatchKind : uint8_t
+{
+    Read = 1,
+    Write = 2,
+    ReadWrite = 3
+};
+
+enum class CHIP8_RegisterCondition : uint8_t
+{
+    Changed,  // any new value
+    Equals    // changes to the given value
+};
+
+struct CHIP8_DebugStop
+{
+    CHIP8_StopReason reason;
+    uint16_t PC;       // instruction about to run, or the one that changed a register
+    uint16_t address;  // watched address that would be accessed
+    uint8_t reg;       // register whose condition fired
+};
+
+struct CHIP8_MemoryAccess
+{
+    uint16_t start;
+    uint16_t end;      // exclusive, equal to start when nothing is accessed
+    bool write;
+};
+
+// Drives a VM for debugging. Breakpoints and watchpoints are bitmaps and the memory an
+// instruction touches is predecoded before it runs, so watchpoints stop the VM before the
+// access happens. While nothing is armed continueExecution() hands whole batches to
+// CHIP8::runCycles(), leaving the VM's own dispatch untouched. The timers tick once every
+// getInstructionsPerFrame() instructions, as they would under runFrame().
+class CHIP8_Debugger
+{
+private:
+    struct Condition
+    {
+        uint8_t reg;
+        CHIP8_RegisterCondition kind;
+        uint8_t value;
+    };
+
+    CHIP8& vm;
+
+    std::bitset<4096> breakpoints;
+    std::bitset<4096> readWatchpoints;
+    std::bitset<4096> writeWatchpoints;
+    std::vector<Condition> conditions;
+
+    CHIP8_DebugStop lastStop;
+    uint64_t cyclesSinceTick;
+
+public:
+    CHIP8_Debugger(CHIP8& VM);
+
+    void addBreakpoint(uint16_t address);
+    void removeBreakpoint(uint16_t address);
+    void addWatchpoint(uint16_t start, uint16_t end, CHIP8_WatchKind kind); // end is exclusive
+    void removeWatchpoint(uint16_t start, uint16_t end);
+    void addRegisterCondition(uint8_t reg, CHIP8_RegisterCondition kind, uint8_t value = 0);
+    void clearRegisterConditions();
+    void clearAll();
+
+    bool isArmed() const;
+
+    // a watchpoint stop at the current PC is stepped over, like a breakpoint by continueExecution()
+    CHIP8_StopReason stepInstruction();
+    // a breakpoint or watchpoint stop at the current PC is stepped over, so continuing from a stop makes progress
+    CHIP8_StopReason continueExecution(uint64_t maxCycles);
+
+    const CHIP8_DebugStop& getLastStop() const;
+    CHIP8& getVM();
+
+    static CHIP8_MemoryAccess decodeMemoryAccess(uint16_t opcode, uint16_t I);
+    static const char* getStopReasonName(CHIP8_StopReason reason);
+
+private:
+    CHIP8_StopReason stop(CHIP8_StopReason reason, uint16_t PC, uint16_t address = 0, uint8_t reg = 0);
+    bool isWatchpointStop(uint16_t PC) const;
+    void advanceTimers(uint64_t cycles);
+    CHIP8_StopReason executeChecked(uint16_t PC, bool checkWatchpoints);
+};
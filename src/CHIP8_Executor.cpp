@@ -0,0 +1,143 @@
+#include "CHIP8_Executor.hpp"
+
+bool CHIP8_Executor::ScheduledTask::operator<(const ScheduledTask& other) const
+{
+    //std::priority_queue pops the largest element, the earliest deadline has to compare as the largest
+    if(deadline != other.deadline)
+        return deadline > other.deadline;
+    return sequence > other.sequence;
+}
+
+CHIP8_Executor::CHIP8_Executor(unsigned threadCount, bool RealTime)
+    : realTime(RealTime), nextSequence(0), unfinishedTasks(0), workersShouldStop(false)
+{
+    if(threadCount == 0)
+        threadCount = 1;
+
+    for(unsigned i = 0; i < threadCount; i++)
+        workers.emplace_back([this](){
+            workerLoop();
+        });
+}
+
+CHIP8_Executor::~CHIP8_Executor()
+{
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+        workersShouldStop = true;
+    }
+    workCV.notify_all();
+
+    for(auto& worker : workers)
+        worker.join();
+}
+
+std::size_t CHIP8_Executor::add(CHIP8& vm, uint64_t maxFrames)
+{
+    std::unique_lock<std::mutex> lck{mtx};
+
+    const std::size_t id = tasks.size();
+    tasks.push_back(Task{ &vm, maxFrames, 0, CHIP8_YieldReason::FrameEnd, Clock::now(), false });
+    unfinishedTasks++;
+
+    schedule(id, Clock::now());
+    return id;
+}
+
+void CHIP8_Executor::waitAll()
+{
+    std::unique_lock<std::mutex> lck{mtx};
+    doneCV.wait(lck, [this](){
+        return unfinishedTasks == 0;
+    });
+}
+
+uint64_t CHIP8_Executor::getFramesRun(std::size_t id)
+{
+    std::unique_lock<std::mutex> lck{mtx};
+    return tasks.at(id).framesRun;
+}
+
+CHIP8_YieldReason CHIP8_Executor::getLastYield(std::size_t id)
+{
+    std::unique_lock<std::mutex> lck{mtx};
+    return tasks.at(id).lastYield;
+}
+
+bool CHIP8_Executor::isFinished(std::size_t id)
+{
+    std::unique_lock<std::mutex> lck{mtx};
+    return tasks.at(id).finished;
+}
+
+void CHIP8_Executor::schedule(std::size_t id, Clock::time_point deadline)
+{
+    tasks[id].deadline = deadline;
+    runQueue.push(ScheduledTask{ deadline, nextSequence++, id });
+    workCV.notify_one();
+}
+
+void CHIP8_Executor::workerLoop()
+{
+    const Clock::duration framePeriod = std::chrono::microseconds(1000000 / 60);
+    const Clock::duration keyWaitPollInterval = std::chrono::milliseconds(keyWaitPollIntervalInMiliseconds);
+
+    std::unique_lock<std::mutex> lck{mtx};
+
+    while(true)
+    {
+        workCV.wait(lck, [this](){
+            return workersShouldStop || runQueue.empty() == false;
+        });
+
+        if(workersShouldStop)
+            break;
+
+        const ScheduledTask next = runQueue.top();
+        if(next.deadline > Clock::now())
+        {
+            workCV.wait_until(lck, next.deadline);
+            continue;
+        }
+        runQueue.pop();
+
+        Task& task = tasks[next.id];
+        CHIP8* vm = task.vm;
+
+        uint64_t framesToRun = realTime ? 1 : batchFramesPerSlice;
+        if(task.maxFrames != 0)
+            framesToRun = std::min(framesToRun, task.maxFrames - task.framesRun);
+
+        lck.unlock();
+
+        uint64_t framesRun = 0;
+        CHIP8_YieldReason reason = CHIP8_YieldReason::FrameEnd;
+        while(framesRun < framesToRun)
+        {
+            reason = vm->runFrame();
+            if(reason != CHIP8_YieldReason::FrameEnd)
+                break;
+            framesRun++;
+        }
+
+        lck.lock();
+
+        task.framesRun += framesRun;
+        task.lastYield = reason;
+
+        const bool limitReached = task.maxFrames != 0 && task.framesRun >= task.maxFrames;
+
+        if(reason == CHIP8_YieldReason::Fault || reason == CHIP8_YieldReason::Stopped || limitReached)
+        {
+            task.finished = true;
+            if(--unfinishedTasks == 0)
+                doneCV.notify_all();
+        }
+        else if(reason == CHIP8_YieldReason::KeyWait)
+            schedule(next.id, Clock::now() + keyWaitPollInterval);
+        else if(realTime)
+            schedule(next.id, std::max(task.deadline + framePeriod, Clock::now() - framePeriod));
+        else
+            schedule(next.id, Clock::now());
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CHIP8.hpp"
+
+#include <queue>
+
+// Runs many VMs on a few threads. Every VM is resumed with runFrame(), so a VM only
+// occupies a worker between two yields and needs no thread of its own.
+class CHIP8_Executor
+{
+public:
+    static const int batchFramesPerSlice = 8;
+    static const int keyWaitPollIntervalInMiliseconds = 16;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Task
+    {
+        CHIP8* vm;
+        uint64_t maxFrames; // 0 runs until the VM faults or is stopped
+        uint64_t framesRun;
+        CHIP8_YieldReason lastYield;
+        Clock::time_point deadline;
+        bool finished;
+    };
+
+    struct ScheduledTask
+    {
+        Clock::time_point deadline;
+        uint64_t sequence;
+        std::size_t id;
+
+        bool operator<(const ScheduledTask& other) const;
+    };
+
+    const bool realTime;
+
+    std::mutex mtx;
+    std::condition_variable workCV;
+    std::condition_variable doneCV;
+
+    std::deque<Task> tasks;
+    std::priority_queue<ScheduledTask> runQueue;
+    uint64_t nextSequence;
+    std::size_t unfinishedTasks;
+    bool workersShouldStop;
+
+    std::vector<std::thread> workers;
+
+public:
+    // with realTime every VM runs at 60 frames per second, otherwise as fast as possible
+    CHIP8_Executor(unsigned threadCount = std::thread::hardware_concurrency(), bool RealTime = false);
+    ~CHIP8_Executor();
+
+    std::size_t add(CHIP8& vm, uint64_t maxFrames = 0);
+    void waitAll();
+
+    uint64_t getFramesRun(std::size_t id);
+    CHIP8_YieldReason getLastYield(std::size_t id);
+    bool isFinished(std::size_t id);
+
+private:
+    void schedule(std::size_t id, Clock::time_point deadline);
+    void workerLoop();
+};
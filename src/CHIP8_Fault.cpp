@@ -0,0 +1,109 @@
+#include "CHIP8_Fault.hpp"
+
+#include <iostream>
+
+const char* getFaultKindName(CHIP8_FaultKind kind)
+{
+    switch (kind)
+    {
+        case CHIP8_FaultKind::None:
+            return "NONE";
+        case CHIP8_FaultKind::InvalidOpcode:
+            return "INVALID OPCODE";
+        case CHIP8_FaultKind::MachineCodeRoutine:
+            return "MACHINE CODE ROUTINE NOT IMPLEMENTED";
+        case CHIP8_FaultKind::StackOverflow:
+            return "STACK OVERFLOW";
+        case CHIP8_FaultKind::StackUnderflow:
+            return "STACK UNDERFLOW";
+        case CHIP8_FaultKind::ForbiddenMemoryAccess:
+            return "FORBIDDEN MEMORY ACCESS";
+        case CHIP8_FaultKind::InvalidKey:
+            return "INVALID KEY";
+    }
+    return "UNKNOWN";
+}
+
+CHIP8_FaultLog::CHIP8_FaultLog(std::ostream& Output)
+    : output(Output), writing(false), writerShouldStop(false), droppedFaults(0)
+{
+    writerThread = std::thread([this](){
+        writerLoop();
+    });
+}
+
+CHIP8_FaultLog::~CHIP8_FaultLog()
+{
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+        writerShouldStop = true;
+    }
+    pendingCV.notify_all();
+    writerThread.join();
+}
+
+CHIP8_FaultLog& CHIP8_FaultLog::global()
+{
+    static CHIP8_FaultLog log(std::cout);
+    return log;
+}
+
+void CHIP8_FaultLog::post(const CHIP8_Fault& fault)
+{
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+        if(pending.size() >= maxPendingFaults)
+        {
+            droppedFaults.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        pending.push_back(fault);
+    }
+    pendingCV.notify_one();
+}
+
+void CHIP8_FaultLog::flush()
+{
+    std::unique_lock<std::mutex> lck{mtx};
+    drainedCV.wait(lck, [this](){
+        return pending.empty() && writing == false;
+    });
+}
+
+uint64_t CHIP8_FaultLog::getDroppedFaults() const
+{
+    return droppedFaults.load(std::memory_order_relaxed);
+}
+
+void CHIP8_FaultLog::writerLoop()
+{
+    std::deque<CHIP8_Fault> batch;
+
+    std::unique_lock<std::mutex> lck{mtx};
+    while(true)
+    {
+        pendingCV.wait(lck, [this](){
+            return pending.empty() == false || writerShouldStop;
+        });
+
+        if(pending.empty() && writerShouldStop)
+            break;
+
+        batch.swap(pending);
+        writing = true;
+        lck.unlock();
+
+        for(const CHIP8_Fault& fault : batch)
+        {
+            output << "CHIP8 FAULT: " << getFaultKindName(fault.kind) << std::hex
+                << " AT PC " << fault.PC << " OPCODE " << fault.opcode
+                << std::dec << " CYCLE " << fault.cycle << '\n';
+        }
+        output.flush();
+        batch.clear();
+
+        lck.lock();
+        writing = false;
+        drainedCV.notify_all();
+    }
+}
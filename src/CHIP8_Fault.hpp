@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+enum class CHIP8_FaultKind : uint8_t
+{
+    None,
+    InvalidOpcode,
+    MachineCodeRoutine,
+    StackOverflow,
+    StackUnderflow,
+    ForbiddenMemoryAccess,
+    InvalidKey
+};
+
+const char* getFaultKindName(CHIP8_FaultKind kind);
+
+struct CHIP8_Fault
+{
+    CHIP8_FaultKind kind;
+    uint16_t PC;
+    uint16_t opcode;
+    uint64_t cycle;
+};
+
+// Formats faults on its own thread, so a VM that faults never waits on the output stream.
+// One log is shared by every VM in the process unless a VM is given its own.
+class CHIP8_FaultLog
+{
+public:
+    static const int maxPendingFaults = 1024;
+
+private:
+    std::ostream& output;
+
+    std::mutex mtx;
+    std::condition_variable pendingCV;
+    std::condition_variable drainedCV;
+    std::deque<CHIP8_Fault> pending;
+    bool writing;
+    bool writerShouldStop;
+
+    std::atomic<uint64_t> droppedFaults;
+    std::thread writerThread;
+
+public:
+    CHIP8_FaultLog(std::ostream& Output);
+    ~CHIP8_FaultLog();
+
+    static CHIP8_FaultLog& global();
+
+    void post(const CHIP8_Fault& fault);
+    void flush();
+
+    uint64_t getDroppedFaults() const;
+
+private:
+    void writerLoop();
+};
@@ -0,0 +1,255 @@
+#include "CHIP8_FrameBlender.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHIP8_BLEND_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is compiled per function and picked at run time, the rest of the build stays baseline
+#if defined(CHIP8_BLEND_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHIP8_BLEND_AVX2
+#include <immintrin.h>
+#endif
+
+const int CHIP8_FrameBlender::pixelCount;
+const int CHIP8_FrameBlender::rowBytes;
+const uint8_t CHIP8_FrameBlender::defaultDecay;
+
+// Every kernel computes, per pixel:
+//   brightness = max(lit ? 255 : 0, brightness * decay / 256)
+//   channel = color * (brightness + 1) / 256, which is exactly color when fully lit
+// and returns whether a dark pixel is still visible.
+namespace
+{
+    typedef bool (*BlendKernel)(const uint64_t* rows, uint8_t* brightness, const uint8_t* color,
+                                uint8_t decay, uint8_t* rgba, std::size_t stride);
+
+    bool blendScalar(const uint64_t* rows, uint8_t* brightness, const uint8_t* color,
+                        uint8_t decay, uint8_t* rgba, std::size_t stride)
+    {
+        uint8_t fading = 0;
+
+        for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++, brightness += CHIP8_CONSTANTS::frameWidth, rgba += stride)
+        {
+            for(int x = 0; x < CHIP8_CONSTANTS::frameWidth; x++)
+            {
+                const uint8_t lit = ((rows[y] >> (CHIP8_CONSTANTS::frameWidth - 1 - x)) & 1) ? 0xff : 0;
+                const uint8_t value = std::max<uint8_t>(lit, (brightness[x] * decay) >> 8);
+                brightness[x] = value;
+                fading |= value & ~lit;
+
+                for(int channel = 0; channel < 3; channel++)
+                    rgba[4 * x + channel] = (color[channel] * (value + 1)) >> 8;
+                rgba[4 * x + 3] = 0xff;
+            }
+        }
+        return fading != 0;
+    }
+
+#ifdef CHIP8_BLEND_SSE2
+    // 8 brightness values plus one in 16 bit lanes to 8 RGBA pixels
+    inline void storePixelsSSE2(__m128i value, __m128i red, __m128i green, __m128i blue, uint8_t* rgba)
+    {
+        const __m128i r = _mm_srli_epi16(_mm_mullo_epi16(value, red), 8);
+        const __m128i g = _mm_srli_epi16(_mm_mullo_epi16(value, green), 8);
+        const __m128i b = _mm_srli_epi16(_mm_mullo_epi16(value, blue), 8);
+
+        const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        const __m128i ba = _mm_or_si128(b, _mm_set1_epi16((short)0xff00));
+        _mm_storeu_si128((__m128i*)rgba, _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128((__m128i*)(rgba + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+
+    bool blendSSE2(const uint64_t* rows, uint8_t* brightness, const uint8_t* color,
+                    uint8_t decay, uint8_t* rgba, std::size_t stride)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i decay16 = _mm_set1_epi16(decay);
+        const __m128i red = _mm_set1_epi16(color[0]);
+        const __m128i green = _mm_set1_epi16(color[1]);
+        const __m128i blue = _mm_set1_epi16(color[2]);
+        const __m128i bitMask = _mm_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+        __m128i fading = zero;
+
+        for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++, brightness += CHIP8_CONSTANTS::frameWidth, rgba += stride)
+        {
+            for(int chunk = 0; chunk < 4; chunk++)
+            {
+                //the 16 pixels' bits with the leftmost 8 in the first byte, each byte repeated 8 times
+                const uint32_t bits = (uint32_t)(rows[y] >> (48 - 16 * chunk)) & 0xffff;
+                __m128i lit = _mm_cvtsi32_si128((bits >> 8) | ((bits & 0xff) << 8));
+                lit = _mm_unpacklo_epi8(lit, lit);
+                lit = _mm_unpacklo_epi16(lit, lit);
+                lit = _mm_unpacklo_epi32(lit, lit);
+                lit = _mm_cmpeq_epi8(_mm_and_si128(lit, bitMask), bitMask);
+
+                __m128i* previous = (__m128i*)(brightness + 16 * chunk);
+                const __m128i old = _mm_loadu_si128(previous);
+                const __m128i low = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(old, zero), decay16), 8);
+                const __m128i high = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(old, zero), decay16), 8);
+                const __m128i value = _mm_max_epu8(_mm_packus_epi16(low, high), lit);
+                _mm_storeu_si128(previous, value);
+                fading = _mm_or_si128(fading, _mm_andnot_si128(lit, value));
+
+                uint8_t* pixels = rgba + 64 * chunk;
+                storePixelsSSE2(_mm_add_epi16(_mm_unpacklo_epi8(value, zero), one), red, green, blue, pixels);
+                storePixelsSSE2(_mm_add_epi16(_mm_unpackhi_epi8(value, zero), one), red, green, blue, pixels + 32);
+            }
+        }
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(fading, zero)) != 0xffff;
+    }
+#endif
+
+#ifdef CHIP8_BLEND_AVX2
+    // 8 brightness values plus one per 128 bit lane to 4 RGBA pixels per lane, as unpacks stay
+    // within lanes: first holds pixels 0-3 of both lanes, second pixels 4-7
+    __attribute__((target("avx2")))
+    inline void makePixelsAVX2(__m256i value, __m256i red, __m256i green, __m256i blue, __m256i& first, __m256i& second)
+    {
+        const __m256i r = _mm256_srli_epi16(_mm256_mullo_epi16(value, red), 8);
+        const __m256i g = _mm256_srli_epi16(_mm256_mullo_epi16(value, green), 8);
+        const __m256i b = _mm256_srli_epi16(_mm256_mullo_epi16(value, blue), 8);
+
+        const __m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+        const __m256i ba = _mm256_or_si256(b, _mm256_set1_epi16((short)0xff00));
+        first = _mm256_unpacklo_epi16(rg, ba);
+        second = _mm256_unpackhi_epi16(rg, ba);
+    }
+
+    __attribute__((target("avx2")))
+    bool blendAVX2(const uint64_t* rows, uint8_t* brightness, const uint8_t* color,
+                    uint8_t decay, uint8_t* rgba, std::size_t stride)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi16(1);
+        const __m256i decay16 = _mm256_set1_epi16(decay);
+        const __m256i red = _mm256_set1_epi16(color[0]);
+        const __m256i green = _mm256_set1_epi16(color[1]);
+        const __m256i blue = _mm256_set1_epi16(color[2]);
+        const __m256i bitMask = _mm256_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1,
+                                                -128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+        const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                                2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+        __m256i fading = zero;
+
+        for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++, brightness += CHIP8_CONSTANTS::frameWidth, rgba += stride)
+        {
+            for(int chunk = 0; chunk < 2; chunk++)
+            {
+                //the 32 pixels' bits with the leftmost 8 in the first byte, each byte repeated 8 times
+                const uint32_t bits = __builtin_bswap32((uint32_t)(rows[y] >> (32 - 32 * chunk)));
+                __m256i lit = _mm256_shuffle_epi8(_mm256_set1_epi32((int)bits), spread);
+                lit = _mm256_cmpeq_epi8(_mm256_and_si256(lit, bitMask), bitMask);
+
+                __m256i* previous = (__m256i*)(brightness + 32 * chunk);
+                const __m256i old = _mm256_loadu_si256(previous);
+                const __m256i low = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(old, zero), decay16), 8);
+                const __m256i high = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(old, zero), decay16), 8);
+                const __m256i value = _mm256_max_epu8(_mm256_packus_epi16(low, high), lit);
+                _mm256_storeu_si256(previous, value);
+                fading = _mm256_or_si256(fading, _mm256_andnot_si256(lit, value));
+
+                //low holds pixels 0-7 and 16-23, high 8-15 and 24-31
+                __m256i p0, p1, p2, p3;
+                makePixelsAVX2(_mm256_add_epi16(_mm256_unpacklo_epi8(value, zero), one), red, green, blue, p0, p1);
+                makePixelsAVX2(_mm256_add_epi16(_mm256_unpackhi_epi8(value, zero), one), red, green, blue, p2, p3);
+
+                __m256i* pixels = (__m256i*)(rgba + 128 * chunk);
+                _mm256_storeu_si256(pixels, _mm256_permute2x128_si256(p0, p1, 0x20));
+                _mm256_storeu_si256(pixels + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+                _mm256_storeu_si256(pixels + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+                _mm256_storeu_si256(pixels + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+            }
+        }
+        return _mm256_testz_si256(fading, fading) == 0;
+    }
+#endif
+
+    BlendKernel getKernelFunction(CHIP8_BlendKernel kernel)
+    {
+        switch(kernel)
+        {
+#ifdef CHIP8_BLEND_SSE2
+            case CHIP8_BlendKernel::SSE2: return blendSSE2;
+#endif
+#ifdef CHIP8_BLEND_AVX2
+            case CHIP8_BlendKernel::AVX2: return blendAVX2;
+#endif
+            default: return blendScalar;
+        }
+    }
+}
+
+CHIP8_FrameBlender::CHIP8_FrameBlender(uint8_t red, uint8_t green, uint8_t blue, uint8_t Decay)
+    : color{red, green, blue, 0xff}, decay(Decay), kernel(getBestKernel()), fading(false)
+{
+    clear();
+}
+
+void CHIP8_FrameBlender::setDecay(uint8_t Decay)
+{
+    decay = Decay;
+}
+
+bool CHIP8_FrameBlender::setKernel(CHIP8_BlendKernel Kernel)
+{
+    if(isSupported(Kernel) == false)
+        return false;
+
+    kernel = Kernel;
+    return true;
+}
+
+CHIP8_BlendKernel CHIP8_FrameBlender::getKernel() const
+{
+    return kernel;
+}
+
+bool CHIP8_FrameBlender::isSupported(CHIP8_BlendKernel kernel)
+{
+    switch(kernel)
+    {
+        case CHIP8_BlendKernel::Scalar:
+            return true;
+#ifdef CHIP8_BLEND_SSE2
+        case CHIP8_BlendKernel::SSE2:
+            return true;
+#endif
+#ifdef CHIP8_BLEND_AVX2
+        case CHIP8_BlendKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+CHIP8_BlendKernel CHIP8_FrameBlender::getBestKernel()
+{
+    if(isSupported(CHIP8_BlendKernel::AVX2))
+        return CHIP8_BlendKernel::AVX2;
+    if(isSupported(CHIP8_BlendKernel::SSE2))
+        return CHIP8_BlendKernel::SSE2;
+    return CHIP8_BlendKernel::Scalar;
+}
+
+bool CHIP8_FrameBlender::blend(const CHIP8_FrameBuffer& frameBuffer, uint8_t* rgba, std::size_t stride)
+{
+    fading = getKernelFunction(kernel)(frameBuffer.data(), brightness, color, decay, rgba, stride);
+    return fading;
+}
+
+bool CHIP8_FrameBlender::isFading() const
+{
+    return fading;
+}
+
+void CHIP8_FrameBlender::clear()
+{
+    std::memset(brightness, 0, sizeof(brightness));
+    fading = false;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CHIP8_Mediator.hpp"
+
+#include <cstdint>
+#include <cstddef>
+
+enum class CHIP8_BlendKernel : uint8_t
+{
+    Scalar,
+    SSE2,   // 16 pixels at a time
+    AVX2    // 32 pixels at a time, chosen at run time on CPUs that have it
+};
+
+// Phosphor persistence for the display. Every blend() lights the pixels that are on in the
+// frame at full brightness and fades the rest by a fixed fraction of their brightness, so a
+// sprite that a game erases and redraws shows as a slight dimming instead of flicker. The
+// brightness buffer holds the decayed history of all earlier frames, one byte per pixel.
+class CHIP8_FrameBlender
+{
+public:
+    static const int pixelCount = CHIP8_CONSTANTS::frameWidth * CHIP8_CONSTANTS::frameHeight;
+    static const int rowBytes = CHIP8_CONSTANTS::frameWidth * 4; // one RGBA row
+    static const uint8_t defaultDecay = 128; // a dark pixel keeps half its brightness per blend
+
+private:
+    uint8_t brightness[pixelCount];
+    uint8_t color[4];
+    uint8_t decay;
+    CHIP8_BlendKernel kernel;
+    bool fading;
+
+public:
+    CHIP8_FrameBlender(uint8_t red, uint8_t green, uint8_t blue, uint8_t Decay = defaultDecay);
+
+    // Decay out of 256 is what a dark pixel keeps per blend, 0 turns blending off
+    void setDecay(uint8_t Decay);
+    // false when the CPU can't run it, the kernel is then left as it was
+    bool setKernel(CHIP8_BlendKernel Kernel);
+    CHIP8_BlendKernel getKernel() const;
+    static bool isSupported(CHIP8_BlendKernel kernel);
+    static CHIP8_BlendKernel getBestKernel();
+
+    // One persistence step, then frameWidth x frameHeight RGBA pixels written to rgba, rows
+    // stride bytes apart. Returns isFading().
+    bool blend(const CHIP8_FrameBuffer& frameBuffer, uint8_t* rgba, std::size_t stride = rowBytes);
+    // true while a dark pixel is still visible, blend() has to run again without a new frame
+    bool isFading() const;
+    void clear();
+};
@@ -0,0 +1,193 @@
+#include "CHIP8_FrameCapture.hpp"
+
+#include <chrono>
+#include <cstring>
+
+// same green as the GUI
+const uint8_t CHIP8_FrameCapture::foregroundColor[3] = { 66, 253, 110 };
+
+namespace
+{
+    // full range BT.601, which is what C420jpeg streams use
+    uint8_t toLuma(const uint8_t* rgb)
+    {
+        return (uint8_t)(0.299 * rgb[0] + 0.587 * rgb[1] + 0.114 * rgb[2] + 0.5);
+    }
+
+    uint8_t toBlueChroma(const uint8_t* rgb)
+    {
+        return (uint8_t)(128 - 0.168736 * rgb[0] - 0.331264 * rgb[1] + 0.5 * rgb[2] + 0.5);
+    }
+
+    uint8_t toRedChroma(const uint8_t* rgb)
+    {
+        return (uint8_t)(128 + 0.5 * rgb[0] - 0.418688 * rgb[1] - 0.081312 * rgb[2] + 0.5);
+    }
+
+    bool isLit(const uint64_t* rows, int x, int y)
+    {
+        return (rows[y] >> (CHIP8_CONSTANTS::frameWidth - 1 - x)) & 1;
+    }
+}
+
+CHIP8_FrameCapture::CHIP8_FrameCapture(const std::string& filename, CHIP8_CaptureFormat Format, int Scale,
+    std::size_t capacity)
+    : ring(capacity), format(Format), scale(Scale < 1 ? 1 : Scale), output(nullptr),
+    writerShouldStop(false), capturedFrames(0), droppedFrames(0)
+{
+    if(filename == "-")
+    {
+        //the frames get standard output to themselves, anything else printed through std::cout,
+        //like the fault log, goes to standard error from here on
+        std::cout.flush();
+        output.rdbuf(std::cout.rdbuf());
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+    else
+    {
+        file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(file.good() == false)
+            return;
+        output.rdbuf(file.rdbuf());
+    }
+
+    const std::size_t pixels = (std::size_t)getWidth() * getHeight();
+    image.resize(format == CHIP8_CaptureFormat::Y4M ? pixels + pixels / 2 : pixels * 3);
+
+    if(format == CHIP8_CaptureFormat::Y4M)
+        output << "YUV4MPEG2 W" << getWidth() << " H" << getHeight() << " F60:1 Ip A1:1 C420jpeg\n";
+
+    writerThread = std::thread([this](){
+        writerLoop();
+    });
+}
+
+CHIP8_FrameCapture::~CHIP8_FrameCapture()
+{
+    writerShouldStop.store(true);
+    if(writerThread.joinable())
+        writerThread.join();
+}
+
+bool CHIP8_FrameCapture::isOpen() const
+{
+    return writerThread.joinable() && output.good();
+}
+
+int CHIP8_FrameCapture::getWidth() const
+{
+    return CHIP8_CONSTANTS::frameWidth * scale;
+}
+
+int CHIP8_FrameCapture::getHeight() const
+{
+    return CHIP8_CONSTANTS::frameHeight * scale;
+}
+
+void CHIP8_FrameCapture::onFrame(const CHIP8_FrameBuffer& frameBuffer)
+{
+    CapturedFrame frame;
+    std::copy(frameBuffer.begin(), frameBuffer.end(), frame.rows);
+
+    if(ring.tryPush(frame))
+        capturedFrames.fetch_add(1, std::memory_order_relaxed);
+    else
+        droppedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t CHIP8_FrameCapture::getCapturedFrames() const
+{
+    return capturedFrames.load(std::memory_order_relaxed);
+}
+
+uint64_t CHIP8_FrameCapture::getDroppedFrames() const
+{
+    return droppedFrames.load(std::memory_order_relaxed);
+}
+
+void CHIP8_FrameCapture::writerLoop()
+{
+    std::vector<CapturedFrame> batch(writerBatchSize);
+
+    while(true)
+    {
+        const bool lastPass = writerShouldStop.load();
+        const std::size_t count = ring.popMany(batch.data(), batch.size());
+
+        for(std::size_t i = 0; i < count; i++)
+            writeFrame(batch[i]);
+
+        if(count == 0 && lastPass)
+            break;
+        if(count == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    output.flush();
+}
+
+void CHIP8_FrameCapture::writeFrame(const CapturedFrame& frame)
+{
+    if(format == CHIP8_CaptureFormat::Y4M)
+    {
+        convertY4M(frame);
+        output << "FRAME\n";
+    }
+    else
+        convertRGB(frame);
+
+    output.write((const char*)image.data(), image.size());
+}
+
+void CHIP8_FrameCapture::convertY4M(const CapturedFrame& frame)
+{
+    static const uint8_t black[3] = { 0, 0, 0 };
+    const uint8_t luma[2] = { toLuma(black), toLuma(foregroundColor) };
+    const uint8_t blueChroma[2] = { toBlueChroma(black), toBlueChroma(foregroundColor) };
+    const uint8_t redChroma[2] = { toRedChroma(black), toRedChroma(foregroundColor) };
+
+    const int width = getWidth();
+    const int height = getHeight();
+
+    //each source row is scaled once and copied to the other scale - 1 rows
+    for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+    {
+        uint8_t* row = &image[(std::size_t)y * scale * width];
+        for(int x = 0; x < CHIP8_CONSTANTS::frameWidth; x++)
+            std::memset(row + x * scale, luma[isLit(frame.rows, x, y)], scale);
+        for(int copy = 1; copy < scale; copy++)
+            std::memcpy(row + copy * width, row, width);
+    }
+
+    //chroma is subsampled 2x2, taking the top left pixel of every block
+    uint8_t* blue = &image[(std::size_t)width * height];
+    uint8_t* red = blue + (width / 2) * (height / 2);
+    for(int y = 0; y < height / 2; y++)
+    {
+        for(int x = 0; x < width / 2; x++)
+        {
+            const bool lit = isLit(frame.rows, 2 * x / scale, 2 * y / scale);
+            blue[y * (width / 2) + x] = blueChroma[lit];
+            red[y * (width / 2) + x] = redChroma[lit];
+        }
+    }
+}
+
+void CHIP8_FrameCapture::convertRGB(const CapturedFrame& frame)
+{
+    static const uint8_t black[3] = { 0, 0, 0 };
+    const std::size_t rowBytes = (std::size_t)getWidth() * 3;
+
+    for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+    {
+        uint8_t* row = &image[y * scale * rowBytes];
+        for(int x = 0; x < CHIP8_CONSTANTS::frameWidth; x++)
+        {
+            const uint8_t* color = isLit(frame.rows, x, y) ? foregroundColor : black;
+            for(int i = 0; i < scale; i++)
+                std::memcpy(row + (x * scale + i) * 3, color, 3);
+        }
+        for(int copy = 1; copy < scale; copy++)
+            std::memcpy(row + copy * rowBytes, row, rowBytes);
+    }
+}
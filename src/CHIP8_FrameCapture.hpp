@@ -0,0 +1,73 @@
+#pragma once
+
+#include "CHIP8_Mediator.hpp"
+#include "CHIP8_RingBuffer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <atomic>
+
+enum class CHIP8_CaptureFormat : uint8_t
+{
+    Y4M,    // YUV4MPEG2, 4:2:0 at 60 frames per second
+    RawRGB  // headerless RGB24 frames, e.g. for ffmpeg -f rawvideo -pix_fmt rgb24
+};
+
+// Records every published frame. The VM thread only copies the 256 byte frame into a ring
+// buffer; scaling, conversion and I/O happen on the writer thread into buffers allocated
+// once. Frames are dropped rather than stalling the VM when the writer falls behind.
+// Without display wait every draw publishes a frame, so the video runs faster than the VM.
+class CHIP8_FrameCapture : public CHIP8_FrameListener
+{
+public:
+    static const int defaultScale = 10;
+    static const int defaultCapacity = 256;
+    static const int writerBatchSize = 16;
+
+    static const uint8_t foregroundColor[3];
+
+private:
+    struct CapturedFrame
+    {
+        uint64_t rows[CHIP8_CONSTANTS::frameHeight];
+    };
+
+    CHIP8_RingBuffer<CapturedFrame> ring;
+    const CHIP8_CaptureFormat format;
+    const int scale;
+
+    std::ofstream file;
+    std::ostream output; // the file, or standard output for "-"
+
+    std::vector<uint8_t> image; // one converted frame, Y4M planes or RGB rows
+
+    std::thread writerThread;
+    std::atomic<bool> writerShouldStop;
+    std::atomic<uint64_t> capturedFrames;
+    std::atomic<uint64_t> droppedFrames;
+
+public:
+    // filename "-" writes to standard output, for piping into an encoder, and points std::cout
+    // at standard error for the rest of the process
+    CHIP8_FrameCapture(const std::string& filename, CHIP8_CaptureFormat Format, int Scale = defaultScale,
+        std::size_t capacity = defaultCapacity);
+    ~CHIP8_FrameCapture();
+
+    bool isOpen() const;
+
+    int getWidth() const;
+    int getHeight() const;
+
+    void onFrame(const CHIP8_FrameBuffer& frameBuffer) override;
+
+    uint64_t getCapturedFrames() const; // frames queued for the writer
+    uint64_t getDroppedFrames() const;
+
+private:
+    void writerLoop();
+    void writeFrame(const CapturedFrame& frame);
+    void convertY4M(const CapturedFrame& frame);
+    void convertRGB(const CapturedFrame& frame);
+};
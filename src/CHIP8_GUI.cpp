@@ -1,23 +1,17 @@
 #include "CHIP8_GUI.hpp"
 
-CHIP8_GUI::CHIP8_GUI(std::string filepath)
-    : mediator(), chip8VM(mediator), frameBuffer(CHIP8_CONSTANTS::frameHeight,
-        std::vector<bool>(CHIP8_CONSTANTS::frameWidth, false)), 
+CHIP8_GUI::CHIP8_GUI(std::string filepath, CHIP8_Tracer* tracer)
+    : mediator(), chip8VM(mediator), frameBuffer(CHIP8_CONSTANTS::frameHeight, 0),
         keyArray(CHIP8_CONSTANTS::keyArraySize, false),
-        brick(sf::Vector2f(brickSize, brickSize)),
-        brickColor(sf::Color(66, 253, 110))
+        rowPixels(CHIP8_CONSTANTS::frameWidth * 4),
+        brickColor(sf::Color(66, 253, 110)), blender(brickColor.r, brickColor.g, brickColor.b), blending(false),
+        framePacing(CHIP8_FramePacing::FixedRate)
 {
+    chip8VM.setTracer(tracer);
 
-    if(chip8VM.loadMemoryImage(filepath))
-    {
-        chip8Thread = std::thread([this](){
-            chip8VM.run();
-        });
-    }
-    else
+    romLoaded = chip8VM.loadMemoryImage(filepath);
+    if(romLoaded == false)
         std::cout << "UNABLE TO OPEN A FILE!" << std::endl;
-    
-    brick.setFillColor(brickColor);
 }
 
 CHIP8_GUI::~CHIP8_GUI()
@@ -27,146 +21,243 @@ CHIP8_GUI::~CHIP8_GUI()
         chip8Thread.join();
 }
 
+CHIP8& CHIP8_GUI::getVM()
+{
+    return chip8VM;
+}
+
+CHIP8_Metrics& CHIP8_GUI::getMetrics()
+{
+    return mediator.getMetrics();
+}
+
+CHIP8_Mediator& CHIP8_GUI::getMediator()
+{
+    return mediator;
+}
+
+void CHIP8_GUI::setFramePacing(CHIP8_FramePacing FramePacing)
+{
+    framePacing = FramePacing;
+}
+
+void CHIP8_GUI::setBlending(bool Blending)
+{
+    blending = Blending;
+    blendedPixels.resize(blending ? CHIP8_FrameBlender::pixelCount * 4 : 0);
+}
+
+void CHIP8_GUI::uploadRows(uint32_t changedRows)
+{
+    for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+    {
+        if((changedRows & (1u << y)) == 0)
+            continue;
+
+        for(int x = 0; x < CHIP8_CONSTANTS::frameWidth; x++)
+        {
+            const sf::Color color = getPixel(frameBuffer, x, y) ? brickColor : sf::Color::Black;
+            rowPixels[4 * x] = color.r;
+            rowPixels[4 * x + 1] = color.g;
+            rowPixels[4 * x + 2] = color.b;
+            rowPixels[4 * x + 3] = color.a;
+        }
+
+        screenTexture.update(rowPixels.data(), CHIP8_CONSTANTS::frameWidth, 1, 0, y);
+    }
+}
+
 void CHIP8_GUI::run()
 {
     window.create(sf::VideoMode(CHIP8_CONSTANTS::frameWidth * brickSize,
                     CHIP8_CONSTANTS::frameHeight * brickSize),
                     "CHIP8 v1.0", sf::Style::Titlebar | sf::Style::Close);
 
-    window.setFramerateLimit(100);
+    if(framePacing == CHIP8_FramePacing::FixedRate)
+        window.setFramerateLimit(100);
+    else
+        window.setVerticalSyncEnabled(framePacing == CHIP8_FramePacing::VSync);
+
+    screenTexture.create(CHIP8_CONSTANTS::frameWidth, CHIP8_CONSTANTS::frameHeight);
+    screen.setTexture(screenTexture);
+    screen.setScale(brickSize, brickSize);
+    uploadRows(CHIP8_CONSTANTS::allRowsDirty);
 
+    if(romLoaded)
+    {
+        chip8Thread = std::thread([this](){
+            chip8VM.run();
+        });
+    }
+
+    bool redraw = true; // the blank screen is shown before the first frame
     while (window.isOpen())
     {
-        while (window.pollEvent(event))
+        //fading pixels are redrawn once per tick even when the VM publishes nothing
+        if(framePacing != CHIP8_FramePacing::FixedRate && (waitForFrame() || blender.isFading()))
+            redraw = true;
+
+        //input is polled right before presenting, so the frame shown is as fresh as the keys
+        pollInput();
+
+        if(framePacing == CHIP8_FramePacing::FixedRate || redraw)
         {
-            //  1	2	3	C
-            //  4	5	6	D
-            //  7	8	9	E
-            //  A	0	B	F
-            // Keyboard
-            if (event.type == sf::Event::Closed)
-            {
-                mediator.stopCHIP8();
-                window.close();
-            }
-            else if (event.type == sf::Event::KeyPressed)
+            present();
+            redraw = false;
+        }
+    }
+}
+
+void CHIP8_GUI::pollInput()
+{
+    while (window.pollEvent(event))
+    {
+        const CHIP8_LatencyTracker::Clock::time_point inputTime = CHIP8_LatencyTracker::Clock::now();
+
+        //  1	2	3	C
+        //  4	5	6	D
+        //  7	8	9	E
+        //  A	0	B	F
+        // Keyboard
+        if (event.type == sf::Event::Closed)
+        {
+            mediator.stopCHIP8();
+            window.close();
+        }
+        else if (event.type == sf::Event::KeyPressed)
+        {
+            switch (event.key.code)
             {
-                switch (event.key.code)
-                {
-                    case sf::Keyboard::Num1:
-                        keyArray[0x1] = true; break;
-
-                    case sf::Keyboard::Num2:
-                        keyArray[0x2] = true; break;
-
-                    case sf::Keyboard::Num3:
-                        keyArray[0x3] = true; break;
-
-                    case sf::Keyboard::Num4:
-                        keyArray[0xc] = true; break;
-
-                    case sf::Keyboard::Q:
-                        keyArray[0x4] = true; break;
-
-                    case sf::Keyboard::W:
-                        keyArray[0x5] = true; break;
-                    
-                    case sf::Keyboard::E:
-                        keyArray[0x6] = true; break;
-
-                    case sf::Keyboard::R:
-                        keyArray[0xd] = true; break;
-                    
-                    case sf::Keyboard::A:
-                        keyArray[0x7] = true; break;
-                    
-                    case sf::Keyboard::S:
-                        keyArray[0x8] = true; break;
-                    
-                    case sf::Keyboard::D:
-                        keyArray[0x9] = true; break;
-                    
-                    case sf::Keyboard::F:
-                        keyArray[0xe] = true; break;
-                    
-                    case sf::Keyboard::Z:
-                        keyArray[0xa] = true; break;
-                    
-                    case sf::Keyboard::X:
-                        keyArray[0x0] = true; break;
-                    
-                    case sf::Keyboard::C:
-                        keyArray[0xb] = true; break;
-                    
-                    case sf::Keyboard::V:
-                        keyArray[0xf] = true; break;
-                    default:
-                        break;
-                }
-                mediator.updateKeyArray(keyArray);
+                case sf::Keyboard::Num1:
+                    keyArray[0x1] = true; break;
+
+                case sf::Keyboard::Num2:
+                    keyArray[0x2] = true; break;
+
+                case sf::Keyboard::Num3:
+                    keyArray[0x3] = true; break;
+
+                case sf::Keyboard::Num4:
+                    keyArray[0xc] = true; break;
+
+                case sf::Keyboard::Q:
+                    keyArray[0x4] = true; break;
+
+                case sf::Keyboard::W:
+                    keyArray[0x5] = true; break;
+                
+                case sf::Keyboard::E:
+                    keyArray[0x6] = true; break;
+
+                case sf::Keyboard::R:
+                    keyArray[0xd] = true; break;
+                
+                case sf::Keyboard::A:
+                    keyArray[0x7] = true; break;
+                
+                case sf::Keyboard::S:
+                    keyArray[0x8] = true; break;
+                
+                case sf::Keyboard::D:
+                    keyArray[0x9] = true; break;
+                
+                case sf::Keyboard::F:
+                    keyArray[0xe] = true; break;
+                
+                case sf::Keyboard::Z:
+                    keyArray[0xa] = true; break;
+                
+                case sf::Keyboard::X:
+                    keyArray[0x0] = true; break;
+                
+                case sf::Keyboard::C:
+                    keyArray[0xb] = true; break;
+                
+                case sf::Keyboard::V:
+                    keyArray[0xf] = true; break;
+                default:
+                    break;
             }
-            else if (event.type == sf::Event::KeyReleased)
+            mediator.updateKeyArray(keyArray, inputTime);
+        }
+        else if (event.type == sf::Event::KeyReleased)
+        {
+            switch (event.key.code)
             {
-                switch (event.key.code)
-                {
-                    case sf::Keyboard::Num1:
-                        keyArray[0x1] = false; break;
-
-                    case sf::Keyboard::Num2:
-                        keyArray[0x2] = false; break;
-
-                    case sf::Keyboard::Num3:
-                        keyArray[0x3] = false; break;
-
-                    case sf::Keyboard::Num4:
-                        keyArray[0xc] = false; break;
-
-                    case sf::Keyboard::Q:
-                        keyArray[0x4] = false; break;
-
-                    case sf::Keyboard::W:
-                        keyArray[0x5] = false; break;
-                    
-                    case sf::Keyboard::E:
-                        keyArray[0x6] = false; break;
-
-                    case sf::Keyboard::R:
-                        keyArray[0xd] = false; break;
-                    
-                    case sf::Keyboard::A:
-                        keyArray[0x7] = false; break;
-                    
-                    case sf::Keyboard::S:
-                        keyArray[0x8] = false; break;
-                    
-                    case sf::Keyboard::D:
-                        keyArray[0x9] = false; break;
-                    
-                    case sf::Keyboard::F:
-                        keyArray[0xe] = false; break;
-                    
-                    case sf::Keyboard::Z:
-                        keyArray[0xa] = false; break;
-                    
-                    case sf::Keyboard::X:
-                        keyArray[0x0] = false; break;
-                    
-                    case sf::Keyboard::C:
-                        keyArray[0xb] = false; break;
-                    
-                    case sf::Keyboard::V:
-                        keyArray[0xf] = false; break;
-                    default:
-                        break;
-                }
-                mediator.updateKeyArray(keyArray);
+                case sf::Keyboard::Num1:
+                    keyArray[0x1] = false; break;
+
+                case sf::Keyboard::Num2:
+                    keyArray[0x2] = false; break;
+
+                case sf::Keyboard::Num3:
+                    keyArray[0x3] = false; break;
+
+                case sf::Keyboard::Num4:
+                    keyArray[0xc] = false; break;
+
+                case sf::Keyboard::Q:
+                    keyArray[0x4] = false; break;
+
+                case sf::Keyboard::W:
+                    keyArray[0x5] = false; break;
+                
+                case sf::Keyboard::E:
+                    keyArray[0x6] = false; break;
+
+                case sf::Keyboard::R:
+                    keyArray[0xd] = false; break;
+                
+                case sf::Keyboard::A:
+                    keyArray[0x7] = false; break;
+                
+                case sf::Keyboard::S:
+                    keyArray[0x8] = false; break;
+                
+                case sf::Keyboard::D:
+                    keyArray[0x9] = false; break;
+                
+                case sf::Keyboard::F:
+                    keyArray[0xe] = false; break;
+                
+                case sf::Keyboard::Z:
+                    keyArray[0xa] = false; break;
+                
+                case sf::Keyboard::X:
+                    keyArray[0x0] = false; break;
+                
+                case sf::Keyboard::C:
+                    keyArray[0xb] = false; break;
+                
+                case sf::Keyboard::V:
+                    keyArray[0xf] = false; break;
+                default:
+                    break;
             }
+            mediator.updateKeyArray(keyArray, inputTime);
         }
+    }
+}
 
-        //framebuffer changed?
+void CHIP8_GUI::present()
+{
+    {
+        //render time leaves out display(), which waits for the frame rate limit
+        CHIP8_MetricsTimer renderTimer(mediator.getMetrics(), CHIP8_Metric::RenderNanoseconds);
+
+        //framebuffer changed? only the rows that changed are uploaded to the texture
+        uint32_t changedRows = 0;
         if(mediator.hasFrameBufferChanged())
-            frameBuffer = mediator.getNewFrameBuffer();
-        
+            frameBuffer = mediator.getNewFrameBuffer(changedRows);
+
+        if(blending == false)
+            uploadRows(changedRows);
+        else if(changedRows != 0 || blender.isFading())
+        {
+            blender.blend(frameBuffer, blendedPixels.data());
+            screenTexture.update(blendedPixels.data());
+        }
+
         //beep...
         if(mediator.isSoundEffect())
         {
@@ -175,20 +266,26 @@ void CHIP8_GUI::run()
 
         //drawing
         window.clear(sf::Color::Black);
+        window.draw(screen);
+    }
 
-        brick.setPosition(sf::Vector2f(0.0f, 0.0f));
-        for(auto& row : frameBuffer)
-        {
-            for(auto cell : row)
-            {
-                if(cell)
-                    window.draw(brick);
-                brick.move(sf::Vector2f(brickSize, 0.0f));
-            }
+    window.display();
+    mediator.getMetrics().add(CHIP8_Metric::FramesRendered, 1);
+    mediator.getLatency().framePresented();
+    lastPresent = std::chrono::steady_clock::now();
+}
 
-            brick.setPosition(sf::Vector2f(0.0f, brick.getPosition().y + brickSize));
-        }
+bool CHIP8_GUI::waitForFrame()
+{
+    const std::chrono::milliseconds tick(CHIP8_CONSTANTS::timersTickDurationInMiliseconds);
 
-        window.display();
-    }
+    //without a new frame input is still polled once per tick
+    if(mediator.waitForFrameBuffer(std::chrono::steady_clock::now() + tick) == false)
+        return false;
+
+    //draws published sooner than a tick after the last present are shown together, vsync
+    //paces display() on its own
+    if(framePacing == CHIP8_FramePacing::FrameReady)
+        std::this_thread::sleep_until(lastPresent + tick);
+    return true;
 }
\ No newline at end of file
@@ -1,8 +1,18 @@
+#pragma once
+
 #include "CHIP8.hpp"
+#include "CHIP8_FrameBlender.hpp"
 #include <SFML/Window.hpp>
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio/Sound.hpp>
 
+enum class CHIP8_FramePacing
+{
+    FixedRate,  // redraw at 100 Hz whether or not the VM published a frame
+    FrameReady, // present when the VM publishes a frame, at most once per 60 Hz tick
+    VSync       // present when the VM publishes a frame, display() waits for vertical sync
+};
+
 class CHIP8_GUI
 {
 public:
@@ -11,18 +21,42 @@ private:
     CHIP8 chip8VM;
     CHIP8_Mediator mediator;
     std::thread chip8Thread;
+    bool romLoaded;
 
-    std::vector<std::vector<bool>> frameBuffer;
+    CHIP8_FrameBuffer frameBuffer;
     std::vector<bool> keyArray;
 
     sf::RenderWindow window;
-	sf::RectangleShape brick;
+	sf::Texture screenTexture;
+	sf::Sprite screen;
+	std::vector<sf::Uint8> rowPixels;
 	sf::Event event;
 
     sf::Color brickColor;
+
+    // with blending the whole screen is blended and uploaded at once, rows are not tracked
+    CHIP8_FrameBlender blender;
+    bool blending;
+    std::vector<sf::Uint8> blendedPixels;
+
+    CHIP8_FramePacing framePacing;
+    std::chrono::steady_clock::time_point lastPresent;
 public:
-    CHIP8_GUI(std::string filepath);
+    CHIP8_GUI(std::string filepath, CHIP8_Tracer* tracer = nullptr);
     ~CHIP8_GUI();
 
+    // the VM can be configured until run() starts its thread
+    CHIP8& getVM();
+    CHIP8_Metrics& getMetrics();
+    CHIP8_Mediator& getMediator();
+    void setFramePacing(CHIP8_FramePacing FramePacing); // before run()
+    void setBlending(bool Blending); // phosphor persistence against sprite flicker, before run()
+
     void run();
+
+private:
+    void uploadRows(uint32_t changedRows);
+    void pollInput();
+    void present();
+    bool waitForFrame(); // true when the VM published a frame to present
 };
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// 64-bit hashing of VM state. RAM bytes and frame buffer rows contribute independent
+// values which are XORed together, so a write updates the hash by XORing out the old
+// contribution and XORing in the new one instead of rehashing 4 KB.
+namespace CHIP8_HASH
+{
+    // splitmix64 finalizer
+    inline uint64_t mix(uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    // zero bytes and empty rows contribute nothing, so cleared memory hashes to 0
+    inline uint64_t RAMByte(uint16_t address, uint8_t value)
+    {
+        return value ? mix(((uint64_t)address << 8) | value) : 0;
+    }
+
+    inline uint64_t frameRow(int y, uint64_t pixels)
+    {
+        return pixels ? mix(pixels ^ mix(0x10000 + y)) : 0;
+    }
+
+    inline uint64_t combine(uint64_t hash, uint64_t value)
+    {
+        return mix(hash ^ value) + 0x9e3779b97f4a7c15ull;
+    }
+}
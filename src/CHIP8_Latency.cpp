@@ -0,0 +1,187 @@
+#include "CHIP8_Latency.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+const int CHIP8_LatencyTracker::abandonAfterMiliseconds;
+
+CHIP8_LatencyHistogram::CHIP8_LatencyHistogram()
+    : count(0), maximum(0)
+{
+    std::fill(buckets, buckets + bucketCount, 0);
+}
+
+void CHIP8_LatencyHistogram::record(uint64_t microseconds)
+{
+    buckets[getBucket(microseconds)]++;
+    count++;
+    maximum = std::max(maximum, microseconds);
+}
+
+uint64_t CHIP8_LatencyHistogram::getCount() const
+{
+    return count;
+}
+
+uint64_t CHIP8_LatencyHistogram::getMaximum() const
+{
+    return maximum;
+}
+
+uint64_t CHIP8_LatencyHistogram::getPercentile(double fraction) const
+{
+    if(count == 0)
+        return 0;
+
+    const uint64_t target = std::max<uint64_t>(1, (uint64_t)std::ceil(fraction * count));
+    uint64_t seen = 0;
+
+    for(int bucket = 0; bucket < bucketCount; bucket++)
+    {
+        seen += buckets[bucket];
+        if(seen >= target)
+            return std::min(getBucketLimit(bucket), maximum);
+    }
+    return maximum;
+}
+
+int CHIP8_LatencyHistogram::getBucket(uint64_t microseconds)
+{
+    if(microseconds < linearBuckets)
+        return (int)microseconds;
+
+    int exponent = 4;
+    while(exponent < 31 && (microseconds >> (exponent + 1)) != 0)
+        exponent++;
+
+    if((microseconds >> (exponent + 1)) != 0)
+        return bucketCount - 1;
+
+    const int subBucket = (int)(microseconds >> (exponent - 3)) & (subBuckets - 1);
+    return linearBuckets + (exponent - 4) * subBuckets + subBucket;
+}
+
+uint64_t CHIP8_LatencyHistogram::getBucketLimit(int bucket)
+{
+    if(bucket < linearBuckets)
+        return bucket;
+
+    const int exponent = 4 + (bucket - linearBuckets) / subBuckets;
+    const uint64_t subBucket = (bucket - linearBuckets) % subBuckets;
+    return ((subBuckets + subBucket + 1) << (exponent - 3)) - 1;
+}
+
+CHIP8_LatencyTracker::CHIP8_LatencyTracker()
+    : state(Idle)
+{
+}
+
+void CHIP8_LatencyTracker::inputReceived(Clock::time_point input, Clock::time_point mediator)
+{
+    std::unique_lock<std::mutex> lck{mtx};
+
+    if(state.load(std::memory_order_relaxed) != Idle
+        && mediator - timestamps[0] < std::chrono::milliseconds(abandonAfterMiliseconds))
+        return;
+
+    timestamps[0] = input;
+    timestamps[(int)CHIP8_LatencyStage::Mediator + 1] = mediator;
+    state.store(WaitingForVM, std::memory_order_relaxed);
+}
+
+void CHIP8_LatencyTracker::keysRead()
+{
+    advance(WaitingForVM, WaitingForPublish, CHIP8_LatencyStage::VM);
+}
+
+void CHIP8_LatencyTracker::framePublished()
+{
+    advance(WaitingForPublish, WaitingForTake, CHIP8_LatencyStage::Published);
+}
+
+void CHIP8_LatencyTracker::frameTaken()
+{
+    if(state.load(std::memory_order_relaxed) != WaitingForTake)
+        return;
+
+    std::unique_lock<std::mutex> lck{mtx};
+    if(state.load(std::memory_order_relaxed) == WaitingForTake)
+        state.store(WaitingForPresent, std::memory_order_relaxed);
+}
+
+void CHIP8_LatencyTracker::framePresented()
+{
+    if(advance(WaitingForPresent, Idle, CHIP8_LatencyStage::Presented) == false)
+        return;
+
+    std::unique_lock<std::mutex> lck{mtx};
+    for(int stage = 0; stage <= (int)CHIP8_LatencyStage::Total; stage++)
+    {
+        const Clock::time_point start = timestamps[stage == (int)CHIP8_LatencyStage::Total ? 0 : stage];
+        const Clock::time_point end = timestamps[stage == (int)CHIP8_LatencyStage::Total ?
+            (int)CHIP8_LatencyStage::Presented + 1 : stage + 1];
+        histograms[stage].record(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    }
+}
+
+uint64_t CHIP8_LatencyTracker::getSampleCount() const
+{
+    std::unique_lock<std::mutex> lck{mtx};
+    return histograms[(int)CHIP8_LatencyStage::Total].getCount();
+}
+
+CHIP8_LatencyHistogram CHIP8_LatencyTracker::getHistogram(CHIP8_LatencyStage stage) const
+{
+    std::unique_lock<std::mutex> lck{mtx};
+    return histograms[(int)stage];
+}
+
+std::string CHIP8_LatencyTracker::report() const
+{
+    std::ostringstream text;
+    text << "INPUT LATENCY (" << getSampleCount() << " SAMPLES, MS)\n";
+    text << std::setw(12) << "STAGE" << std::setw(10) << "P50" << std::setw(10) << "P99" << std::setw(10) << "MAX" << "\n";
+    text << std::fixed << std::setprecision(3);
+
+    for(int stage = 0; stage < (int)CHIP8_LatencyStage::Count; stage++)
+    {
+        const CHIP8_LatencyHistogram histogram = getHistogram((CHIP8_LatencyStage)stage);
+        text << std::setw(12) << getStageName((CHIP8_LatencyStage)stage)
+            << std::setw(10) << histogram.getPercentile(0.5) / 1000.0
+            << std::setw(10) << histogram.getPercentile(0.99) / 1000.0
+            << std::setw(10) << histogram.getMaximum() / 1000.0 << "\n";
+    }
+
+    return text.str();
+}
+
+const char* CHIP8_LatencyTracker::getStageName(CHIP8_LatencyStage stage)
+{
+    switch(stage)
+    {
+        case CHIP8_LatencyStage::Mediator: return "MEDIATOR";
+        case CHIP8_LatencyStage::VM: return "VM";
+        case CHIP8_LatencyStage::Published: return "PUBLISHED";
+        case CHIP8_LatencyStage::Presented: return "PRESENTED";
+        case CHIP8_LatencyStage::Total: return "TOTAL";
+        default: return "UNKNOWN";
+    }
+}
+
+bool CHIP8_LatencyTracker::advance(State from, State to, CHIP8_LatencyStage stage)
+{
+    if(state.load(std::memory_order_relaxed) != from)
+        return false;
+
+    const Clock::time_point now = Clock::now();
+
+    std::unique_lock<std::mutex> lck{mtx};
+    if(state.load(std::memory_order_relaxed) != from)
+        return false;
+
+    timestamps[(int)stage + 1] = now;
+    state.store(to, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Log-linear histogram of microsecond values: exact below 16 us, then 8 buckets per power
+// of two, so every value is within 12.5% of its bucket.
+class CHIP8_LatencyHistogram
+{
+public:
+    static const int linearBuckets = 16;
+    static const int subBuckets = 8;
+    static const int bucketCount = linearBuckets + (32 - 4) * subBuckets;
+
+private:
+    uint64_t buckets[bucketCount];
+    uint64_t count;
+    uint64_t maximum;
+
+public:
+    CHIP8_LatencyHistogram();
+
+    void record(uint64_t microseconds);
+
+    uint64_t getCount() const;
+    uint64_t getMaximum() const;
+    // upper bound of the bucket holding the given fraction of the samples, 0.5 for p50
+    uint64_t getPercentile(double fraction) const;
+
+    static int getBucket(uint64_t microseconds);
+    static uint64_t getBucketLimit(int bucket);
+};
+
+// time measured from the previous stage, Total from the input event
+enum class CHIP8_LatencyStage : uint8_t
+{
+    Mediator,   // the key array reached the mediator
+    VM,         // the VM read the keys
+    Published,  // the next frame was published
+    Presented,  // the GUI showed that frame
+    Total,
+    Count
+};
+
+// Follows one input at a time from the event to the first frame shown after the VM read
+// it. Inputs arriving while one is followed are not sampled. Every stage check is a relaxed
+// load while the tracker waits for another stage, so the VM pays nothing per key read.
+class CHIP8_LatencyTracker
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // an input the VM never reads stops being followed after this long
+    static const int abandonAfterMiliseconds = 1000;
+
+private:
+    enum State : uint8_t
+    {
+        Idle,
+        WaitingForVM,
+        WaitingForPublish,
+        WaitingForTake,
+        WaitingForPresent
+    };
+
+    std::atomic<uint8_t> state;
+
+    mutable std::mutex mtx;
+    Clock::time_point timestamps[(int)CHIP8_LatencyStage::Total + 1]; // the input, then every stage
+    CHIP8_LatencyHistogram histograms[(int)CHIP8_LatencyStage::Count];
+
+public:
+    CHIP8_LatencyTracker();
+
+    void inputReceived(Clock::time_point input, Clock::time_point mediator);
+    void keysRead();
+    void framePublished();
+    void frameTaken();      // the GUI took the published frame from the mediator
+    void framePresented();  // and it is on the screen
+
+    uint64_t getSampleCount() const;
+    CHIP8_LatencyHistogram getHistogram(CHIP8_LatencyStage stage) const;
+
+    // p50 / p99 / max of every stage, in milliseconds
+    std::string report() const;
+
+    static const char* getStageName(CHIP8_LatencyStage stage);
+
+private:
+    bool advance(State from, State to, CHIP8_LatencyStage stage);
+};
@@ -2,8 +2,8 @@
 
 CHIP8_Mediator::CHIP8_Mediator()
     : keyArray(CHIP8_CONSTANTS::keyArraySize, false), frameBufferChanged(false), soundEffect(false),
-    frameBuffer(CHIP8_CONSTANTS::frameHeight, std::vector<bool>(CHIP8_CONSTANTS::frameWidth, false)),
-    chipShouldStop(false)
+    frameBuffer(CHIP8_CONSTANTS::frameHeight, 0), dirtyRows(0),
+    chipShouldStop(false), frameGeneration(0)
 {
     
 }
@@ -18,40 +18,108 @@ bool CHIP8_Mediator::hasFrameBufferChanged()
     return frameBufferChanged.load();
 }
 
-void CHIP8_Mediator::updateFrameBuffer(const std::vector<std::vector<bool>>& newFrameBuffer)
+void CHIP8_Mediator::updateFrameBuffer(const CHIP8_FrameBuffer& newFrameBuffer, uint32_t changedRows)
 {
-    std::unique_lock<std::mutex> lck{mtx};
-    frameBuffer = newFrameBuffer;
-    frameBufferChanged.store(true);
+    {
+        std::unique_lock<std::mutex> lck = lock();
+        for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+            if(changedRows & (1u << y))
+                frameBuffer[y] = newFrameBuffer[y];
+        dirtyRows |= changedRows;
+        frameGeneration.fetch_add(1);
+
+        metrics.add(CHIP8_Metric::FramesPublished, 1);
+        if(frameBufferChanged.exchange(true))
+            metrics.add(CHIP8_Metric::FramesDropped, 1);
+
+        latency.framePublished();
+
+        for(CHIP8_FrameListener* listener : frameListeners)
+            listener->onFrame(frameBuffer);
+    }
+    frameCV.notify_all();
+}
+
+CHIP8_FrameBuffer CHIP8_Mediator::getNewFrameBuffer()
+{
+    uint32_t changedRows;
+    return getNewFrameBuffer(changedRows);
 }
 
-std::vector<std::vector<bool>> CHIP8_Mediator::getNewFrameBuffer()
+CHIP8_FrameBuffer CHIP8_Mediator::getNewFrameBuffer(uint32_t& changedRows)
 {
-    std::unique_lock<std::mutex> lck{mtx};
+    std::unique_lock<std::mutex> lck = lock();
     frameBufferChanged.store(false);
+    changedRows = dirtyRows;
+    dirtyRows = 0;
+    latency.frameTaken();
     return frameBuffer;
 }
 
+uint64_t CHIP8_Mediator::getFrameGeneration()
+{
+    return frameGeneration.load();
+}
+
+bool CHIP8_Mediator::waitForFrameBuffer(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lck = lock();
+    return frameCV.wait_until(lck, deadline, [this](){
+        return frameBufferChanged.load();
+    });
+}
+
+void CHIP8_Mediator::addFrameListener(CHIP8_FrameListener* listener)
+{
+    std::unique_lock<std::mutex> lck = lock();
+    frameListeners.push_back(listener);
+}
+
+void CHIP8_Mediator::removeFrameListener(CHIP8_FrameListener* listener)
+{
+    //taking the lock waits for an onFrame() call in progress, so a removed listener can be destroyed
+    std::unique_lock<std::mutex> lck = lock();
+    frameListeners.erase(std::remove(frameListeners.begin(), frameListeners.end(), listener), frameListeners.end());
+}
+
 void CHIP8_Mediator::updateKeyArray(const std::vector<bool>& newKeyArray)
+{
+    updateKeyArray(newKeyArray, CHIP8_LatencyTracker::Clock::now());
+}
+
+void CHIP8_Mediator::updateKeyArray(const std::vector<bool>& newKeyArray, CHIP8_LatencyTracker::Clock::time_point inputTime)
 {
     {
-        std::unique_lock<std::mutex> lck{mtx};
+        std::unique_lock<std::mutex> lck = lock();
         keyArray = newKeyArray;
+        latency.inputReceived(inputTime, CHIP8_LatencyTracker::Clock::now());
+    }
+    keyboardCV.notify_all();
+}
+
+void CHIP8_Mediator::updateKeyMask(uint16_t keyMask)
+{
+    {
+        std::unique_lock<std::mutex> lck = lock();
+        for(int key = 0; key < CHIP8_CONSTANTS::keyArraySize; key++)
+            keyArray[key] = (keyMask >> key) & 1;
+        latency.inputReceived(CHIP8_LatencyTracker::Clock::now(), CHIP8_LatencyTracker::Clock::now());
     }
     keyboardCV.notify_all();
 }
 
 bool CHIP8_Mediator::isKeyPressed(uint8_t key)
 {
-    std::unique_lock<std::mutex> lck{mtx};
+    std::unique_lock<std::mutex> lck = lock();
     if(key > 0xf)
     {
         std::cout << "KEY CODE IS GREATER THAN 16!" << std::endl;
         chipShouldStop.store(true);
         return false;
     }
-    else
-        return keyArray.at(key);
+
+    latency.keysRead();
+    return keyArray.at(key);
 }
 
 bool CHIP8_Mediator::isKeyReleased(uint8_t key)
@@ -61,10 +129,14 @@ bool CHIP8_Mediator::isKeyReleased(uint8_t key)
 
 uint8_t CHIP8_Mediator::getNewKeyPress()
 {
-    std::unique_lock<std::mutex> lck{mtx};
-    keyboardCV.wait(lck, [this](){
-        return std::find(keyArray.begin(), keyArray.end(), true) != keyArray.end();
-    });
+    std::unique_lock<std::mutex> lck = lock();
+    {
+        CHIP8_MetricsTimer timer(metrics, CHIP8_Metric::KeyboardWaitNanoseconds);
+        keyboardCV.wait(lck, [this](){
+            return std::find(keyArray.begin(), keyArray.end(), true) != keyArray.end();
+        });
+    }
+    latency.keysRead();
 
     for(int i = 0; i < keyArray.size(); i++)
         if(keyArray[i])
@@ -75,10 +147,34 @@ uint8_t CHIP8_Mediator::getNewKeyPress()
     return 0;
 }
 
+bool CHIP8_Mediator::tryGetKeyPress(uint8_t& key)
+{
+    std::unique_lock<std::mutex> lck = lock();
+    latency.keysRead();
+    for(std::size_t i = 0; i < keyArray.size(); i++)
+    {
+        if(keyArray[i])
+        {
+            key = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CHIP8_Mediator::waitForKeyPress()
+{
+    std::unique_lock<std::mutex> lck = lock();
+    CHIP8_MetricsTimer timer(metrics, CHIP8_Metric::KeyboardWaitNanoseconds);
+    keyboardCV.wait(lck, [this](){
+        return chipShouldStop.load() || std::find(keyArray.begin(), keyArray.end(), true) != keyArray.end();
+    });
+}
+
 void CHIP8_Mediator::stopCHIP8()
 {
     {
-        std::unique_lock<std::mutex> lck{mtx};
+        std::unique_lock<std::mutex> lck = lock();
         chipShouldStop.store(true);
         keyArray[0] = true;
         soundEffect.store(false);
@@ -87,12 +183,19 @@ void CHIP8_Mediator::stopCHIP8()
     soundCV.notify_all();
 }
 
+void CHIP8_Mediator::resumeCHIP8()
+{
+    std::unique_lock<std::mutex> lck = lock();
+    chipShouldStop.store(false);
+    std::fill(keyArray.begin(), keyArray.end(), false);
+}
+
 bool CHIP8_Mediator::shouldCHIP8Stop()
 {
     return chipShouldStop.load();
 }
 
-bool CHIP8_Mediator::isSoundEffect()
+bool CHIP8_Mediator::isSoundEffect() const
 {
     return soundEffect.load();
 }
@@ -110,8 +213,30 @@ void CHIP8_Mediator::unsetSoundEffect()
 
 void CHIP8_Mediator::waitForSoundEffect()
 {
-    std::unique_lock<std::mutex> lck{mtx};
+    std::unique_lock<std::mutex> lck = lock();
     soundCV.wait(lck, [this](){
         return isSoundEffect();
     });
+}
+
+CHIP8_Metrics& CHIP8_Mediator::getMetrics()
+{
+    return metrics;
+}
+
+CHIP8_LatencyTracker& CHIP8_Mediator::getLatency()
+{
+    return latency;
+}
+
+std::unique_lock<std::mutex> CHIP8_Mediator::lock()
+{
+    std::unique_lock<std::mutex> lck{mtx, std::try_to_lock};
+    if(lck.owns_lock() == false)
+    {
+        CHIP8_MetricsTimer timer(metrics, CHIP8_Metric::MutexWaitNanoseconds);
+        metrics.add(CHIP8_Metric::MutexContentions, 1);
+        lck.lock();
+    }
+    return lck;
 }
\ No newline at end of file
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -13,6 +15,9 @@
 
 #include <future>
 
+#include "CHIP8_Metrics.hpp"
+#include "CHIP8_Latency.hpp"
+
 namespace CHIP8_CONSTANTS
 {
     static const int frameWidth = 64;
@@ -21,22 +26,51 @@ namespace CHIP8_CONSTANTS
     static const int timersTickDurationInMiliseconds = 16;
 
     static const int keyArraySize = 16;
+
+    static const uint32_t allRowsDirty = 0xffffffff;
+}
+
+// One 64 bit word per row, the leftmost pixel is the most significant bit
+typedef std::vector<uint64_t> CHIP8_FrameBuffer;
+
+static_assert(CHIP8_CONSTANTS::frameWidth == 64, "a frame buffer row has to fit in one uint64_t");
+static_assert(CHIP8_CONSTANTS::frameHeight == 32, "the dirty row mask has to fit in one uint32_t");
+
+inline bool getPixel(const CHIP8_FrameBuffer& frameBuffer, int x, int y)
+{
+    return (frameBuffer[y] >> (CHIP8_CONSTANTS::frameWidth - 1 - x)) & 1;
 }
 
 
+// Sees every frame the VM publishes. onFrame() runs on the VM thread with the mediator
+// locked, so it must not block.
+class CHIP8_FrameListener
+{
+public:
+    virtual ~CHIP8_FrameListener() { }
+    virtual void onFrame(const CHIP8_FrameBuffer& frameBuffer) = 0;
+};
+
 class CHIP8_Mediator
 {
 private:
     std::mutex mtx;
     std::condition_variable keyboardCV;
     std::condition_variable soundCV;
+    std::condition_variable frameCV;
 
     std::atomic<bool> frameBufferChanged;
     std::atomic<bool> chipShouldStop;
     std::atomic<bool> soundEffect;
+    std::atomic<uint64_t> frameGeneration;
 
     std::vector<bool> keyArray;
-    std::vector<std::vector<bool>> frameBuffer;
+    CHIP8_FrameBuffer frameBuffer;
+    uint32_t dirtyRows; // rows changed since the GUI last took the frame
+
+    CHIP8_Metrics metrics;
+    CHIP8_LatencyTracker latency;
+    std::vector<CHIP8_FrameListener*> frameListeners; // guarded by mtx
 
 public:
     CHIP8_Mediator();
@@ -44,22 +78,41 @@ public:
 
     bool hasFrameBufferChanged();
 
-    void updateFrameBuffer(const std::vector<std::vector<bool>>& newFrameBuffer);
-    std::vector<std::vector<bool>> getNewFrameBuffer();
+    void updateFrameBuffer(const CHIP8_FrameBuffer& newFrameBuffer, uint32_t changedRows = CHIP8_CONSTANTS::allRowsDirty);
+    CHIP8_FrameBuffer getNewFrameBuffer();
+    CHIP8_FrameBuffer getNewFrameBuffer(uint32_t& changedRows);
+    uint64_t getFrameGeneration();
+    // blocks until a frame is published or the deadline passes, true when there is a new frame
+    bool waitForFrameBuffer(std::chrono::steady_clock::time_point deadline);
+    void addFrameListener(CHIP8_FrameListener* listener);
+    void removeFrameListener(CHIP8_FrameListener* listener); // once it returns the listener is no longer called
 
     void updateKeyArray(const std::vector<bool>& newKeyArray);
+    // inputTime is when the input event was received, for the latency tracker
+    void updateKeyArray(const std::vector<bool>& newKeyArray, CHIP8_LatencyTracker::Clock::time_point inputTime);
+    void updateKeyMask(uint16_t keyMask); // bit N set means key N is pressed
 
     bool isKeyPressed(uint8_t key);
     bool isKeyReleased(uint8_t key);
 
     uint8_t getNewKeyPress();
+    bool tryGetKeyPress(uint8_t& key);
+    void waitForKeyPress();
 
     void stopCHIP8();
+    void resumeCHIP8(); // clears a stop, e.g. before a VM is reused with a new ROM or state
     bool shouldCHIP8Stop();
 
-    bool isSoundEffect();
+    bool isSoundEffect() const;
     void setSoundEffect();
     void unsetSoundEffect();
 
     void waitForSoundEffect();
+
+    CHIP8_Metrics& getMetrics();
+    CHIP8_LatencyTracker& getLatency();
+
+private:
+    // locks mtx, the time spent waiting for another thread to release it is counted
+    std::unique_lock<std::mutex> lock();
 };
\ No newline at end of file
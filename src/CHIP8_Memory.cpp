@@ -0,0 +1,165 @@
+#include "CHIP8_Memory.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+const int CHIP8_Memory::memorySize;
+const int CHIP8_Memory::pageSize;
+const int CHIP8_Memory::pageCount;
+const uint16_t CHIP8_Memory::addressMask;
+const uint8_t CHIP8_Memory::readable;
+const uint8_t CHIP8_Memory::writable;
+const uint8_t CHIP8_Memory::executable;
+constexpr CHIP8_MemoryRegion CHIP8_Memory::regions[];
+
+//constant initialized, so the table is ready before any constructor runs
+const std::array<uint8_t, CHIP8_Memory::pageCount + 1> CHIP8_Memory::pageAccess = {{
+    getPageAccess(0), getPageAccess(1), getPageAccess(2), getPageAccess(3),
+    getPageAccess(4), getPageAccess(5), getPageAccess(6), getPageAccess(7),
+    getPageAccess(8), getPageAccess(9), getPageAccess(10), getPageAccess(11),
+    getPageAccess(12), getPageAccess(13), getPageAccess(14), getPageAccess(15),
+    getPageAccess(16)
+}};
+
+CHIP8_Memory::CHIP8_Memory()
+{
+    for(auto& page : pages)
+        page = share(getZeroPage());
+}
+
+CHIP8_Memory::CHIP8_Memory(const CHIP8_Memory& other)
+{
+    for(int i = 0; i < pageCount; i++)
+        pages[i] = share(other.pages[i]);
+}
+
+CHIP8_Memory& CHIP8_Memory::operator=(const CHIP8_Memory& other)
+{
+    //shared first, so assigning a memory to itself keeps its pages alive
+    for(int i = 0; i < pageCount; i++)
+    {
+        SharedPage* page = share(other.pages[i]);
+        release(pages[i]);
+        pages[i] = page;
+    }
+    return *this;
+}
+
+CHIP8_Memory::~CHIP8_Memory()
+{
+    for(SharedPage* page : pages)
+        release(page);
+}
+
+uint8_t CHIP8_Memory::at(std::size_t address) const
+{
+    if(address >= memorySize)
+        throw std::out_of_range("CHIP8_Memory::at");
+    return (*this)[address];
+}
+
+void CHIP8_Memory::write(uint16_t address, uint8_t value)
+{
+    if(address >= memorySize)
+        throw std::out_of_range("CHIP8_Memory::write");
+
+    store(address, value);
+}
+
+void CHIP8_Memory::write(uint16_t address, const uint8_t* data, std::size_t size)
+{
+    if(address + size > memorySize)
+        throw std::out_of_range("CHIP8_Memory::write");
+
+    while(size > 0)
+    {
+        const int offset = address % pageSize;
+        const std::size_t count = std::min(size, (std::size_t)(pageSize - offset));
+
+        Page& page = getWritablePage(address / pageSize);
+        std::copy(data, data + count, page.begin() + offset);
+
+        address += count;
+        data += count;
+        size -= count;
+    }
+}
+
+void CHIP8_Memory::read(uint16_t address, uint8_t* data, std::size_t size) const
+{
+    if(address + size > memorySize)
+        throw std::out_of_range("CHIP8_Memory::read");
+
+    while(size > 0)
+    {
+        const int offset = address % pageSize;
+        const std::size_t count = std::min(size, (std::size_t)(pageSize - offset));
+
+        const Page& page = pages[address / pageSize]->bytes;
+        std::copy(page.begin() + offset, page.begin() + offset + count, data);
+
+        address += count;
+        data += count;
+        size -= count;
+    }
+}
+
+void CHIP8_Memory::clear()
+{
+    for(auto& page : pages)
+    {
+        release(page);
+        page = share(getZeroPage());
+    }
+}
+
+bool CHIP8_Memory::sharesPage(int page, const CHIP8_Memory& other) const
+{
+    return pages[page] == other.pages[page];
+}
+
+bool CHIP8_Memory::operator==(const CHIP8_Memory& other) const
+{
+    for(int i = 0; i < pageCount; i++)
+        if(pages[i] != other.pages[i] && pages[i]->bytes != other.pages[i]->bytes)
+            return false;
+    return true;
+}
+
+bool CHIP8_Memory::operator!=(const CHIP8_Memory& other) const
+{
+    return !(*this == other);
+}
+
+CHIP8_Memory::Page& CHIP8_Memory::getWritablePage(int page)
+{
+    //acquire pairs with the release in release(): once this memory is the only owner, every
+    //other copy's reads of the page have finished and it can be written in place
+    if(pages[page]->owners.load(std::memory_order_acquire) != 1)
+    {
+        SharedPage* copy = new SharedPage{ pages[page]->bytes, {1} };
+        release(pages[page]);
+        pages[page] = copy;
+    }
+    return pages[page]->bytes;
+}
+
+CHIP8_Memory::SharedPage* CHIP8_Memory::share(SharedPage* page)
+{
+    //a new owner is always made from an existing one, which keeps the page alive meanwhile
+    page->owners.fetch_add(1, std::memory_order_relaxed);
+    return page;
+}
+
+void CHIP8_Memory::release(SharedPage* page)
+{
+    if(page->owners.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete page;
+}
+
+CHIP8_Memory::SharedPage* CHIP8_Memory::getZeroPage()
+{
+    //the reference held here is never released, so the zero page is never written or freed
+    static SharedPage zeroPage{ Page(), {1} };
+    return &zeroPage;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// A range of the address space and what the VM may do with it. Regions start and end
+// on page boundaries.
+struct CHIP8_MemoryRegion
+{
+    uint16_t start;
+    uint16_t end;   // one past the last byte
+    uint8_t access; // CHIP8_Memory::readable | writable | executable
+};
+
+// 4 KB of CHIP-8 RAM split into reference counted pages. Copies share all pages, so
+// forking a VM state costs a few pointer copies; a write clones only the page it touches
+// when that page is still shared with another copy. Copies may live on other threads, e.g.
+// the states of CHIP8_Search, so the count is an atomic that orders the last reader of a
+// page before a writer that finds itself the only owner.
+class CHIP8_Memory
+{
+public:
+    static const int memorySize = 4096;
+    static const int pageSize = 256;
+    static const int pageCount = memorySize / pageSize;
+
+    typedef std::array<uint8_t, pageSize> Page;
+
+    // data addresses wrap around at 4 KB, I + offset never leaves the address space
+    static const uint16_t addressMask = memorySize - 1;
+
+    static const uint8_t readable = 1;
+    static const uint8_t writable = 2;
+    static const uint8_t executable = 4;
+
+    // the whole address space in order; a write protected area is a region without writable
+    static constexpr CHIP8_MemoryRegion regions[] = {
+        { 0x000, 0x200, readable },                          // interpreter area with the font
+        { 0x200, memorySize, readable | writable | executable } // program RAM
+    };
+    static constexpr int regionCount = sizeof(regions) / sizeof(regions[0]);
+
+private:
+    struct SharedPage
+    {
+        Page bytes;
+        std::atomic<int> owners;
+    };
+
+    SharedPage* pages[pageCount];
+
+    // access of every page built from regions, the extra last entry is for addresses past the
+    // end, which instruction fetches do not wrap
+    static const std::array<uint8_t, pageCount + 1> pageAccess;
+
+public:
+    // all pages start out as the shared zero page
+    CHIP8_Memory();
+    CHIP8_Memory(const CHIP8_Memory& other);
+    CHIP8_Memory& operator=(const CHIP8_Memory& other);
+    ~CHIP8_Memory();
+
+    std::size_t size() const
+    {
+        return memorySize;
+    }
+
+    // the VM's loads and stores: the address is masked to 12 bits instead of bounds checked.
+    // Loads need no check, stores are checked by the caller through getAccess()
+    uint8_t operator[](uint16_t address) const
+    {
+        address &= addressMask;
+        return pages[address / pageSize]->bytes[address % pageSize];
+    }
+
+    void store(uint16_t address, uint8_t value)
+    {
+        address &= addressMask;
+
+        //writing the value already stored must not unshare the page
+        if((*this)[address] != value)
+            getWritablePage(address / pageSize)[address % pageSize] = value;
+    }
+
+    // access rights of a data address, after masking
+    static uint8_t getAccess(uint16_t address)
+    {
+        return pageAccess[(address & addressMask) / pageSize];
+    }
+
+    // rights granted on every byte of a range of 1 to pageSize bytes, which may wrap around the
+    // end. Rights change only at page boundaries, so its first and last page decide.
+    static uint8_t getAccess(uint16_t address, int length)
+    {
+        return getAccess(address) & getAccess(address + length - 1);
+    }
+
+    // true when the instruction at address lies completely in executable memory
+    static bool canExecute(uint16_t address)
+    {
+        const int first = std::min<int>(address / pageSize, pageCount);
+        const int second = std::min<int>((address + 1) / pageSize, pageCount);
+        return (pageAccess[first] & pageAccess[second] & executable) != 0;
+    }
+
+    // true when every region grants access
+    static constexpr bool isEverywhere(uint8_t access, int region = 0)
+    {
+        return region == regionCount
+            || ((regions[region].access & access) == access && isEverywhere(access, region + 1));
+    }
+
+    // bounds checked read and writes for loaders, which throw std::out_of_range like std::vector::at()
+    uint8_t at(std::size_t address) const;
+
+    void write(uint16_t address, uint8_t value);
+    void write(uint16_t address, const uint8_t* data, std::size_t size);
+    void read(uint16_t address, uint8_t* data, std::size_t size) const;
+    void clear();
+
+    // true when both memories use the same copy of the page
+    bool sharesPage(int page, const CHIP8_Memory& other) const;
+
+    bool operator==(const CHIP8_Memory& other) const;
+    bool operator!=(const CHIP8_Memory& other) const;
+
+    // access of the region holding the page, nothing past the last region
+    static constexpr uint8_t getPageAccess(int page, int region = 0)
+    {
+        return region == regionCount ? 0
+            : page * pageSize >= regions[region].start && page * pageSize < regions[region].end ? regions[region].access
+            : getPageAccess(page, region + 1);
+    }
+
+    static constexpr bool areRegionsValid(int region = 0)
+    {
+        return region == regionCount
+            || (regions[region].start == (region == 0 ? 0 : regions[region - 1].end)
+                && regions[region].start % pageSize == 0 && regions[region].end > regions[region].start
+                && (region != regionCount - 1 || regions[region].end == memorySize)
+                && areRegionsValid(region + 1));
+    }
+
+private:
+    Page& getWritablePage(int page);
+    static SharedPage* share(SharedPage* page);
+    static void release(SharedPage* page);
+    static SharedPage* getZeroPage();
+};
+
+static_assert(CHIP8_Memory::areRegionsValid(), "memory regions have to cover the address space in page aligned steps");
+static_assert(CHIP8_Memory::isEverywhere(CHIP8_Memory::readable), "loads are never checked, every region has to be readable");
+static_assert(CHIP8_Memory::pageCount == 16, "the page access table in CHIP8_Memory.cpp lists every page");
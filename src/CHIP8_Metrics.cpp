@@ -0,0 +1,211 @@
+#include "CHIP8_Metrics.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    struct MetricDescription
+    {
+        const char* name;
+        const char* help;
+        bool nanoseconds;
+    };
+
+    const MetricDescription descriptions[(int)CHIP8_Metric::Count] = {
+        { "chip8_instructions_total", "Instructions executed by the VM.", false },
+        { "chip8_frames_published_total", "Frames published to the mediator.", false },
+        { "chip8_frames_dropped_total", "Published frames replaced before the GUI took them.", false },
+        { "chip8_timer_ticks_total", "Delay and sound timer ticks.", false },
+        { "chip8_mediator_lock_contentions_total", "Mediator lock acquisitions that had to wait.", false },
+        { "chip8_mediator_lock_wait_seconds_total", "Time spent waiting for the mediator lock.", true },
+        { "chip8_keyboard_wait_seconds_total", "Time spent waiting for a key press.", true },
+        { "chip8_frames_rendered_total", "Frames rendered by the GUI.", false },
+        { "chip8_render_seconds_total", "Time the GUI spent rendering.", true }
+    };
+
+    // how often a listening exporter checks whether it should stop
+    const int socketPollMiliseconds = 100;
+}
+
+CHIP8_Metrics::CHIP8_Metrics()
+{
+    for(std::atomic<uint64_t>& counter : counters)
+        counter.store(0);
+}
+
+std::string CHIP8_Metrics::toPrometheus() const
+{
+    std::ostringstream text;
+
+    for(int i = 0; i < (int)CHIP8_Metric::Count; i++)
+    {
+        const MetricDescription& description = descriptions[i];
+        const uint64_t value = get((CHIP8_Metric)i);
+
+        text << "# HELP " << description.name << " " << description.help << "\n";
+        text << "# TYPE " << description.name << " counter\n";
+        text << description.name << " ";
+        if(description.nanoseconds)
+            text << std::fixed << std::setprecision(9) << value / 1e9 << "\n";
+        else
+            text << value << "\n";
+    }
+
+    return text.str();
+}
+
+CHIP8_MetricsExporter::CHIP8_MetricsExporter(const CHIP8_Metrics& Metrics, std::string Path, CHIP8_MetricsTarget Target,
+    int periodInMiliseconds)
+    : metrics(Metrics), path(Path), target(Target), period(periodInMiliseconds),
+    listenSocket(-1), exporterShouldStop(false)
+{
+    if(target == CHIP8_MetricsTarget::UnixSocket && openSocket() == false)
+        return;
+
+    exporterThread = std::thread([this](){
+        exporterLoop();
+    });
+}
+
+CHIP8_MetricsExporter::~CHIP8_MetricsExporter()
+{
+    {
+        std::unique_lock<std::mutex> lck{mtx};
+        exporterShouldStop = true;
+    }
+    stopCV.notify_all();
+
+    if(exporterThread.joinable())
+        exporterThread.join();
+
+    closeSocket();
+}
+
+bool CHIP8_MetricsExporter::isOpen() const
+{
+    return target == CHIP8_MetricsTarget::File || listenSocket >= 0;
+}
+
+bool CHIP8_MetricsExporter::openSocket()
+{
+#ifdef _WIN32
+    return false;
+#else
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path))
+        return false;
+    path.copy(address.sun_path, path.size());
+
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenSocket < 0)
+        return false;
+
+    //a socket file left behind by an earlier run would make bind() fail
+    unlink(path.c_str());
+
+    if(bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 4) != 0)
+    {
+        close(listenSocket);
+        listenSocket = -1;
+        return false;
+    }
+    return true;
+#endif
+}
+
+void CHIP8_MetricsExporter::closeSocket()
+{
+#ifndef _WIN32
+    if(listenSocket < 0)
+        return;
+
+    close(listenSocket);
+    unlink(path.c_str());
+    listenSocket = -1;
+#endif
+}
+
+void CHIP8_MetricsExporter::exporterLoop()
+{
+    std::unique_lock<std::mutex> lck{mtx};
+    while(exporterShouldStop == false)
+    {
+        lck.unlock();
+        if(target == CHIP8_MetricsTarget::File)
+            writeFile();
+        else
+            serveClient();
+        lck.lock();
+
+        //the socket is polled, so only the file exporter sleeps here
+        if(target == CHIP8_MetricsTarget::File)
+            stopCV.wait_for(lck, period, [this](){
+                return exporterShouldStop;
+            });
+    }
+
+    //the file holds the final values once the exporter is gone
+    if(target == CHIP8_MetricsTarget::File)
+        writeFile();
+}
+
+bool CHIP8_MetricsExporter::writeFile()
+{
+    //scrapers must never read a half written file, so it is written aside and renamed
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::out | std::ios::trunc);
+        file << metrics.toPrometheus();
+        if(file.good() == false)
+            return false;
+    }
+
+    if(std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        //rename() does not replace an existing file on Windows
+        std::remove(path.c_str());
+        return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+    }
+    return true;
+}
+
+void CHIP8_MetricsExporter::serveClient()
+{
+#ifndef _WIN32
+    pollfd listener = { listenSocket, POLLIN, 0 };
+    if(poll(&listener, 1, socketPollMiliseconds) <= 0)
+        return;
+
+    const int client = accept(listenSocket, nullptr, nullptr);
+    if(client < 0)
+        return;
+
+    const std::string text = metrics.toPrometheus();
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+
+    //a client that goes away early only loses its own copy
+    for(std::size_t sent = 0; sent < text.size();)
+    {
+        const ssize_t written = send(client, text.data() + sent, text.size() - sent, flags);
+        if(written <= 0)
+            break;
+        sent += written;
+    }
+    close(client);
+#endif
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+enum class CHIP8_Metric : uint8_t
+{
+    InstructionsExecuted,
+    FramesPublished,
+    FramesDropped,            // published frames replaced before the GUI took them
+    TimerTicks,
+    MutexContentions,         // mediator lock acquisitions that had to wait
+    MutexWaitNanoseconds,
+    KeyboardWaitNanoseconds,  // time spent waiting on the keyboard condition variable
+    FramesRendered,
+    RenderNanoseconds,
+    Count
+};
+
+// Counters shared by the VM, the mediator and the GUI. Updates are relaxed atomic adds and
+// the VM adds its instruction count in batches, so counting costs nothing per instruction.
+class CHIP8_Metrics
+{
+private:
+    std::atomic<uint64_t> counters[(int)CHIP8_Metric::Count];
+
+public:
+    CHIP8_Metrics();
+
+    void add(CHIP8_Metric metric, uint64_t value)
+    {
+        counters[(int)metric].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t get(CHIP8_Metric metric) const
+    {
+        return counters[(int)metric].load(std::memory_order_relaxed);
+    }
+
+    // Prometheus text exposition format, durations are exported in seconds
+    std::string toPrometheus() const;
+};
+
+// Measures the time from construction to destruction into a nanosecond counter
+class CHIP8_MetricsTimer
+{
+private:
+    CHIP8_Metrics& metrics;
+    CHIP8_Metric metric;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    CHIP8_MetricsTimer(CHIP8_Metrics& Metrics, CHIP8_Metric Metric)
+        : metrics(Metrics), metric(Metric), start(std::chrono::steady_clock::now()) { }
+
+    ~CHIP8_MetricsTimer()
+    {
+        metrics.add(metric, std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+enum class CHIP8_MetricsTarget : uint8_t
+{
+    File,       // rewritten every period, replaced atomically
+    UnixSocket  // every connection receives the current values and is closed, not available on Windows
+};
+
+// Exports the counters from its own thread, the VM never waits on the output.
+class CHIP8_MetricsExporter
+{
+private:
+    const CHIP8_Metrics& metrics;
+    const std::string path;
+    const CHIP8_MetricsTarget target;
+    const std::chrono::milliseconds period;
+
+    int listenSocket;
+
+    std::mutex mtx;
+    std::condition_variable stopCV;
+    bool exporterShouldStop;
+    std::thread exporterThread;
+
+public:
+    CHIP8_MetricsExporter(const CHIP8_Metrics& Metrics, std::string Path, CHIP8_MetricsTarget Target,
+        int periodInMiliseconds = 1000);
+    ~CHIP8_MetricsExporter();
+
+    bool isOpen() const;
+
+private:
+    bool openSocket();
+    void closeSocket();
+
+    void exporterLoop();
+    bool writeFile();
+    void serveClient();
+};
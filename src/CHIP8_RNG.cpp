@@ -0,0 +1,35 @@
+#include "CHIP8_RNG.hpp"
+
+CHIP8_XorShiftRNG::CHIP8_XorShiftRNG(uint64_t seed)
+{
+    this->seed(seed);
+}
+
+uint8_t CHIP8_XorShiftRNG::nextByte()
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (uint8_t)((state * 0x2545f4914f6cdd1dULL) >> 56);
+}
+
+void CHIP8_XorShiftRNG::seed(uint64_t seed)
+{
+    //splitmix64 step, so that similar seeds give unrelated sequences and the state is never 0
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+
+    state = z != 0 ? z : 0x9e3779b97f4a7c15ULL;
+}
+
+uint64_t CHIP8_XorShiftRNG::getState() const
+{
+    return state;
+}
+
+void CHIP8_XorShiftRNG::setState(uint64_t State)
+{
+    state = State != 0 ? State : 0x9e3779b97f4a7c15ULL;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// Random source for CXNN. The whole generator state has to fit in 64 bits,
+// so it can be stored in save states and copied with the VM.
+class CHIP8_RNG
+{
+public:
+    virtual ~CHIP8_RNG() { }
+
+    virtual uint8_t nextByte() = 0;
+    virtual void seed(uint64_t seed) = 0;
+
+    virtual uint64_t getState() const = 0;
+    virtual void setState(uint64_t state) = 0;
+};
+
+// xorshift64* generator
+class CHIP8_XorShiftRNG : public CHIP8_RNG
+{
+private:
+    uint64_t state;
+
+public:
+    CHIP8_XorShiftRNG(uint64_t seed = 0);
+
+    uint8_t nextByte() override;
+    void seed(uint64_t seed) override;
+
+    uint64_t getState() const override;
+    void setState(uint64_t State) override;
+};
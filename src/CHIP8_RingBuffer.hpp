@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Single producer / single consumer ring buffer. Capacity is rounded up to a power of two.
+// Neither side ever blocks: tryPush fails when the buffer is full, tryPop when it is empty.
+template<typename T>
+class CHIP8_RingBuffer
+{
+private:
+    static const std::size_t cacheLineSize = 64;
+
+    std::vector<T> buffer;
+    std::size_t mask;
+
+    // head/cachedTail belong to the consumer, tail/cachedHead to the producer;
+    // the padding keeps both sides on separate cache lines
+    char padding0[cacheLineSize];
+    std::atomic<std::size_t> head;
+    std::size_t cachedTail;
+    char padding1[cacheLineSize];
+    std::atomic<std::size_t> tail;
+    std::size_t cachedHead;
+    char padding2[cacheLineSize];
+
+public:
+    CHIP8_RingBuffer(std::size_t minCapacity)
+        : head(0), cachedTail(0), tail(0), cachedHead(0)
+    {
+        std::size_t capacity = 2;
+        while(capacity < minCapacity)
+            capacity <<= 1;
+
+        buffer.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    std::size_t capacity() const
+    {
+        return buffer.size();
+    }
+
+    bool tryPush(const T& item)
+    {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+
+        if(t - cachedHead > mask)
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            if(t - cachedHead > mask)
+                return false;
+        }
+
+        buffer[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item)
+    {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+
+        if(h == cachedTail)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if(h == cachedTail)
+                return false;
+        }
+
+        item = buffer[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Pops up to maxCount items into out, returns how many were popped
+    std::size_t popMany(T* out, std::size_t maxCount)
+    {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        cachedTail = tail.load(std::memory_order_acquire);
+
+        std::size_t count = cachedTail - h;
+        if(count > maxCount)
+            count = maxCount;
+
+        for(std::size_t i = 0; i < count; i++)
+            out[i] = buffer[(h + i) & mask];
+
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
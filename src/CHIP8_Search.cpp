@@ -0,0 +1,227 @@
+#include "CHIP8_Search.hpp"
+
+bool CHIP8_Search::OpenState::operator<(const OpenState& other) const
+{
+    //std::priority_queue pops the largest element, equal priorities are expanded in insertion order
+    if(priority != other.priority)
+        return priority < other.priority;
+    return sequence > other.sequence;
+}
+
+CHIP8_Search::CHIP8_Search(const CHIP8_State& Start)
+    : start(Start), strategy(Strategy::BreadthFirst), maxDepth(60), maxStates(1000000),
+        threadCount(std::thread::hardware_concurrency()),
+        instructionsPerFrame(CHIP8::defaultInstructionsPerFrame), visited(visitedShardCount)
+{
+    inputs.push_back(0);
+    for(int key = 0; key < CHIP8_CONSTANTS::keyArraySize; key++)
+        inputs.push_back(1 << key);
+}
+
+void CHIP8_Search::setStrategy(Strategy SearchStrategy, Score ScoreFunction)
+{
+    strategy = SearchStrategy;
+    score = ScoreFunction;
+}
+
+void CHIP8_Search::setInputs(const std::vector<uint16_t>& Inputs)
+{
+    inputs = Inputs;
+}
+
+void CHIP8_Search::setMaxDepth(int frames)
+{
+    maxDepth = frames;
+}
+
+void CHIP8_Search::setMaxStates(uint64_t count)
+{
+    maxStates = count;
+}
+
+void CHIP8_Search::setThreadCount(unsigned count)
+{
+    threadCount = count ? count : 1;
+}
+
+void CHIP8_Search::setInstructionsPerFrame(int count)
+{
+    instructionsPerFrame = count;
+}
+
+CHIP8_SearchResult CHIP8_Search::run(const Goal& goal)
+{
+    openStates = std::priority_queue<OpenState>();
+    nodes.clear();
+    nextSequence = 0;
+    busyWorkers = 0;
+    searchDone = false;
+    result = CHIP8_SearchResult{ false, {}, CHIP8_State(), 1, 0, 0, 0 };
+    for(auto& shard : visited)
+        shard.hashes.clear();
+
+    markVisited(start.hash());
+    nodes.push_back(Node{ 0, 0, 0 });
+
+    if(goal && goal(start))
+    {
+        result.found = true;
+        result.state = start;
+        return result;
+    }
+    push(0, std::make_shared<CHIP8_State>(start), getPriority(start, 0));
+
+    std::vector<std::thread> workers;
+    for(unsigned i = 0; i < threadCount; i++)
+        workers.emplace_back([this, &goal](){
+            workerLoop(goal);
+        });
+
+    for(auto& worker : workers)
+        worker.join();
+
+    openStates = std::priority_queue<OpenState>();
+    return result;
+}
+
+bool CHIP8_Search::markVisited(uint64_t hash)
+{
+    //the low bits pick the shard, the hash set uses all of them
+    VisitedShard& shard = visited[hash % visitedShardCount];
+
+    std::unique_lock<std::mutex> lck{shard.mtx};
+    return shard.hashes.insert(hash).second;
+}
+
+int64_t CHIP8_Search::getPriority(const CHIP8_State& state, int depth) const
+{
+    if(strategy == Strategy::BestFirst && score)
+        return score(state);
+    return -(int64_t)depth;
+}
+
+void CHIP8_Search::push(std::size_t node, std::shared_ptr<CHIP8_State> state, int64_t priority)
+{
+    openStates.push(OpenState{ priority, nextSequence++, node, state });
+}
+
+std::vector<uint16_t> CHIP8_Search::getInputs(std::size_t node)
+{
+    std::vector<uint16_t> path;
+    for(; node != 0; node = nodes[node].parent)
+        path.push_back(nodes[node].input);
+
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void CHIP8_Search::workerLoop(const Goal& goal)
+{
+    CHIP8_Mediator mediator;
+    CHIP8 vm(mediator);
+    vm.setFaultLog(nullptr);
+    vm.setDisplayWait(true);
+    vm.setInstructionsPerFrame(instructionsPerFrame);
+
+    struct Child
+    {
+        uint16_t input;
+        std::shared_ptr<CHIP8_State> state;
+        int64_t priority;
+        bool isGoal;
+    };
+    std::vector<Child> children;
+
+    std::unique_lock<std::mutex> lck{mtx};
+
+    while(true)
+    {
+        openCV.wait(lck, [this](){
+            return searchDone || openStates.empty() == false || busyWorkers == 0;
+        });
+
+        if(searchDone)
+            break;
+
+        //nothing left to expand and nobody is producing new states
+        if(openStates.empty())
+        {
+            searchDone = true;
+            openCV.notify_all();
+            break;
+        }
+
+        const OpenState current = openStates.top();
+        openStates.pop();
+        const int depth = nodes[current.node].depth;
+
+        busyWorkers++;
+        result.statesExpanded++;
+
+        lck.unlock();
+
+        uint64_t duplicates = 0;
+        uint64_t faults = 0;
+        children.clear();
+
+        for(uint16_t input : inputs)
+        {
+            mediator.resumeCHIP8();
+            mediator.updateKeyMask(input);
+            vm.restoreState(*current.state);
+
+            //a VM blocked on FX0A still sees its timers tick at the end of the frame
+            if(vm.runFrame() == CHIP8_YieldReason::KeyWait)
+                vm.tickTimers();
+
+            if(vm.hasFaulted())
+            {
+                faults++;
+                continue;
+            }
+
+            if(markVisited(vm.getStateHash()) == false)
+            {
+                duplicates++;
+                continue;
+            }
+
+            std::shared_ptr<CHIP8_State> state = std::make_shared<CHIP8_State>(vm.saveState());
+            const bool isGoal = goal && goal(*state);
+            children.push_back(Child{ input, state, getPriority(*state, depth + 1), isGoal });
+        }
+
+        lck.lock();
+
+        busyWorkers--;
+        result.duplicateStates += duplicates;
+        result.faultedStates += faults;
+
+        for(const Child& child : children)
+        {
+            if(searchDone || result.statesVisited >= maxStates)
+            {
+                searchDone = true;
+                break;
+            }
+
+            const std::size_t node = nodes.size();
+            nodes.push_back(Node{ current.node, child.input, depth + 1 });
+            result.statesVisited++;
+
+            if(child.isGoal)
+            {
+                result.found = true;
+                result.state = *child.state;
+                result.inputs = getInputs(node);
+                searchDone = true;
+                break;
+            }
+
+            if(depth + 1 < maxDepth)
+                push(node, child.state, child.priority);
+        }
+
+        openCV.notify_all();
+    }
+}
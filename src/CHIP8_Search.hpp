@@ -0,0 +1,100 @@
+#pragma once
+
+#include "CHIP8.hpp"
+
+#include <functional>
+#include <queue>
+#include <unordered_set>
+
+struct CHIP8_SearchResult
+{
+    bool found;
+    std::vector<uint16_t> inputs; // key mask held during each frame, from the start state to the goal
+    CHIP8_State state;            // the goal state when found
+
+    uint64_t statesVisited;       // distinct states, the start state included
+    uint64_t statesExpanded;
+    uint64_t duplicateStates;
+    uint64_t faultedStates;
+};
+
+// Explores the states reachable from a start state by holding a key mask for one frame at
+// a time. States are deduplicated by CHIP8::getStateHash() in a sharded visited set, and
+// every worker thread steps its own VM, so expansions run in parallel.
+class CHIP8_Search
+{
+public:
+    enum class Strategy
+    {
+        BreadthFirst,
+        BestFirst     // expands the state with the highest score first
+    };
+
+    typedef std::function<bool(const CHIP8_State&)> Goal;
+    typedef std::function<int64_t(const CHIP8_State&)> Score;
+
+    static const int visitedShardCount = 64;
+
+private:
+    struct Node
+    {
+        std::size_t parent;
+        uint16_t input;
+        int depth;
+    };
+
+    struct OpenState
+    {
+        int64_t priority;
+        uint64_t sequence;
+        std::size_t node;
+        std::shared_ptr<CHIP8_State> state;
+
+        bool operator<(const OpenState& other) const;
+    };
+
+    struct VisitedShard
+    {
+        std::mutex mtx;
+        std::unordered_set<uint64_t> hashes;
+    };
+
+    CHIP8_State start;
+    Strategy strategy;
+    std::vector<uint16_t> inputs;
+    int maxDepth;
+    uint64_t maxStates;
+    unsigned threadCount;
+    int instructionsPerFrame;
+    Score score;
+
+    // shared by the workers during run()
+    std::mutex mtx;
+    std::condition_variable openCV;
+    std::priority_queue<OpenState> openStates;
+    std::deque<Node> nodes;
+    uint64_t nextSequence;
+    unsigned busyWorkers;
+    bool searchDone;
+    CHIP8_SearchResult result;
+    std::vector<VisitedShard> visited;
+
+public:
+    CHIP8_Search(const CHIP8_State& Start);
+
+    void setStrategy(Strategy SearchStrategy, Score ScoreFunction = Score());
+    void setInputs(const std::vector<uint16_t>& Inputs); // by default no key and each key alone
+    void setMaxDepth(int frames);
+    void setMaxStates(uint64_t count);
+    void setThreadCount(unsigned count);
+    void setInstructionsPerFrame(int count);
+
+    CHIP8_SearchResult run(const Goal& goal);
+
+private:
+    bool markVisited(uint64_t hash);
+    int64_t getPriority(const CHIP8_State& state, int depth) const;
+    void push(std::size_t node, std::shared_ptr<CHIP8_State> state, int64_t priority);
+    std::vector<uint16_t> getInputs(std::size_t node);
+    void workerLoop(const Goal& goal);
+};
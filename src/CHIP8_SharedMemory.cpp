@@ -0,0 +1,169 @@
+#include "CHIP8_SharedMemory.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const int CHIP8_SharedMemoryServer::keyPollMiliseconds;
+
+namespace
+{
+    CHIP8_SharedFrame* mapSharedFrame(int file)
+    {
+        void* mapping = mmap(nullptr, sizeof(CHIP8_SharedFrame), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        return mapping == MAP_FAILED ? nullptr : static_cast<CHIP8_SharedFrame*>(mapping);
+    }
+}
+
+CHIP8_SharedMemoryServer::CHIP8_SharedMemoryServer(CHIP8_Mediator& Mediator, const std::string& Name)
+    : mediator(Mediator), name(Name), shared(nullptr), inputShouldStop(false)
+{
+    shm_unlink(name.c_str());
+
+    const int file = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(file < 0)
+        return;
+
+    //ftruncate() zero fills, which is a blank frame at sequence 0 and no keys pressed
+    if(ftruncate(file, sizeof(CHIP8_SharedFrame)) == 0)
+        shared = mapSharedFrame(file);
+    close(file);
+
+    if(shared == nullptr)
+    {
+        shm_unlink(name.c_str());
+        return;
+    }
+
+    shared->version = CHIP8_SharedFrame::currentVersion;
+    shared->magic = CHIP8_SharedFrame::magicValue;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    mediator.addFrameListener(this);
+
+    inputThread = std::thread([this](){
+        inputLoop();
+    });
+}
+
+CHIP8_SharedMemoryServer::~CHIP8_SharedMemoryServer()
+{
+    if(shared == nullptr)
+        return;
+
+    mediator.removeFrameListener(this);
+
+    inputShouldStop.store(true);
+    inputThread.join();
+
+    //attached viewers keep their mapping, new ones can no longer attach
+    munmap(shared, sizeof(CHIP8_SharedFrame));
+    shm_unlink(name.c_str());
+}
+
+bool CHIP8_SharedMemoryServer::isOpen() const
+{
+    return shared != nullptr;
+}
+
+void CHIP8_SharedMemoryServer::onFrame(const CHIP8_FrameBuffer& frameBuffer)
+{
+    const uint64_t sequence = shared->sequence.load(std::memory_order_relaxed);
+
+    shared->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+        shared->rows[y].store(frameBuffer[y], std::memory_order_relaxed);
+
+    shared->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void CHIP8_SharedMemoryServer::inputLoop()
+{
+    uint32_t forwardedMask = 0;
+
+    while(inputShouldStop.load() == false)
+    {
+        const uint32_t keyMask = shared->keyMask.load(std::memory_order_relaxed) & 0xffff;
+        if(keyMask != forwardedMask)
+        {
+            mediator.updateKeyMask(keyMask);
+            forwardedMask = keyMask;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(keyPollMiliseconds));
+    }
+}
+
+CHIP8_SharedMemoryViewer::CHIP8_SharedMemoryViewer(const std::string& name)
+    : shared(nullptr)
+{
+    const int file = shm_open(name.c_str(), O_RDWR, 0);
+    if(file < 0)
+        return;
+
+    struct stat status;
+    if(fstat(file, &status) == 0 && (std::size_t)status.st_size >= sizeof(CHIP8_SharedFrame))
+        shared = mapSharedFrame(file);
+    close(file);
+
+    if(shared == nullptr)
+        return;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(shared->magic != CHIP8_SharedFrame::magicValue || shared->version != CHIP8_SharedFrame::currentVersion)
+    {
+        munmap(shared, sizeof(CHIP8_SharedFrame));
+        shared = nullptr;
+    }
+}
+
+CHIP8_SharedMemoryViewer::~CHIP8_SharedMemoryViewer()
+{
+    if(shared)
+        munmap(shared, sizeof(CHIP8_SharedFrame));
+}
+
+bool CHIP8_SharedMemoryViewer::isOpen() const
+{
+    return shared != nullptr;
+}
+
+uint64_t CHIP8_SharedMemoryViewer::getFrameSequence() const
+{
+    return shared ? shared->sequence.load(std::memory_order_acquire) / 2 : 0;
+}
+
+bool CHIP8_SharedMemoryViewer::readFrame(CHIP8_FrameBuffer& frameBuffer, uint64_t& frameSequence) const
+{
+    if(shared == nullptr)
+        return false;
+
+    frameBuffer.resize(CHIP8_CONSTANTS::frameHeight);
+
+    for(int attempt = 0; attempt < maxReadAttempts; attempt++)
+    {
+        const uint64_t before = shared->sequence.load(std::memory_order_acquire);
+        if(before & 1)
+            continue;
+
+        for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+            frameBuffer[y] = shared->rows[y].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(shared->sequence.load(std::memory_order_relaxed) == before)
+        {
+            frameSequence = before / 2;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CHIP8_SharedMemoryViewer::setKeyMask(uint16_t keyMask)
+{
+    if(shared)
+        shared->keyMask.store(keyMask, std::memory_order_relaxed);
+}
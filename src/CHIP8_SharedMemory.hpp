@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CHIP8_Mediator.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+    "atomics shared between processes have to be lock-free");
+
+// Layout of the shared memory object. The frame is guarded by a sequence lock: the VM makes
+// sequence odd, writes the rows and makes it even again, so readers never block the VM
+// and retry when the sequence moved while they copied.
+struct CHIP8_SharedFrame
+{
+    static const uint32_t magicValue = 0x38504843; // "CHP8"
+    static const uint32_t currentVersion = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint64_t> sequence;  // twice the number of published frames, odd during a write
+    std::atomic<uint64_t> rows[CHIP8_CONSTANTS::frameHeight];
+    std::atomic<uint32_t> keyMask;   // written by viewers, bit N means key N is pressed
+};
+
+// Publishes the frames of one mediator in POSIX shared memory and forwards the key mask
+// viewers write to it. Every viewer maps the same frame, so the VM writes it once no matter
+// how many are attached.
+class CHIP8_SharedMemoryServer : public CHIP8_FrameListener
+{
+public:
+    static const int keyPollMiliseconds = 1;
+
+private:
+    CHIP8_Mediator& mediator;
+    const std::string name;
+    CHIP8_SharedFrame* shared;
+
+    std::thread inputThread;
+    std::atomic<bool> inputShouldStop;
+
+public:
+    // name is a shm_open() name such as "/chip8"; an object left by an earlier server is replaced
+    CHIP8_SharedMemoryServer(CHIP8_Mediator& Mediator, const std::string& Name);
+    ~CHIP8_SharedMemoryServer();
+
+    bool isOpen() const;
+
+    void onFrame(const CHIP8_FrameBuffer& frameBuffer) override;
+
+private:
+    void inputLoop();
+};
+
+class CHIP8_SharedMemoryViewer
+{
+private:
+    CHIP8_SharedFrame* shared;
+
+public:
+    static const int maxReadAttempts = 1000;
+
+    CHIP8_SharedMemoryViewer(const std::string& name);
+    ~CHIP8_SharedMemoryViewer();
+
+    bool isOpen() const;
+
+    // 0 until the first frame is published, then increases with every frame
+    uint64_t getFrameSequence() const;
+
+    // copies the latest frame; false when the VM kept writing during every attempt
+    bool readFrame(CHIP8_FrameBuffer& frameBuffer, uint64_t& frameSequence) const;
+
+    void setKeyMask(uint16_t keyMask);
+};
@@ -0,0 +1,169 @@
+#include "CHIP8_Spectator.hpp"
+
+#include <cmath>
+
+CHIP8_Spectator::CHIP8_Spectator(const std::string& filepath, int count)
+    : executor(std::thread::hardware_concurrency(), true), romLoaded(true),
+        brickColor(sf::Color(66, 253, 110)), borderColor(sf::Color(40, 40, 40))
+{
+    count = std::max(count, 1);
+
+    const uint64_t seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+
+    for(int i = 0; i < count && romLoaded; i++)
+    {
+        mediators.emplace_back(new CHIP8_Mediator());
+        vms.emplace_back(new CHIP8(*mediators.back()));
+
+        romLoaded = vms.back()->loadMemoryImage(filepath);
+        vms.back()->seedRNG(seed + i);
+        frames.emplace_back(CHIP8_CONSTANTS::frameHeight, 0);
+    }
+
+    if(romLoaded == false)
+        std::cout << "UNABLE TO OPEN A FILE!" << std::endl;
+
+    //as square a grid as possible, wider than tall
+    columns = (int)std::ceil(std::sqrt((double)count));
+    rows = (count + columns - 1) / columns;
+    scale = std::max(1, maxWindowWidth / (columns * cellWidth));
+}
+
+CHIP8_Spectator::~CHIP8_Spectator()
+{
+    stopAll();
+}
+
+std::size_t CHIP8_Spectator::getCount() const
+{
+    return vms.size();
+}
+
+void CHIP8_Spectator::setTiming(CHIP8_Timing timing)
+{
+    for(std::unique_ptr<CHIP8>& vm : vms)
+        vm->setTiming(timing);
+}
+
+void CHIP8_Spectator::setBlending(bool blending)
+{
+    blenders.clear();
+    for(std::size_t i = 0; blending && i < vms.size(); i++)
+        blenders.emplace_back(new CHIP8_FrameBlender(brickColor.r, brickColor.g, brickColor.b));
+}
+
+void CHIP8_Spectator::stopAll()
+{
+    for(std::unique_ptr<CHIP8_Mediator>& mediator : mediators)
+        mediator->stopCHIP8();
+}
+
+sf::Uint8* CHIP8_Spectator::getCellPixels(int cell)
+{
+    const int atlasWidth = columns * cellWidth;
+    const int left = (cell % columns) * cellWidth;
+    const int top = (cell / columns) * cellHeight;
+
+    return &atlasPixels[4 * (top * atlasWidth + left)];
+}
+
+void CHIP8_Spectator::writeRow(int cell, const CHIP8_FrameBuffer& frameBuffer, int y)
+{
+    sf::Uint8* pixel = getCellPixels(cell) + 4 * y * columns * cellWidth;
+    for(int x = 0; x < CHIP8_CONSTANTS::frameWidth; x++, pixel += 4)
+    {
+        const sf::Color color = getPixel(frameBuffer, x, y) ? brickColor : sf::Color::Black;
+        pixel[0] = color.r;
+        pixel[1] = color.g;
+        pixel[2] = color.b;
+        pixel[3] = color.a;
+    }
+}
+
+bool CHIP8_Spectator::updateAtlas()
+{
+    bool changed = false;
+
+    for(std::size_t cell = 0; cell < mediators.size(); cell++)
+    {
+        uint32_t changedRows = 0;
+        if(mediators[cell]->hasFrameBufferChanged())
+            frames[cell] = mediators[cell]->getNewFrameBuffer(changedRows);
+
+        if(blenders.empty() == false && (changedRows != 0 || blenders[cell]->isFading()))
+        {
+            blenders[cell]->blend(frames[cell], getCellPixels(cell), 4 * columns * cellWidth);
+            changed = true;
+        }
+        else if(blenders.empty() && changedRows != 0)
+        {
+            for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+                if(changedRows & (1u << y))
+                    writeRow(cell, frames[cell], y);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void CHIP8_Spectator::run()
+{
+    if(romLoaded == false)
+        return;
+
+    const int atlasWidth = columns * cellWidth;
+    const int atlasHeight = rows * cellHeight;
+
+    if(atlas.create(atlasWidth, atlasHeight) == false)
+    {
+        std::cout << "TOO MANY VMS FOR ONE TEXTURE!" << std::endl;
+        return;
+    }
+
+    //borders everywhere, then a blank screen in every cell that holds a VM
+    atlasPixels.resize(4 * atlasWidth * atlasHeight);
+    for(std::size_t i = 0; i < atlasPixels.size(); i += 4)
+    {
+        atlasPixels[i] = borderColor.r;
+        atlasPixels[i + 1] = borderColor.g;
+        atlasPixels[i + 2] = borderColor.b;
+        atlasPixels[i + 3] = borderColor.a;
+    }
+    const CHIP8_FrameBuffer blank(CHIP8_CONSTANTS::frameHeight, 0);
+    for(std::size_t cell = 0; cell < vms.size(); cell++)
+        for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+            writeRow(cell, blank, y);
+    atlas.update(atlasPixels.data());
+
+    screen.setTexture(atlas, true);
+    screen.setScale(scale, scale);
+
+    window.create(sf::VideoMode(atlasWidth * scale, atlasHeight * scale),
+                    "CHIP8 v1.0 - " + std::to_string(vms.size()) + " VMs", sf::Style::Titlebar | sf::Style::Close);
+    window.setFramerateLimit(60);
+
+    for(std::unique_ptr<CHIP8>& vm : vms)
+        executor.add(*vm);
+
+    while (window.isOpen())
+    {
+        while (window.pollEvent(event))
+        {
+            if (event.type == sf::Event::Closed)
+            {
+                stopAll();
+                window.close();
+            }
+        }
+
+        //one upload for every VM that published since the last redraw
+        if(updateAtlas())
+            atlas.update(atlasPixels.data());
+
+        window.clear(borderColor);
+        window.draw(screen);
+        window.display();
+    }
+
+    executor.waitAll();
+}
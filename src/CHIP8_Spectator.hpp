@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CHIP8_Executor.hpp"
+#include "CHIP8_FrameBlender.hpp"
+#include <SFML/Window.hpp>
+#include <SFML/Graphics.hpp>
+
+#include <memory>
+
+// Runs many copies of one ROM on a CHIP8_Executor and shows them side by side. Every VM owns
+// a cell of a single texture atlas: changed rows are written into a CPU copy of the atlas,
+// which is uploaded once per redraw and drawn with one sprite, so the cost per redraw is
+// one upload and one draw call no matter how many VMs are shown.
+class CHIP8_Spectator
+{
+public:
+    static const int cellWidth = CHIP8_CONSTANTS::frameWidth + 1;   // one pixel wide border
+    static const int cellHeight = CHIP8_CONSTANTS::frameHeight + 1;
+    static const int maxWindowWidth = 1280;
+
+private:
+    std::vector<std::unique_ptr<CHIP8_Mediator>> mediators;
+    std::vector<std::unique_ptr<CHIP8>> vms;
+    std::vector<CHIP8_FrameBuffer> frames; // the last frame taken from every VM
+    std::vector<std::unique_ptr<CHIP8_FrameBlender>> blenders; // one per VM with blending, else none
+    CHIP8_Executor executor;
+    bool romLoaded;
+
+    int columns;
+    int rows;
+    int scale;
+
+    sf::RenderWindow window;
+    sf::Texture atlas;
+    sf::Sprite screen;
+    std::vector<sf::Uint8> atlasPixels;
+    sf::Event event;
+
+    sf::Color brickColor;
+    sf::Color borderColor;
+
+public:
+    // every VM gets its own RNG seed, so random games play out differently
+    CHIP8_Spectator(const std::string& filepath, int count);
+    ~CHIP8_Spectator();
+
+    std::size_t getCount() const;
+    void setTiming(CHIP8_Timing timing); // of every VM, before run()
+    void setBlending(bool blending); // phosphor persistence for every VM, before run()
+
+    void run();
+
+private:
+    void stopAll();
+    // copies the changed rows of every VM into atlasPixels, or its whole blended screen while
+    // it changes or fades, true when anything changed
+    bool updateAtlas();
+    void writeRow(int cell, const CHIP8_FrameBuffer& frameBuffer, int y);
+    sf::Uint8* getCellPixels(int cell);
+};
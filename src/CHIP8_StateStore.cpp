@@ -0,0 +1,514 @@
+#include "CHIP8_StateStore.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The index is mapped as is, so it is native-endian; the state records are not.
+struct CHIP8_StateStore::IndexHeader
+{
+    char magic[8];
+    uint64_t version;
+    uint64_t capacity;        // slots per table, a power of two
+    uint64_t checkpointCount;
+    uint64_t stateCount;
+    uint64_t dataSize;        // record bytes, the next record is appended after them
+    uint64_t reserved[2];
+};
+
+struct CHIP8_StateStore::CheckpointSlot
+{
+    uint64_t run;
+    uint64_t frame;
+    uint64_t contentHash;
+    uint64_t used;
+};
+
+struct CHIP8_StateStore::StateSlot
+{
+    uint64_t contentHash;
+    uint64_t offset;
+    uint32_t size;
+    uint32_t used;
+};
+
+namespace
+{
+    const char indexMagic[8] = { 'C', '8', 'S', 'T', 'I', 'D', 'X', 0 };
+    const char dataMagic[8] = { 'C', '8', 'S', 'T', 'D', 'A', 'T', 0 };
+    const uint64_t storeVersion = 1;
+
+    // the data file starts with the magic and the size of the base state
+    const std::size_t dataHeaderSize = 16;
+
+    // tables are grown before they are fuller than 7/10
+    bool isCrowded(uint64_t count, uint64_t capacity)
+    {
+        return (count + 1) * 10 > capacity * 7;
+    }
+
+    void putVarint(std::vector<uint8_t>& out, std::size_t value)
+    {
+        while(value >= 0x80)
+        {
+            out.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back((uint8_t)value);
+    }
+
+    bool getVarint(const uint8_t*& data, const uint8_t* end, std::size_t& value)
+    {
+        value = 0;
+        for(int shift = 0; data < end && shift < 64; shift += 7)
+        {
+            const uint8_t byte = *data++;
+            value |= (std::size_t)(byte & 0x7f) << shift;
+            if((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    bool writeAll(int file, const uint8_t* data, std::size_t size, uint64_t offset)
+    {
+        while(size > 0)
+        {
+            const ssize_t written = pwrite(file, data, size, offset);
+            if(written <= 0)
+                return false;
+            data += written;
+            size -= written;
+            offset += written;
+        }
+        return true;
+    }
+
+    bool readAll(int file, uint8_t* data, std::size_t size, uint64_t offset)
+    {
+        while(size > 0)
+        {
+            const ssize_t read = pread(file, data, size, offset);
+            if(read <= 0)
+                return false;
+            data += read;
+            size -= read;
+            offset += read;
+        }
+        return true;
+    }
+}
+
+CHIP8_StateStore::CHIP8_StateStore()
+    : dataFile(-1), indexFile(-1), index(nullptr), indexSize(0)
+{
+}
+
+CHIP8_StateStore::~CHIP8_StateStore()
+{
+    close();
+}
+
+bool CHIP8_StateStore::create(const std::string& Path, const CHIP8_State& baseState)
+{
+    close();
+    path = Path;
+    base = baseState.serialize();
+
+    dataFile = ::open((path + ".dat").c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(dataFile < 0)
+        return false;
+
+    std::vector<uint8_t> dataHeader(dataMagic, dataMagic + sizeof(dataMagic));
+    for(int i = 0; i < 8; i++)
+        dataHeader.push_back((uint8_t)((uint64_t)base.size() >> (8 * i)));
+
+    if(writeAll(dataFile, dataHeader.data(), dataHeader.size(), 0) == false
+        || writeAll(dataFile, base.data(), base.size(), dataHeaderSize) == false
+        || createIndex(path + ".idx", initialCapacity) == false)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CHIP8_StateStore::open(const std::string& Path)
+{
+    close();
+    path = Path;
+
+    dataFile = ::open((path + ".dat").c_str(), O_RDWR);
+    indexFile = ::open((path + ".idx").c_str(), O_RDWR);
+
+    uint8_t dataHeader[dataHeaderSize];
+    if(dataFile < 0 || indexFile < 0 || readAll(dataFile, dataHeader, dataHeaderSize, 0) == false
+        || std::memcmp(dataHeader, dataMagic, sizeof(dataMagic)) != 0)
+    {
+        close();
+        return false;
+    }
+
+    uint64_t baseSize = 0;
+    for(int i = 0; i < 8; i++)
+        baseSize |= (uint64_t)dataHeader[8 + i] << (8 * i);
+
+    if(baseSize != CHIP8_State::serializedSize || mapIndex() == false)
+    {
+        close();
+        return false;
+    }
+
+    base.resize(baseSize);
+    if(readAll(dataFile, base.data(), base.size(), dataHeaderSize) == false)
+    {
+        close();
+        return false;
+    }
+
+    //bytes past dataSize are left alone, they may be a writer's append in progress
+    return true;
+}
+
+void CHIP8_StateStore::close()
+{
+    if(index)
+        flush();
+    unmapIndex();
+
+    if(indexFile >= 0)
+        ::close(indexFile);
+    if(dataFile >= 0)
+        ::close(dataFile);
+
+    indexFile = -1;
+    dataFile = -1;
+    base.clear();
+}
+
+bool CHIP8_StateStore::isOpen() const
+{
+    return index != nullptr;
+}
+
+bool CHIP8_StateStore::put(uint64_t run, uint64_t frame, const CHIP8_State& state)
+{
+    if(isOpen() == false)
+        return false;
+
+    if(isCrowded(header().checkpointCount, header().capacity) || isCrowded(header().stateCount, header().capacity))
+        if(growIndex() == false)
+            return false;
+
+    const std::vector<uint8_t> serialized = state.serialize();
+    const uint64_t hash = contentHash(serialized);
+
+    StateSlot* stateSlot = findState(hash);
+    std::vector<uint8_t> stored;
+    if(stateSlot->used && readRecord(*stateSlot, stored))
+    {
+        //the hash only picks the slot, a different state under the same hash cannot be indexed
+        if(stored != serialized)
+            return false;
+    }
+    else
+    {
+        //a used slot whose record is unreadable was left by a crash and is pointed at a new copy
+        const std::vector<uint8_t> record = compress(base, serialized);
+        const uint64_t offset = dataHeaderSize + base.size() + header().dataSize;
+
+        if(writeAll(dataFile, record.data(), record.size(), offset) == false)
+            return false;
+
+        if(stateSlot->used == 0)
+            header().stateCount++;
+
+        stateSlot->contentHash = hash;
+        stateSlot->offset = offset;
+        stateSlot->size = (uint32_t)record.size();
+        stateSlot->used = 1;
+        header().dataSize += record.size();
+    }
+
+    CheckpointSlot* checkpointSlot = findCheckpoint(run, frame);
+    if(checkpointSlot->used == 0)
+    {
+        checkpointSlot->run = run;
+        checkpointSlot->frame = frame;
+        checkpointSlot->used = 1;
+        header().checkpointCount++;
+    }
+    checkpointSlot->contentHash = hash;
+
+    return true;
+}
+
+bool CHIP8_StateStore::get(uint64_t run, uint64_t frame, CHIP8_State& state) const
+{
+    uint64_t hash;
+    return findHash(run, frame, hash) && getByHash(hash, state);
+}
+
+bool CHIP8_StateStore::getByHash(uint64_t contentHash, CHIP8_State& state) const
+{
+    if(isOpen() == false)
+        return false;
+
+    const StateSlot* slot = findState(contentHash);
+    std::vector<uint8_t> serialized;
+
+    return slot->used && readRecord(*slot, serialized) && state.deserialize(serialized.data(), serialized.size());
+}
+
+bool CHIP8_StateStore::findHash(uint64_t run, uint64_t frame, uint64_t& contentHash) const
+{
+    if(isOpen() == false)
+        return false;
+
+    const CheckpointSlot* slot = findCheckpoint(run, frame);
+    if(slot->used == 0)
+        return false;
+
+    contentHash = slot->contentHash;
+    return true;
+}
+
+uint64_t CHIP8_StateStore::getCheckpointCount() const
+{
+    return isOpen() ? header().checkpointCount : 0;
+}
+
+uint64_t CHIP8_StateStore::getStateCount() const
+{
+    return isOpen() ? header().stateCount : 0;
+}
+
+uint64_t CHIP8_StateStore::getDataSize() const
+{
+    return isOpen() ? header().dataSize : 0;
+}
+
+void CHIP8_StateStore::flush()
+{
+    //records first, so an index on disk after a flush only refers to records on disk
+    if(dataFile >= 0)
+        fdatasync(dataFile);
+    if(index)
+        msync(index, indexSize, MS_SYNC);
+}
+
+uint64_t CHIP8_StateStore::contentHash(const std::vector<uint8_t>& serialized)
+{
+    uint64_t hash = serialized.size();
+    uint64_t word = 0;
+
+    for(std::size_t i = 0; i < serialized.size(); i++)
+    {
+        word = (word << 8) | serialized[i];
+        if(i % 8 == 7)
+        {
+            hash = CHIP8_HASH::combine(hash, word);
+            word = 0;
+        }
+    }
+    return CHIP8_HASH::combine(hash, word);
+}
+
+// A record is a list of (bytes equal to the base, literal bytes) pairs, both counts as
+// LEB128 varints followed by the literal bytes. Runs of fewer than 4 equal bytes are cheaper
+// to keep in the literal.
+std::vector<uint8_t> CHIP8_StateStore::compress(const std::vector<uint8_t>& base, const std::vector<uint8_t>& serialized)
+{
+    static const std::size_t minimumRun = 4;
+
+    std::vector<uint8_t> record;
+    const std::size_t size = serialized.size();
+    std::size_t position = 0;
+
+    while(position < size)
+    {
+        std::size_t literalStart = position;
+        while(literalStart < size && serialized[literalStart] == base[literalStart])
+            literalStart++;
+
+        std::size_t literalEnd = literalStart;
+        while(literalEnd < size)
+        {
+            std::size_t runEnd = literalEnd;
+            while(runEnd < size && runEnd - literalEnd < minimumRun && serialized[runEnd] == base[runEnd])
+                runEnd++;
+
+            if(runEnd - literalEnd == minimumRun || runEnd == size)
+                break;
+            literalEnd = runEnd + 1;
+        }
+
+        putVarint(record, literalStart - position);
+        putVarint(record, literalEnd - literalStart);
+        record.insert(record.end(), serialized.begin() + literalStart, serialized.begin() + literalEnd);
+        position = literalEnd;
+    }
+
+    return record;
+}
+
+bool CHIP8_StateStore::decompress(const std::vector<uint8_t>& base, const uint8_t* data, std::size_t size,
+    std::vector<uint8_t>& serialized)
+{
+    const uint8_t* end = data + size;
+    serialized.clear();
+    serialized.reserve(base.size());
+
+    while(data < end)
+    {
+        std::size_t equal, literal;
+        if(getVarint(data, end, equal) == false || getVarint(data, end, literal) == false
+            || equal > base.size() - serialized.size() || literal > base.size() - serialized.size() - equal
+            || literal > (std::size_t)(end - data))
+            return false;
+
+        serialized.insert(serialized.end(), base.begin() + serialized.size(), base.begin() + serialized.size() + equal);
+        serialized.insert(serialized.end(), data, data + literal);
+        data += literal;
+    }
+
+    return serialized.size() == base.size();
+}
+
+CHIP8_StateStore::IndexHeader& CHIP8_StateStore::header() const
+{
+    return *reinterpret_cast<IndexHeader*>(index);
+}
+
+CHIP8_StateStore::CheckpointSlot* CHIP8_StateStore::checkpointSlots() const
+{
+    return reinterpret_cast<CheckpointSlot*>(index + sizeof(IndexHeader));
+}
+
+CHIP8_StateStore::StateSlot* CHIP8_StateStore::stateSlots() const
+{
+    return reinterpret_cast<StateSlot*>(index + sizeof(IndexHeader) + header().capacity * sizeof(CheckpointSlot));
+}
+
+bool CHIP8_StateStore::mapIndex()
+{
+    struct stat status;
+    if(fstat(indexFile, &status) != 0 || (std::size_t)status.st_size < sizeof(IndexHeader))
+        return false;
+
+    void* mapping = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, indexFile, 0);
+    if(mapping == MAP_FAILED)
+        return false;
+
+    index = static_cast<uint8_t*>(mapping);
+    indexSize = status.st_size;
+
+    const uint64_t capacity = header().capacity;
+    const bool valid = std::memcmp(header().magic, indexMagic, sizeof(indexMagic)) == 0
+        && header().version == storeVersion && capacity > 0 && (capacity & (capacity - 1)) == 0
+        && indexSize == sizeof(IndexHeader) + capacity * (sizeof(CheckpointSlot) + sizeof(StateSlot));
+
+    if(valid == false)
+        unmapIndex();
+    return valid;
+}
+
+void CHIP8_StateStore::unmapIndex()
+{
+    if(index)
+        munmap(index, indexSize);
+    index = nullptr;
+    indexSize = 0;
+}
+
+bool CHIP8_StateStore::createIndex(const std::string& indexPath, uint64_t capacity)
+{
+    const std::size_t size = sizeof(IndexHeader) + capacity * (sizeof(CheckpointSlot) + sizeof(StateSlot));
+
+    indexFile = ::open(indexPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(indexFile < 0)
+        return false;
+
+    //the header is written first, ftruncate() zero fills the tables
+    IndexHeader newHeader = {};
+    std::memcpy(newHeader.magic, indexMagic, sizeof(indexMagic));
+    newHeader.version = storeVersion;
+    newHeader.capacity = capacity;
+
+    return writeAll(indexFile, reinterpret_cast<const uint8_t*>(&newHeader), sizeof(newHeader), 0)
+        && ftruncate(indexFile, size) == 0 && mapIndex();
+}
+
+bool CHIP8_StateStore::growIndex()
+{
+    const IndexHeader oldHeader = header();
+    const std::vector<CheckpointSlot> checkpoints(checkpointSlots(), checkpointSlots() + oldHeader.capacity);
+    const std::vector<StateSlot> states(stateSlots(), stateSlots() + oldHeader.capacity);
+
+    unmapIndex();
+    ::close(indexFile);
+
+    //the bigger index replaces the old one only once it is complete
+    const std::string indexPath = path + ".idx";
+    if(createIndex(indexPath + ".tmp", oldHeader.capacity * 2) == false)
+    {
+        close();
+        return false;
+    }
+
+    for(const CheckpointSlot& slot : checkpoints)
+        if(slot.used)
+            *findCheckpoint(slot.run, slot.frame) = slot;
+    for(const StateSlot& slot : states)
+        if(slot.used)
+            *findState(slot.contentHash) = slot;
+
+    header().checkpointCount = oldHeader.checkpointCount;
+    header().stateCount = oldHeader.stateCount;
+    header().dataSize = oldHeader.dataSize;
+
+    flush();
+    if(std::rename((indexPath + ".tmp").c_str(), indexPath.c_str()) != 0)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CHIP8_StateStore::readRecord(const StateSlot& slot, std::vector<uint8_t>& serialized) const
+{
+    //a slot past dataSize or whose bytes don't hash to it lost its record in a crash or was
+    //overwritten by a later append; either way it doesn't hold the state
+    if(slot.offset < dataHeaderSize + base.size() || slot.offset + slot.size > dataHeaderSize + base.size() + header().dataSize)
+        return false;
+
+    std::vector<uint8_t> record(slot.size);
+    return readAll(dataFile, record.data(), record.size(), slot.offset)
+        && decompress(base, record.data(), record.size(), serialized)
+        && contentHash(serialized) == slot.contentHash;
+}
+
+CHIP8_StateStore::CheckpointSlot* CHIP8_StateStore::findCheckpoint(uint64_t run, uint64_t frame) const
+{
+    const uint64_t mask = header().capacity - 1;
+    CheckpointSlot* slots = checkpointSlots();
+
+    for(uint64_t i = CHIP8_HASH::mix(run ^ CHIP8_HASH::mix(frame)) & mask;; i = (i + 1) & mask)
+        if(slots[i].used == 0 || (slots[i].run == run && slots[i].frame == frame))
+            return &slots[i];
+}
+
+CHIP8_StateStore::StateSlot* CHIP8_StateStore::findState(uint64_t contentHash) const
+{
+    const uint64_t mask = header().capacity - 1;
+    StateSlot* slots = stateSlots();
+
+    for(uint64_t i = CHIP8_HASH::mix(contentHash) & mask;; i = (i + 1) & mask)
+        if(slots[i].used == 0 || slots[i].contentHash == contentHash)
+            return &slots[i];
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "CHIP8.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Append-only on-disk store of checkpoints, POSIX only.
+//
+// PATH.dat holds the base state followed by every distinct state, XORed against the base
+// and run-length encoded, so a checkpoint costs roughly the bytes that differ from the
+// base. PATH.idx is memory-mapped and holds two open-addressing tables: (run, frame) ->
+// content hash and content hash -> record. Opening a store maps the index without reading
+// the data, and a lookup is two probes and one pread().
+//
+// Nothing is synced until flush(), which syncs the records before the index. The kernel may
+// still write the mapped index back earlier, so a record is checked against its content
+// hash when read: after a crash the states whose records didn't reach the disk are missing
+// and are stored again by the next put().
+//
+// Not thread-safe: one thread may put(), concurrent readers need their own store object
+// opened after the writer flushed.
+class CHIP8_StateStore
+{
+private:
+    struct IndexHeader;
+    struct CheckpointSlot;
+    struct StateSlot;
+
+    static const uint64_t initialCapacity = 1024;
+
+    std::string path;
+    int dataFile;
+    int indexFile;
+
+    uint8_t* index;
+    std::size_t indexSize;
+
+    std::vector<uint8_t> base; // serialized base state
+
+public:
+    CHIP8_StateStore();
+    ~CHIP8_StateStore();
+
+    // base is usually the state right after the ROM was loaded; an existing store is replaced
+    bool create(const std::string& Path, const CHIP8_State& baseState);
+    bool open(const std::string& Path);
+    void close();
+    bool isOpen() const;
+
+    // stores the state unless an identical one is stored already, a checkpoint that exists
+    // is pointed at the new state; returns false when the files could not be written or a
+    // different state has the same content hash
+    bool put(uint64_t run, uint64_t frame, const CHIP8_State& state);
+
+    bool get(uint64_t run, uint64_t frame, CHIP8_State& state) const;
+    bool getByHash(uint64_t contentHash, CHIP8_State& state) const;
+    bool findHash(uint64_t run, uint64_t frame, uint64_t& contentHash) const;
+
+    uint64_t getCheckpointCount() const;
+    uint64_t getStateCount() const;   // distinct states
+    uint64_t getDataSize() const;     // bytes of state records, without the base
+
+    // syncs the records, then writes the mapped index back to disk
+    void flush();
+
+    // hash of every serialized byte, unlike CHIP8_State::hash() it includes the cycle count
+    static uint64_t contentHash(const std::vector<uint8_t>& serialized);
+
+    static std::vector<uint8_t> compress(const std::vector<uint8_t>& base, const std::vector<uint8_t>& serialized);
+    static bool decompress(const std::vector<uint8_t>& base, const uint8_t* data, std::size_t size,
+        std::vector<uint8_t>& serialized);
+
+private:
+    IndexHeader& header() const;
+    CheckpointSlot* checkpointSlots() const;
+    StateSlot* stateSlots() const;
+
+    bool mapIndex();
+    void unmapIndex();
+    bool createIndex(const std::string& indexPath, uint64_t capacity);
+    bool growIndex();
+
+    CheckpointSlot* findCheckpoint(uint64_t run, uint64_t frame) const;
+    StateSlot* findState(uint64_t contentHash) const;
+    bool readRecord(const StateSlot& slot, std::vector<uint8_t>& serialized) const;
+};
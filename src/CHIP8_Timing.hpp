@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+enum class CHIP8_Timing : uint8_t
+{
+    Instructions, // every instruction costs the same, a frame runs a fixed number of them
+    CosmacVIP     // instructions cost what they took on the COSMAC VIP, a frame runs a budget of machine cycles
+};
+
+// Instruction costs of the original COSMAC VIP interpreter in 1802 machine cycles (8 clock
+// cycles of the 1.76 MHz crystal). They are rounded averages: the real costs also vary with
+// operand values and page crossings, which no ROM is known to depend on.
+namespace CHIP8_TIMING
+{
+    static const int machineCyclesPerSecond = 1760900 / 8;
+    // the display DMA steals one machine cycle for every byte it shows, 8 bytes per row,
+    // every row shown 4 times
+    static const int displayCyclesPerFrame = 8 * 32 * 4;
+    static const int cyclesPerFrame = machineCyclesPerSecond / 60 - displayCyclesPerFrame;
+
+    static const int fetchCycles = 40;      // fetching and dispatching any instruction
+    static const int skipCycles = 4;        // extra for a 3XNN, 4XNN, 5XY0, 9XY0, EX9E or EXA1 that skips
+    static const int spriteRowCycles = 46;  // for every row DXYN draws
+
+    // indexed by the top nibble, the 0, D and F groups are refined by getCycleCost()
+    static const uint16_t groupCycles[16] = {
+        10, 12, 26, 10, 10, 14, 6, 10, 44, 14, 12, 22, 36, 26, 14, 10
+    };
+
+    static const uint16_t skipGroups = (1 << 0x3) | (1 << 0x4) | (1 << 0x5) | (1 << 0x9) | (1 << 0xe);
+
+    inline int getCycleCost(uint16_t opcode)
+    {
+        const int group = opcode >> 12;
+        int cycles = fetchCycles + groupCycles[group];
+
+        if(group == 0xd)
+            cycles += spriteRowCycles * (opcode & 0xf);
+        else if(opcode == 0x00e0)
+            cycles = fetchCycles + 1562; // clears 256 bytes of display memory
+        else if(group == 0xf)
+        {
+            switch(opcode & 0xff)
+            {
+                case 0x0a: cycles += 9; break;
+                case 0x1e:
+                case 0x29: cycles += 6; break;
+                case 0x33: cycles += 74; break;
+                case 0x55:
+                case 0x65: cycles += 4 + 14 * (((opcode >> 8) & 0xf) + 1); break;
+            }
+        }
+        return cycles;
+    }
+
+    // previousPC is where the instruction was fetched, PC where the VM continues
+    inline int getCycleCost(uint16_t opcode, uint16_t previousPC, uint16_t PC)
+    {
+        const bool skipped = ((skipGroups >> (opcode >> 12)) & 1) && PC == (uint16_t)(previousPC + 4);
+        return getCycleCost(opcode) + (skipped ? skipCycles : 0);
+    }
+}
@@ -0,0 +1,86 @@
+#include "CHIP8_Tracer.hpp"
+
+#include <cstring>
+#include <chrono>
+
+const char CHIP8_Tracer::fileMagic[8] = { 'C', 'H', '8', 'T', 'R', 'A', 'C', 'E' };
+
+CHIP8_Tracer::CHIP8_Tracer(const std::string& filename, std::size_t capacity)
+    : ring(capacity), file(filename, std::ios::out | std::ios::binary | std::ios::trunc),
+    writerShouldStop(false), droppedRecords(0)
+{
+    if(file.good() == false)
+        return;
+
+    const uint32_t header[2] = { fileVersion, (uint32_t)sizeof(CHIP8_TraceRecord) };
+    file.write(fileMagic, sizeof(fileMagic));
+    file.write((const char*)header, sizeof(header));
+
+    writerThread = std::thread([this](){
+        writerLoop();
+    });
+}
+
+CHIP8_Tracer::~CHIP8_Tracer()
+{
+    writerShouldStop.store(true);
+    if(writerThread.joinable())
+        writerThread.join();
+}
+
+bool CHIP8_Tracer::isOpen() const
+{
+    return file.is_open() && file.good();
+}
+
+uint64_t CHIP8_Tracer::getDroppedRecords() const
+{
+    return droppedRecords.load(std::memory_order_relaxed);
+}
+
+void CHIP8_Tracer::writerLoop()
+{
+    std::vector<CHIP8_TraceRecord> batch(writerBatchSize);
+
+    while(true)
+    {
+        const bool lastPass = writerShouldStop.load();
+        const std::size_t count = ring.popMany(batch.data(), batch.size());
+
+        if(count > 0)
+            file.write((const char*)batch.data(), count * sizeof(CHIP8_TraceRecord));
+        else if(lastPass)
+            break;
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    file.flush();
+}
+
+CHIP8_TraceReader::CHIP8_TraceReader(const std::string& filename)
+    : file(filename, std::ios::in | std::ios::binary), valid(false)
+{
+    char magic[sizeof(CHIP8_Tracer::fileMagic)];
+    uint32_t header[2];
+
+    if(!file.read(magic, sizeof(magic)) || !file.read((char*)header, sizeof(header)))
+        return;
+
+    valid = std::memcmp(magic, CHIP8_Tracer::fileMagic, sizeof(magic)) == 0
+        && header[0] == CHIP8_Tracer::fileVersion
+        && header[1] == sizeof(CHIP8_TraceRecord);
+}
+
+bool CHIP8_TraceReader::isValid() const
+{
+    return valid;
+}
+
+bool CHIP8_TraceReader::next(CHIP8_TraceRecord& traceRecord)
+{
+    if(valid == false)
+        return false;
+
+    return (bool)file.read((char*)&traceRecord, sizeof(CHIP8_TraceRecord));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <atomic>
+
+#include "CHIP8_RingBuffer.hpp"
+
+struct CHIP8_TraceRecord
+{
+    uint64_t cycle;
+    uint16_t PC;
+    uint16_t opcode;
+    uint16_t I;
+    uint16_t changedRegisters; // bit n is set when V[n] was modified by the instruction
+    uint8_t V[16];             // registers after the instruction
+};
+
+static_assert(sizeof(CHIP8_TraceRecord) == 32, "trace records are stored as raw 32 byte blocks");
+
+// Trace file layout: "CH8TRACE", uint32 version, uint32 record size, then raw records.
+class CHIP8_Tracer
+{
+public:
+    static const char fileMagic[8];
+    static const uint32_t fileVersion = 1;
+
+    static const int defaultCapacity = 1 << 16;
+    static const int writerBatchSize = 1024;
+
+private:
+    CHIP8_RingBuffer<CHIP8_TraceRecord> ring;
+    std::ofstream file;
+
+    std::thread writerThread;
+    std::atomic<bool> writerShouldStop;
+    std::atomic<uint64_t> droppedRecords;
+
+public:
+    CHIP8_Tracer(const std::string& filename, std::size_t capacity = defaultCapacity);
+    ~CHIP8_Tracer();
+
+    bool isOpen() const;
+
+    // Called from the VM thread, never blocks. Records are dropped when the writer falls behind.
+    void record(const CHIP8_TraceRecord& traceRecord)
+    {
+        if(ring.tryPush(traceRecord) == false)
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t getDroppedRecords() const;
+
+private:
+    void writerLoop();
+};
+
+class CHIP8_TraceReader
+{
+private:
+    std::ifstream file;
+    bool valid;
+
+public:
+    CHIP8_TraceReader(const std::string& filename);
+
+    bool isValid() const;
+    bool next(CHIP8_TraceRecord& traceRecord);
+};
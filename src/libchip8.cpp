@@ -0,0 +1,234 @@
+#include "libchip8.h"
+
+#include "CHIP8.hpp"
+#include "CHIP8_FrameCapture.hpp"
+
+#include <memory>
+
+struct chip8_vm
+{
+    CHIP8_Mediator mediator;
+    CHIP8 chip8;
+    uint16_t keyMask;
+    std::unique_ptr<CHIP8_FrameCapture> capture;
+
+    chip8_vm()
+        : mediator(), chip8(mediator), keyMask(0)
+    {
+        //faults are reported through chip8_get_fault() instead of stdout
+        chip8.setFaultLog(nullptr);
+        chip8.setDisplayWait(true);
+    }
+
+    void resume()
+    {
+        mediator.resumeCHIP8();
+        mediator.updateKeyMask(keyMask);
+    }
+};
+
+static_assert(CHIP8_FRAME_WIDTH == CHIP8_CONSTANTS::frameWidth, "frame width mismatch");
+static_assert(CHIP8_FRAME_HEIGHT == CHIP8_CONSTANTS::frameHeight, "frame height mismatch");
+
+chip8_vm* chip8_create(void)
+{
+    try
+    {
+        return new chip8_vm();
+    }
+    catch(...)
+    {
+        return nullptr;
+    }
+}
+
+void chip8_destroy(chip8_vm* vm)
+{
+    delete vm;
+}
+
+chip8_status chip8_load(chip8_vm* vm, const uint8_t* rom, size_t size)
+{
+    if(vm == nullptr || (rom == nullptr && size != 0))
+        return CHIP8_ERROR;
+
+    vm->chip8.reset();
+    vm->resume();
+
+    return vm->chip8.loadMemoryImage(rom, size) ? CHIP8_OK : CHIP8_ERROR;
+}
+
+void chip8_seed(chip8_vm* vm, uint64_t seed)
+{
+    if(vm)
+        vm->chip8.seedRNG(seed);
+}
+
+chip8_status chip8_step_cycles(chip8_vm* vm, uint64_t count, uint64_t* executed)
+{
+    if(vm == nullptr)
+        return CHIP8_ERROR;
+
+    const uint64_t ran = vm->chip8.runCycles(count);
+    if(executed)
+        *executed = ran;
+
+    if(vm->chip8.hasFaulted())
+        return CHIP8_FAULT;
+    return vm->chip8.isWaitingForKey() ? CHIP8_KEY_WAIT : CHIP8_OK;
+}
+
+chip8_status chip8_step_frames(chip8_vm* vm, uint64_t count)
+{
+    if(vm == nullptr)
+        return CHIP8_ERROR;
+
+    for(uint64_t i = 0; i < count; i++)
+    {
+        switch(vm->chip8.runFrame())
+        {
+            case CHIP8_YieldReason::FrameEnd:
+                break;
+            case CHIP8_YieldReason::KeyWait:
+                return CHIP8_KEY_WAIT;
+            case CHIP8_YieldReason::Fault:
+                return CHIP8_FAULT;
+            case CHIP8_YieldReason::Stopped:
+                return CHIP8_ERROR;
+        }
+    }
+
+    return CHIP8_OK;
+}
+
+void chip8_set_instructions_per_frame(chip8_vm* vm, int count)
+{
+    if(vm && count > 0)
+        vm->chip8.setInstructionsPerFrame(count);
+}
+
+void chip8_set_timing(chip8_vm* vm, chip8_timing timing)
+{
+    if(vm && (timing == CHIP8_TIMING_INSTRUCTIONS || timing == CHIP8_TIMING_COSMAC_VIP))
+        vm->chip8.setTiming(timing == CHIP8_TIMING_COSMAC_VIP ? CHIP8_Timing::CosmacVIP : CHIP8_Timing::Instructions);
+}
+
+void chip8_set_keys(chip8_vm* vm, uint16_t key_mask)
+{
+    if(vm == nullptr)
+        return;
+
+    vm->keyMask = key_mask;
+    vm->mediator.updateKeyMask(key_mask);
+}
+
+const uint64_t* chip8_framebuffer(const chip8_vm* vm)
+{
+    return vm ? vm->chip8.getFrameBuffer().data() : nullptr;
+}
+
+int chip8_sound_active(const chip8_vm* vm)
+{
+    return vm && vm->mediator.isSoundEffect();
+}
+
+uint64_t chip8_cycle_count(const chip8_vm* vm)
+{
+    return vm ? vm->chip8.getCycleCount() : 0;
+}
+
+chip8_status chip8_get_fault(const chip8_vm* vm, chip8_fault* fault)
+{
+    if(vm == nullptr || fault == nullptr)
+        return CHIP8_ERROR;
+
+    const CHIP8_Fault& vmFault = vm->chip8.getFault();
+    fault->kind = (uint8_t)vmFault.kind;
+    fault->pc = vmFault.PC;
+    fault->opcode = vmFault.opcode;
+    fault->cycle = vmFault.cycle;
+
+    return vm->chip8.hasFaulted() ? CHIP8_FAULT : CHIP8_OK;
+}
+
+chip8_status chip8_capture_start(chip8_vm* vm, const char* path, chip8_capture_format format, int scale)
+{
+    if(vm == nullptr || path == nullptr || scale < 1
+        || (format != CHIP8_CAPTURE_Y4M && format != CHIP8_CAPTURE_RAW_RGB))
+        return CHIP8_ERROR;
+
+    chip8_capture_stop(vm);
+
+    try
+    {
+        vm->capture.reset(new CHIP8_FrameCapture(path, format == CHIP8_CAPTURE_Y4M ?
+            CHIP8_CaptureFormat::Y4M : CHIP8_CaptureFormat::RawRGB, scale));
+    }
+    catch(...)
+    {
+        return CHIP8_ERROR;
+    }
+
+    if(vm->capture->isOpen() == false)
+    {
+        vm->capture.reset();
+        return CHIP8_ERROR;
+    }
+
+    vm->mediator.addFrameListener(vm->capture.get());
+    return CHIP8_OK;
+}
+
+void chip8_capture_stop(chip8_vm* vm)
+{
+    if(vm == nullptr || vm->capture == nullptr)
+        return;
+
+    vm->mediator.removeFrameListener(vm->capture.get());
+    vm->capture.reset();
+}
+
+size_t chip8_state_size(void)
+{
+    return CHIP8_State::serializedSize;
+}
+
+chip8_status chip8_save_state(const chip8_vm* vm, uint8_t* buffer, size_t size)
+{
+    if(vm == nullptr || buffer == nullptr || size < CHIP8_State::serializedSize)
+        return CHIP8_ERROR;
+
+    try
+    {
+        const std::vector<uint8_t> data = vm->chip8.saveState().serialize();
+        std::copy(data.begin(), data.end(), buffer);
+    }
+    catch(...)
+    {
+        return CHIP8_ERROR;
+    }
+
+    return CHIP8_OK;
+}
+
+chip8_status chip8_load_state(chip8_vm* vm, const uint8_t* buffer, size_t size)
+{
+    if(vm == nullptr || buffer == nullptr)
+        return CHIP8_ERROR;
+
+    try
+    {
+        CHIP8_State state;
+        if(state.deserialize(buffer, size) == false)
+            return CHIP8_ERROR;
+
+        vm->resume();
+        vm->chip8.loadState(state);
+    }
+    catch(...)
+    {
+        return CHIP8_ERROR;
+    }
+
+    return CHIP8_OK;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+/*
+ * C interface of the CHIP-8 VM for embedding it in other programs and languages.
+ *
+ * A VM handle is not thread safe, every call on one handle has to come from one
+ * thread at a time. Different handles are independent.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+    #if defined(CHIP8_BUILDING_LIBRARY)
+        #define CHIP8_API __declspec(dllexport)
+    #else
+        #define CHIP8_API __declspec(dllimport)
+    #endif
+#else
+    #define CHIP8_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8_FRAME_WIDTH 64
+#define CHIP8_FRAME_HEIGHT 32
+
+typedef struct chip8_vm chip8_vm;
+
+typedef enum chip8_status
+{
+    CHIP8_OK = 0,        /* the requested cycles or frames ran */
+    CHIP8_KEY_WAIT = 1,  /* FX0A is waiting, set a key and step again */
+    CHIP8_FAULT = 2,     /* the VM faulted, see chip8_get_fault() */
+    CHIP8_ERROR = -1     /* invalid argument or out of memory */
+} chip8_status;
+
+typedef enum chip8_capture_format
+{
+    CHIP8_CAPTURE_Y4M = 0,      /* YUV4MPEG2 at 60 frames per second */
+    CHIP8_CAPTURE_RAW_RGB = 1   /* headerless RGB24 frames */
+} chip8_capture_format;
+
+typedef enum chip8_timing
+{
+    CHIP8_TIMING_INSTRUCTIONS = 0,  /* a fixed number of instructions per frame, see chip8_set_instructions_per_frame() */
+    CHIP8_TIMING_COSMAC_VIP = 1     /* a budget of COSMAC VIP machine cycles per frame, at the original speed */
+} chip8_timing;
+
+typedef struct chip8_fault
+{
+    uint8_t kind;        /* 0 when there is no fault, same order as CHIP8_FaultKind */
+    uint16_t pc;
+    uint16_t opcode;
+    uint64_t cycle;
+} chip8_fault;
+
+CHIP8_API chip8_vm* chip8_create(void);
+CHIP8_API void chip8_destroy(chip8_vm* vm);
+
+/* resets the VM and copies the ROM to 0x200 */
+CHIP8_API chip8_status chip8_load(chip8_vm* vm, const uint8_t* rom, size_t size);
+CHIP8_API void chip8_seed(chip8_vm* vm, uint64_t seed);
+
+/* executes up to count instructions without touching the timers, executed receives how many ran */
+CHIP8_API chip8_status chip8_step_cycles(chip8_vm* vm, uint64_t count, uint64_t* executed);
+/* runs count 60 Hz frames: instructions followed by a timer tick */
+CHIP8_API chip8_status chip8_step_frames(chip8_vm* vm, uint64_t count);
+CHIP8_API void chip8_set_instructions_per_frame(chip8_vm* vm, int count);
+CHIP8_API void chip8_set_timing(chip8_vm* vm, chip8_timing timing);
+
+/* bit N set means key N is held down */
+CHIP8_API void chip8_set_keys(chip8_vm* vm, uint16_t key_mask);
+
+/*
+ * CHIP8_FRAME_HEIGHT rows of 64 pixels, the most significant bit is the leftmost pixel.
+ * The pointer stays valid for the lifetime of the VM and is updated in place by the step calls.
+ */
+CHIP8_API const uint64_t* chip8_framebuffer(const chip8_vm* vm);
+CHIP8_API int chip8_sound_active(const chip8_vm* vm);
+CHIP8_API uint64_t chip8_cycle_count(const chip8_vm* vm);
+CHIP8_API chip8_status chip8_get_fault(const chip8_vm* vm, chip8_fault* fault);
+
+/*
+ * Records every frame to path, "-" is standard output, scaled by scale in both directions.
+ * A background thread converts and writes the frames; when it falls behind frames are
+ * dropped instead of slowing the step calls. A running capture is replaced.
+ */
+CHIP8_API chip8_status chip8_capture_start(chip8_vm* vm, const char* path, chip8_capture_format format, int scale);
+/* writes the remaining frames and closes the output */
+CHIP8_API void chip8_capture_stop(chip8_vm* vm);
+
+/* save states have a fixed size and the same layout on every platform */
+CHIP8_API size_t chip8_state_size(void);
+CHIP8_API chip8_status chip8_save_state(const chip8_vm* vm, uint8_t* buffer, size_t size);
+CHIP8_API chip8_status chip8_load_state(chip8_vm* vm, const uint8_t* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,13 +1,172 @@
 #include "CHIP8_GUI.hpp"
+#include "CHIP8_Spectator.hpp"
+#include "CHIP8_FrameCapture.hpp"
+#ifndef _WIN32
+#include "CHIP8_SharedMemory.hpp"
+#endif
+
+#include <climits>
+#include <cstdlib>
+#include <memory>
 
 int main(int argc, char **argv)
 {
-    if(argc != 2)
-        std::cout << "Usage: CHIP-8_VM.exe [FILE]" << std::endl;
+    std::string romPath;
+    std::string tracePath;
+    std::string metricsPath;
+    std::string capturePath;
+    std::string sharedMemoryName;
+    CHIP8_MetricsTarget metricsTarget = CHIP8_MetricsTarget::File;
+    bool displayWait = false;
+    bool latencyReport = false;
+    bool blending = false;
+    int spectateCount = 0;
+    CHIP8_Timing timing = CHIP8_Timing::Instructions;
+    CHIP8_FramePacing framePacing = CHIP8_FramePacing::FixedRate;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if(arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if(arg == "--metrics" && i + 1 < argc)
+            metricsPath = argv[++i];
+        else if(arg == "--metrics-socket" && i + 1 < argc)
+        {
+            metricsPath = argv[++i];
+            metricsTarget = CHIP8_MetricsTarget::UnixSocket;
+        }
+        else if(arg == "--capture" && i + 1 < argc)
+            capturePath = argv[++i];
+        else if(arg == "--shared-memory" && i + 1 < argc)
+            sharedMemoryName = argv[++i];
+        else if(arg == "--display-wait")
+            displayWait = true;
+        else if(arg == "--latency")
+            latencyReport = true;
+        else if(arg == "--blend")
+            blending = true;
+        else if(arg == "--timing-vip")
+            timing = CHIP8_Timing::CosmacVIP;
+        else if(arg == "--spectate" && i + 1 < argc)
+        {
+            char* end = nullptr;
+            const long count = std::strtol(argv[++i], &end, 10);
+            if(*end != '\0' || count < 1 || count > INT_MAX)
+            {
+                romPath.clear();
+                break;
+            }
+            spectateCount = (int)count;
+        }
+        else if(arg == "--pacing" && i + 1 < argc)
+        {
+            const std::string mode = argv[++i];
+            if(mode == "frame")
+                framePacing = CHIP8_FramePacing::FrameReady;
+            else if(mode == "vsync")
+                framePacing = CHIP8_FramePacing::VSync;
+            else if(mode != "fixed")
+            {
+                romPath.clear();
+                break;
+            }
+        }
+        else if(romPath.empty())
+            romPath = arg;
+        else
+        {
+            romPath.clear();
+            break;
+        }
+    }
+
+    //the spectator runs its own VMs without the single VM window, so only timing and blending apply
+    const bool singleVMOptions = tracePath.empty() == false || metricsPath.empty() == false || capturePath.empty() == false
+        || sharedMemoryName.empty() == false || displayWait || latencyReport || framePacing != CHIP8_FramePacing::FixedRate;
+    if(spectateCount > 0 && singleVMOptions)
+        romPath.clear();
+
+    if(romPath.empty())
+        std::cout << "Usage: CHIP-8_VM.exe [--trace TRACE_FILE] [--display-wait] [--timing-vip] [--blend] [--latency] [--pacing fixed|frame|vsync] [--spectate COUNT] "
+            "[--metrics FILE | --metrics-socket PATH] [--capture VIDEO_FILE] [--shared-memory NAME] [FILE]\n"
+            "--spectate only combines with --timing-vip and --blend" << std::endl;
+    else if(spectateCount > 0)
+    {
+        CHIP8_Spectator spectator(romPath, spectateCount);
+        spectator.setTiming(timing);
+        spectator.setBlending(blending);
+        spectator.run();
+    }
     else
     {
-        CHIP8_GUI gui(argv[1]);
+        //files ending in .y4m get a Y4M stream, anything else raw RGB frames. Opened before
+        //anything else can print, a capture to standard output moves std::cout to stderr
+        std::unique_ptr<CHIP8_FrameCapture> capture;
+        if(capturePath.empty() == false)
+        {
+            const bool y4m = capturePath.size() > 4 && capturePath.compare(capturePath.size() - 4, 4, ".y4m") == 0;
+            capture.reset(new CHIP8_FrameCapture(capturePath, y4m ? CHIP8_CaptureFormat::Y4M : CHIP8_CaptureFormat::RawRGB));
+            if(capture->isOpen() == false)
+            {
+                std::cout << "UNABLE TO OPEN A CAPTURE FILE!" << std::endl;
+                return 0;
+            }
+        }
+
+        std::unique_ptr<CHIP8_Tracer> tracer;
+        if(tracePath.empty() == false)
+        {
+            tracer.reset(new CHIP8_Tracer(tracePath));
+            if(tracer->isOpen() == false)
+            {
+                std::cout << "UNABLE TO OPEN A TRACE FILE!" << std::endl;
+                return 0;
+            }
+        }
+
+        CHIP8_GUI gui(romPath, tracer.get());
+        gui.getVM().setDisplayWait(displayWait);
+        gui.getVM().setTiming(timing);
+        gui.setFramePacing(framePacing);
+        gui.setBlending(blending);
+
+        if(capture)
+            gui.getMediator().addFrameListener(capture.get());
+
+        std::unique_ptr<CHIP8_MetricsExporter> metricsExporter;
+        if(metricsPath.empty() == false)
+        {
+            metricsExporter.reset(new CHIP8_MetricsExporter(gui.getMetrics(), metricsPath, metricsTarget));
+            if(metricsExporter->isOpen() == false)
+            {
+                std::cout << "UNABLE TO OPEN A METRICS SOCKET!" << std::endl;
+                return 0;
+            }
+        }
+
+#ifndef _WIN32
+        std::unique_ptr<CHIP8_SharedMemoryServer> sharedMemory;
+        if(sharedMemoryName.empty() == false)
+        {
+            sharedMemory.reset(new CHIP8_SharedMemoryServer(gui.getMediator(), sharedMemoryName));
+            if(sharedMemory->isOpen() == false)
+            {
+                std::cout << "UNABLE TO CREATE SHARED MEMORY!" << std::endl;
+                return 0;
+            }
+        }
+#endif
+
         gui.run();
+
+        //the VM thread runs until gui is destroyed, the capture outlives it
+        if(capture)
+            gui.getMediator().removeFrameListener(capture.get());
+
+        if(latencyReport)
+            std::cout << gui.getMediator().getLatency().report() << std::flush;
     }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "differential.hpp"
+
+#include <sstream>
+#include <iomanip>
+
+CHIP8_Differential::Engine CHIP8_Differential::referenceEngine()
+{
+    return [](CHIP8& vm, uint64_t cycles){
+        for(uint64_t i = 0; i < cycles && vm.hasFaulted() == false; i++)
+            vm.step();
+    };
+}
+
+CHIP8_Differential::EngineList CHIP8_Differential::optimizedEngines()
+{
+    EngineList engines;
+
+    engines.push_back(std::make_pair(std::string("runCycles"), Engine([](CHIP8& vm, uint64_t cycles){
+        vm.runCycles(cycles);
+    })));
+
+    engines.push_back(std::make_pair(std::string("fused"), Engine([](CHIP8& vm, uint64_t cycles){
+        if(vm.getEngine() != CHIP8_Engine::Fused)
+            vm.setEngine(CHIP8_Engine::Fused);
+        vm.runCycles(cycles);
+    })));
+
+    // blocks are installed whenever the background compiler finishes them, so any point works
+    engines.push_back(std::make_pair(std::string("tiered"), Engine([](CHIP8& vm, uint64_t cycles){
+        if(vm.getEngine() != CHIP8_Engine::Tiered)
+            vm.setEngine(CHIP8_Engine::Tiered);
+        vm.runCycles(cycles);
+    })));
+
+    return engines;
+}
+
+uint16_t CHIP8_Differential::makeValidInstruction(uint16_t word, std::size_t instructionCount)
+{
+    static const uint8_t arithmetic[] = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xe };
+    // FX0A is left out, it would block on the keyboard
+    static const uint8_t miscellaneous[] = { 0x07, 0x15, 0x18, 0x1e, 0x29, 0x33, 0x55, 0x65 };
+
+    const uint16_t jumpTarget = CHIP8::memoryImageOffset + (CHIP8::getNNN(word) % instructionCount) * 2;
+
+    switch (word & 0xf000)
+    {
+        case 0x0000:
+            return (word & 0x3) == 0x3 ? 0x00ee : 0x00e0;
+
+        case 0x1000:
+        case 0x2000:
+        case 0xb000:
+            return (word & 0xf000) | jumpTarget;
+
+        case 0x5000:
+        case 0x9000:
+            return word & 0xfff0;
+
+        case 0x8000:
+            return (word & 0xfff0) | arithmetic[CHIP8::getN(word) % sizeof(arithmetic)];
+
+        case 0xe000:
+            return (word & 0xff00) | ((word & 0x1) ? 0x9e : 0xa1);
+
+        case 0xf000:
+            return (word & 0xff00) | miscellaneous[CHIP8::getNN(word) % sizeof(miscellaneous)];
+
+        default:
+            return word;
+    }
+}
+
+std::vector<uint8_t> CHIP8_Differential::makeValidProgram(const uint8_t* data, std::size_t size)
+{
+    const std::size_t instructionCount = size / 2;
+    std::vector<uint8_t> program;
+
+    for(std::size_t i = 0; i < instructionCount; i++)
+    {
+        const uint16_t instruction = makeValidInstruction((uint16_t(data[2 * i]) << 8) | data[2 * i + 1], instructionCount);
+        program.push_back(instruction >> 8);
+        program.push_back(instruction & 0xff);
+    }
+
+    return program;
+}
+
+std::vector<uint8_t> CHIP8_Differential::generateProgram(uint64_t seed, std::size_t instructionCount)
+{
+    CHIP8_XorShiftRNG rng(seed);
+    std::vector<uint8_t> data(instructionCount * 2);
+
+    for(auto& byte : data)
+        byte = rng.nextByte();
+
+    std::vector<uint8_t> program = makeValidProgram(data.data(), data.size());
+
+    //random words rarely form the sequences the fused engine recognizes, so some are spliced in
+    for(std::size_t i = 0; i + 4 <= instructionCount; i++)
+    {
+        if(rng.nextByte() >= 32)
+            continue;
+
+        const uint16_t address = CHIP8::memoryImageOffset + 2 * i;
+        const uint16_t x = (rng.nextByte() & 0xf) << 8;
+        const uint16_t y = (rng.nextByte() & 0xf) << 8;
+        const uint8_t nn = rng.nextByte();
+
+        std::vector<uint16_t> sequence;
+        switch(rng.nextByte() % 4)
+        {
+            case 0:
+                sequence = { uint16_t(0x6000 | x | nn), uint16_t(0x6000 | y | rng.nextByte()),
+                    uint16_t(0xa000 | ((rng.nextByte() << 4) & 0xfff)), uint16_t(0xd000 | x | (y >> 4) | (nn & 0xf)) };
+                break;
+            case 1:
+                // timers do not tick in runCycles(), a poll for a nonzero value spins forever
+                sequence = { uint16_t(0xf007 | x), uint16_t(0x3000 | x | (nn < 32)), uint16_t(0x1000 | address) };
+                break;
+            case 2:
+                sequence = { uint16_t(0x7000 | x | nn), uint16_t(0x3000 | y | rng.nextByte()) };
+                break;
+            case 3:
+                sequence = { uint16_t(0x7000 | x | nn), uint16_t(0x4000 | y | rng.nextByte()) };
+                break;
+        }
+
+        for(uint16_t instruction : sequence)
+        {
+            program[2 * i] = instruction >> 8;
+            program[2 * i + 1] = instruction & 0xff;
+            i++;
+        }
+        i--;
+    }
+
+    return program;
+}
+
+CHIP8_DifferentialResult CHIP8_Differential::compare(const std::vector<uint8_t>& program, uint64_t cycles,
+    const Engine& reference, const Engine& optimized, int blockSize)
+{
+    CHIP8_Mediator referenceMediator, optimizedMediator;
+    CHIP8 referenceVM(referenceMediator), optimizedVM(optimizedMediator);
+
+    for(CHIP8* vm : { &referenceVM, &optimizedVM })
+    {
+        vm->setFaultLog(nullptr);
+        vm->seedRNG(rngSeed);
+        vm->loadMemoryImage(program.data(), program.size());
+    }
+
+    uint64_t cycle = 0;
+    while(cycle < cycles)
+    {
+        const uint64_t block = std::min<uint64_t>(blockSize, cycles - cycle);
+
+        reference(referenceVM, block);
+        optimized(optimizedVM, block);
+
+        const CHIP8_State expected = referenceVM.saveState();
+        const CHIP8_State actual = optimizedVM.saveState();
+
+        if(expected != actual)
+            return CHIP8_DifferentialResult{ true, cycle, describeDifference(expected, actual) };
+
+        if(referenceVM.hasFaulted())
+            break;
+
+        cycle += block;
+    }
+
+    return CHIP8_DifferentialResult{ false, cycle, "" };
+}
+
+std::vector<uint8_t> CHIP8_Differential::shrink(const std::vector<uint8_t>& program, uint64_t cycles,
+    const Engine& reference, const Engine& optimized)
+{
+    auto diverges = [&](const std::vector<uint8_t>& candidate){
+        return compare(candidate, cycles, reference, optimized, 1).diverged;
+    };
+
+    std::vector<uint8_t> best = program;
+    const std::size_t instructionCount = best.size() / 2;
+
+    //replace ever smaller runs of instructions with a no-op, keeping every replacement that still diverges
+    for(std::size_t chunk = std::max<std::size_t>(instructionCount / 2, 1); ; chunk /= 2)
+    {
+        for(std::size_t start = 0; start < instructionCount; start += chunk)
+        {
+            std::vector<uint8_t> candidate = best;
+            bool changed = false;
+
+            for(std::size_t i = start; i < std::min(start + chunk, instructionCount); i++)
+            {
+                if(candidate[2 * i] != (noopInstruction >> 8) || candidate[2 * i + 1] != (noopInstruction & 0xff))
+                {
+                    candidate[2 * i] = noopInstruction >> 8;
+                    candidate[2 * i + 1] = noopInstruction & 0xff;
+                    changed = true;
+                }
+            }
+
+            if(changed && diverges(candidate))
+                best = candidate;
+        }
+
+        if(chunk == 1)
+            break;
+    }
+
+    //then drop the trailing instructions that are not needed
+    while(best.size() > 2)
+    {
+        std::vector<uint8_t> candidate(best.begin(), best.end() - 2);
+        if(diverges(candidate) == false)
+            break;
+        best = candidate;
+    }
+
+    return best;
+}
+
+std::string CHIP8_Differential::describeDifference(const CHIP8_State& expected, const CHIP8_State& actual)
+{
+    std::ostringstream out;
+    out << std::hex;
+
+    auto field = [&](const std::string& name, uint64_t e, uint64_t a){
+        if(e != a)
+            out << name << ": expected " << e << " got " << a << "\n";
+    };
+
+    field("PC", expected.PC, actual.PC);
+    field("I", expected.I, actual.I);
+    field("SP", expected.SP, actual.SP);
+    field("delayTimer", expected.delayTimer, actual.delayTimer);
+    field("soundTimer", expected.soundTimer, actual.soundTimer);
+    field("rngState", expected.rngState, actual.rngState);
+    field("cycleCount", expected.cycleCount, actual.cycleCount);
+    field("fault", (uint64_t)expected.fault.kind, (uint64_t)actual.fault.kind);
+
+    for(std::size_t i = 0; i < expected.V.size(); i++)
+        field("V[" + std::to_string(i) + "]", expected.V[i], actual.V[i]);
+
+    for(std::size_t i = 0; i < expected.STACK.size(); i++)
+        field("STACK[" + std::to_string(i) + "]", expected.STACK[i], actual.STACK[i]);
+
+    for(std::size_t i = 0; i < expected.RAM.size(); i++)
+    {
+        std::ostringstream name;
+        name << "RAM[" << std::hex << i << "]";
+        field(name.str(), expected.RAM[i], actual.RAM[i]);
+    }
+
+    for(std::size_t y = 0; y < expected.frameBuffer.size(); y++)
+        if(expected.frameBuffer[y] != actual.frameBuffer[y])
+            out << "frameBuffer row " << std::dec << y << std::hex << " differs\n";
+
+    return out.str();
+}
+
+std::string CHIP8_Differential::formatProgram(const std::vector<uint8_t>& program)
+{
+    std::ostringstream out;
+    out << std::hex << std::setfill('0');
+
+    for(std::size_t i = 0; i + 1 < program.size(); i += 2)
+        out << std::setw(3) << CHIP8::memoryImageOffset + i << ": "
+            << std::setw(2) << (int)program[i] << std::setw(2) << (int)program[i + 1] << "\n";
+
+    return out.str();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../src/CHIP8.hpp"
+
+#include <functional>
+#include <string>
+#include <utility>
+
+struct CHIP8_DifferentialResult
+{
+    bool diverged;
+    uint64_t cycle;     // cycle count at the start of the first mismatching block
+    std::string report; // fields that differ after that block
+};
+
+// Runs the same program on the reference interpreter and on an optimized engine,
+// comparing the complete VM state after every block of cycles.
+class CHIP8_Differential
+{
+public:
+    typedef std::function<void(CHIP8& vm, uint64_t cycles)> Engine;
+    typedef std::vector<std::pair<std::string, Engine>> EngineList;
+
+    static const int defaultBlockSize = 16;
+    static const uint64_t rngSeed = 0x5eed;
+    static const uint16_t noopInstruction = 0x8000; // V[0] = V[0]
+
+    static Engine referenceEngine();
+    static EngineList optimizedEngines();
+
+    static uint16_t makeValidInstruction(uint16_t word, std::size_t instructionCount);
+    static std::vector<uint8_t> makeValidProgram(const uint8_t* data, std::size_t size);
+    static std::vector<uint8_t> generateProgram(uint64_t seed, std::size_t instructionCount);
+
+    static CHIP8_DifferentialResult compare(const std::vector<uint8_t>& program, uint64_t cycles,
+        const Engine& reference, const Engine& optimized, int blockSize = defaultBlockSize);
+
+    static std::vector<uint8_t> shrink(const std::vector<uint8_t>& program, uint64_t cycles,
+        const Engine& reference, const Engine& optimized);
+
+    static std::string describeDifference(const CHIP8_State& expected, const CHIP8_State& actual);
+    static std::string formatProgram(const std::vector<uint8_t>& program);
+};
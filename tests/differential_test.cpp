@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include "differential.hpp"
+
+TEST(differential_test, random_programs_match_reference)
+{
+    const CHIP8_Differential::Engine reference = CHIP8_Differential::referenceEngine();
+
+    for(const auto& engine : CHIP8_Differential::optimizedEngines())
+    {
+        for(uint64_t seed = 1; seed <= 200; seed++)
+        {
+            const std::vector<uint8_t> program = CHIP8_Differential::generateProgram(seed, 64);
+            const CHIP8_DifferentialResult result = CHIP8_Differential::compare(program, 2000, reference, engine.second);
+
+            if(result.diverged)
+            {
+                const std::vector<uint8_t> reproducer = CHIP8_Differential::shrink(program, 2000, reference, engine.second);
+                FAIL() << engine.first << " diverged at cycle " << result.cycle << " (seed " << seed << ")\n"
+                    << result.report << "minimal program:\n" << CHIP8_Differential::formatProgram(reproducer);
+            }
+        }
+    }
+}
+
+TEST(differential_test, divergence_is_detected_and_shrunk)
+{
+    // an engine that gets 7XNN wrong when X is 3
+    const CHIP8_Differential::Engine broken = [](CHIP8& vm, uint64_t cycles){
+        for(uint64_t i = 0; i < cycles && vm.hasFaulted() == false; i++)
+        {
+            CHIP8_State state = vm.saveState();
+            const uint16_t opcode = (state.RAM[state.PC] << 8) | state.RAM[state.PC + 1];
+
+            vm.step();
+
+            if((opcode & 0xff00) == 0x7300)
+            {
+                state = vm.saveState();
+                state.V[0x3]++;
+                vm.loadState(state);
+            }
+        }
+    };
+
+    std::vector<uint8_t> program = CHIP8_Differential::generateProgram(7, 32);
+    const uint8_t instr[] = { 0x73, 0x01 }; // V[0x3] += 0x01
+    std::copy(instr, instr + sizeof(instr), program.begin() + 4);
+
+    const CHIP8_DifferentialResult result = CHIP8_Differential::compare(program, 500, CHIP8_Differential::referenceEngine(), broken);
+    ASSERT_TRUE(result.diverged);
+
+    const std::vector<uint8_t> reproducer = CHIP8_Differential::shrink(program, 500, CHIP8_Differential::referenceEngine(), broken);
+    ASSERT_LE(reproducer.size(), program.size());
+
+    int interestingInstructions = 0;
+    for(std::size_t i = 0; i + 1 < reproducer.size(); i += 2)
+        if(((reproducer[i] << 8) | reproducer[i + 1]) != CHIP8_Differential::noopInstruction)
+            interestingInstructions++;
+
+    ASSERT_EQ(interestingInstructions, 1);
+    ASSERT_EQ(reproducer[reproducer.size() - 2], 0x73);
+}
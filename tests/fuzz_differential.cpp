@@ -0,0 +1,31 @@
+#include "differential.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+// libFuzzer entry point: the input is turned into a valid program and run on every optimized engine
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size)
+{
+    static const uint64_t cycles = 4096;
+
+    if(size < 2 || size + CHIP8::memoryImageOffset > 4096)
+        return 0;
+
+    const std::vector<uint8_t> program = CHIP8_Differential::makeValidProgram(data, size);
+    const CHIP8_Differential::Engine reference = CHIP8_Differential::referenceEngine();
+
+    for(const auto& engine : CHIP8_Differential::optimizedEngines())
+    {
+        const CHIP8_DifferentialResult result = CHIP8_Differential::compare(program, cycles, reference, engine.second);
+
+        if(result.diverged)
+        {
+            const std::vector<uint8_t> reproducer = CHIP8_Differential::shrink(program, cycles, reference, engine.second);
+            std::cerr << engine.first << " diverged at cycle " << result.cycle << "\n" << result.report
+                << "minimal program:\n" << CHIP8_Differential::formatProgram(reproducer);
+            std::abort();
+        }
+    }
+
+    return 0;
+}
@@ -1,5 +1,19 @@
 #include <gtest/gtest.h>
 #include "../src/CHIP8.hpp"
+#include "../src/CHIP8_Analyzer.hpp"
+#include "../src/CHIP8_Executor.hpp"
+#include "../src/CHIP8_Search.hpp"
+#include "../src/CHIP8_Debugger.hpp"
+#include "../src/CHIP8_Bisect.hpp"
+#include "../src/CHIP8_FrameBlender.hpp"
+#include "../src/libchip8.h"
+#ifndef _WIN32
+#include "../src/CHIP8_StateStore.hpp"
+#include "../src/CHIP8_SharedMemory.hpp"
+#include <unistd.h>
+#endif
+#include <sstream>
+#include <memory>
 
 class CHIP8_test : public CHIP8
 {
@@ -7,7 +21,7 @@ public:
     CHIP8_test(CHIP8_Mediator& m)
         : CHIP8(m) { }
         
-    std::vector<uint8_t>& getRAM()
+    CHIP8_Memory& getRAM()
     {
         return RAM;
     }
@@ -47,18 +61,45 @@ public:
         return soundTimer;
     }
 
+    CHIP8_FrameBuffer& getFrameBuffer()
+    {
+        return frameBuffer;
+    }
+
     void clockCycle()
     {
         CHIP8::clockCycle();
     }
+
+    void tracedClockCycle()
+    {
+        CHIP8::tracedClockCycle();
+    }
 };
 
-/*
 TEST(chip_test, clear_screen)
 {
-    ASSERT_TRUE(false);
+    CHIP8_Mediator m;
+	CHIP8_test t(m);
+
+    uint8_t instr[] = { 0x00, 0xe0 // clear the screen
+                      };
+
+    t.getFrameBuffer()[0] = 1ULL << 63;
+    t.getFrameBuffer()[31] = 1;
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    t.clockCycle();
+    for(auto row : t.getFrameBuffer())
+        ASSERT_EQ(row, 0);
+
+    // only the two rows that had pixels are reported as changed
+    uint32_t changedRows;
+    ASSERT_TRUE(m.hasFrameBufferChanged());
+    m.getNewFrameBuffer(changedRows);
+    ASSERT_EQ(changedRows, (1u << 0) | (1u << 31));
 }
-*/
 
 TEST(chip_test, reset_functionality)
 {
@@ -86,11 +127,11 @@ TEST(chip_test, check_subroutines)
 	CHIP8_test t(m);
     //Calls subroutine at 0x0555
     uint8_t instr[] = { 0x25, 0x55 };
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
     
     //Then immediately Returns from a subroutine
     uint8_t instr2[] = { 0x00, 0xee };
-    memcpy(&t.getRAM()[0] + 0x555, instr2, sizeof(instr2));
+    t.getRAM().write(0x555, instr2, sizeof(instr2));
 
     t.clockCycle();
     ASSERT_EQ(t.getPC(), 0x555);
@@ -110,7 +151,7 @@ TEST(chip_test, jump_to_adress)
     //Jumps to 0x0555
     uint8_t instr[] = { 0x15, 0x55 };
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getPC(), 0x555);
@@ -132,7 +173,7 @@ TEST(chip_test, skipping_instructions)
                         0x91, 0x30 // skip if V[0x1] != V[0x3]
                       };
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getPC(), 0x202);
@@ -162,7 +203,7 @@ TEST(chip_test, setting_V_register)
                         0x6f, 0xff  // V[0xf] = 0xff
                       };
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0x5], 0x11);
@@ -181,7 +222,7 @@ TEST(chip_test, adding_value_to_register)
                         0x7f, 0x33  // V[0xf] += 0x33
                       };
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0x5], 0x11);
@@ -205,7 +246,7 @@ TEST(chip_test, assigning_a_registry_to_another)
     // we write to register V[1] value 0x77
     t.getV()[0x1] = 0x77;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0x5], 0x77);
@@ -226,7 +267,7 @@ TEST(chip_test, bitwise_OR_operation)
     // we write to register V[1] value 0x77
     t.getV()[0x1] = 0x77;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0x5], 0x77);
@@ -247,7 +288,7 @@ TEST(chip_test, bitwise_AND_operation)
     // we write to register V[1] value 0x77
     t.getV()[0x1] = 0x77;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0x5], 0x00);
@@ -268,7 +309,7 @@ TEST(chip_test, bitwise_XOR_operation)
     // we write to register V[1] value 0x77
     t.getV()[0x1] = 0x77;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0x5], 0x77);
@@ -289,7 +330,7 @@ TEST(chip_test, adding_two_registrs)
     // we write to register V[1] value 0xaa
     t.getV()[0x1] = 0xaa;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0xf], 0x0);
@@ -311,7 +352,7 @@ TEST(chip_test, subtracting_two_registrs)
     t.getV()[0x1] = 0xaa;
     t.getV()[0x5] = 0xbb;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0xf], 0x1);
@@ -332,7 +373,7 @@ TEST(chip_test, bitwise_SHIFTING_RIGHT_operation)
     // we write to register V[0x2] value 0xbb
     t.getV()[0x5] = 0x66;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0xf], 0x0);
@@ -354,7 +395,7 @@ TEST(chip_test, subtracting_two_registrs_2)
     t.getV()[0x1] = 0xbb;
     t.getV()[0x5] = 0xaa;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0xf], 0x1);
@@ -375,7 +416,7 @@ TEST(chip_test, bitwise_SHIFTING_LEFT_operation)
     // we write to register V[0x2] value 0x80
     t.getV()[0x5] = 0x80;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getV()[0xf], 0x1);
@@ -393,7 +434,7 @@ TEST(chip_test, setting_I_register)
                         0xaf, 0xff  // I = 0xfff
                       };
     
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getI(), 0x555);
@@ -413,7 +454,7 @@ TEST(chip_test, jump_to_adress_plus_offset)
     // we are writing to register V[0x0] value 0x11
     t.getV()[0x0] = 0x11;
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_EQ(t.getPC(), 0x566);
@@ -427,15 +468,1237 @@ TEST(chip_test, Vx_to_random_number)
     uint8_t instr[] = { 0xc5, 0x0f // V[0x5] = rand() & 0xf
                       };
 
-    memcpy(&t.getRAM()[0] + t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
 
     t.clockCycle();
     ASSERT_LT(t.getV()[0x5], 0x10);
 }
 
-/*
+TEST(chip_test, tracing_instructions)
+{
+    const char* traceFile = "chip8_tracing_instructions_test.trace";
+    {
+        CHIP8_Mediator m;
+        CHIP8_test t(m);
+        CHIP8_Tracer tracer(traceFile);
+        ASSERT_TRUE(tracer.isOpen());
+        t.setTracer(&tracer);
+
+        uint8_t instr[] = { 0x65, 0x11, // V[0x5] = 0x11
+                            0xa5, 0x55, // I = 0x555
+                            0x85, 0x54  // V[0x5] += V[0x5]
+                          };
+
+        t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+        t.tracedClockCycle();
+        t.tracedClockCycle();
+        t.tracedClockCycle();
+        ASSERT_EQ(t.getCycleCount(), 3);
+    }
+
+    CHIP8_TraceReader reader(traceFile);
+    ASSERT_TRUE(reader.isValid());
+
+    CHIP8_TraceRecord r;
+    ASSERT_TRUE(reader.next(r));
+    ASSERT_EQ(r.cycle, 0);
+    ASSERT_EQ(r.PC, 0x200);
+    ASSERT_EQ(r.opcode, 0x6511);
+    ASSERT_EQ(r.changedRegisters, 1 << 0x5);
+    ASSERT_EQ(r.V[0x5], 0x11);
+
+    ASSERT_TRUE(reader.next(r));
+    ASSERT_EQ(r.I, 0x555);
+    ASSERT_EQ(r.changedRegisters, 0);
+
+    ASSERT_TRUE(reader.next(r));
+    ASSERT_EQ(r.PC, 0x204);
+    ASSERT_EQ(r.changedRegisters, 1 << 0x5);
+    ASSERT_EQ(r.V[0x5], 0x22);
+
+    ASSERT_FALSE(reader.next(r));
+    std::remove(traceFile);
+}
+
+TEST(chip_test, tracing_key_wait)
+{
+    const char* traceFile = "chip8_tracing_key_wait_test.trace";
+    {
+        CHIP8_Mediator m;
+        CHIP8_test t(m);
+        CHIP8_Tracer tracer(traceFile);
+        ASSERT_TRUE(tracer.isOpen());
+        t.setTracer(&tracer);
+
+        uint8_t instr[] = { 0xf5, 0x0a, // V[0x5] = key
+                            0x65, 0x11  // V[0x5] = 0x11
+                          };
+
+        t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+        // without a key FX0A runs again on every resume
+        ASSERT_EQ(t.runCycles(2), 0);
+        ASSERT_EQ(t.runCycles(2), 0);
+
+        m.updateKeyMask(1 << 0x3);
+        ASSERT_EQ(t.runCycles(2), 2);
+    }
+
+    CHIP8_TraceReader reader(traceFile);
+    ASSERT_TRUE(reader.isValid());
+
+    CHIP8_TraceRecord r;
+    ASSERT_TRUE(reader.next(r));
+    ASSERT_EQ(r.cycle, 0);
+    ASSERT_EQ(r.opcode, 0xf50a);
+    ASSERT_EQ(r.V[0x5], 0x3);
+
+    ASSERT_TRUE(reader.next(r));
+    ASSERT_EQ(r.cycle, 1);
+    ASSERT_EQ(r.opcode, 0x6511);
+
+    ASSERT_FALSE(reader.next(r));
+    std::remove(traceFile);
+}
+
+TEST(chip_test, invalid_opcode_fault)
+{
+    std::ostringstream output;
+    CHIP8_FaultLog log(output);
+
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    t.setFaultLog(&log);
+
+    uint8_t instr[] = { 0x65, 0x11, // V[0x5] = 0x11
+                        0x85, 0x18  // does not exist
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    t.clockCycle();
+    ASSERT_FALSE(t.hasFaulted());
+
+    t.clockCycle();
+    ASSERT_TRUE(t.hasFaulted());
+    ASSERT_EQ(t.getFault().kind, CHIP8_FaultKind::InvalidOpcode);
+    ASSERT_EQ(t.getFault().PC, 0x202);
+    ASSERT_EQ(t.getFault().opcode, 0x8518);
+    ASSERT_EQ(t.getFault().cycle, 1);
+
+    // the VM halts on the faulting instruction
+    ASSERT_EQ(t.getPC(), 0x202);
+    ASSERT_TRUE(m.shouldCHIP8Stop());
+
+    log.flush();
+    ASSERT_EQ(output.str(), "CHIP8 FAULT: INVALID OPCODE AT PC 202 OPCODE 8518 CYCLE 1\n");
+}
+
+TEST(chip_test, stack_underflow_fault)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    t.setFaultLog(nullptr);
+
+    uint8_t instr[] = { 0x00, 0xee // return with an empty stack
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    t.clockCycle();
+    ASSERT_EQ(t.getFault().kind, CHIP8_FaultKind::StackUnderflow);
+    ASSERT_EQ(t.getPC(), 0x200);
+
+    t.reset();
+    ASSERT_FALSE(t.hasFaulted());
+}
+
+TEST(chip_test, seeded_random_numbers_are_reproducible)
+{
+    CHIP8_Mediator m1, m2;
+    CHIP8_test t1(m1), t2(m2);
+
+    uint8_t instr[] = { 0xc5, 0xff, // V[0x5] = rand() & 0xff
+                        0xc6, 0xff, // V[0x6] = rand() & 0xff
+                        0xc7, 0xff  // V[0x7] = rand() & 0xff
+                      };
+
+    t1.getRAM().write(t1.getPC(), instr, sizeof(instr));
+    t2.getRAM().write(t2.getPC(), instr, sizeof(instr));
+
+    t1.seedRNG(1234);
+    t2.seedRNG(1234);
+
+    for(int i = 0; i < 3; i++)
+    {
+        t1.clockCycle();
+        t2.clockCycle();
+    }
+
+    ASSERT_EQ(t1.getV(), t2.getV());
+}
+
+TEST(chip_test, save_and_load_state)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    t.seedRNG(42);
+
+    uint8_t instr[] = { 0x65, 0x11, // V[0x5] = 0x11
+                        0x25, 0x55  // Calls subroutine at 0x0555
+                      };
+    uint8_t instr2[] = { 0xc5, 0xff // V[0x5] = rand() & 0xff
+                       };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+    t.getRAM().write(0x555, instr2, sizeof(instr2));
+
+    t.clockCycle();
+    t.clockCycle();
+
+    CHIP8_State state = t.saveState();
+    ASSERT_EQ(state.PC, 0x555);
+    ASSERT_EQ(state.SP, 1);
+
+    t.clockCycle();
+    const uint8_t randomValue = t.getV()[0x5];
+    ASSERT_NE(t.saveState(), state);
+
+    t.loadState(state);
+    ASSERT_EQ(t.saveState(), state);
+
+    // the generator state is restored too, so the same number comes out again
+    t.clockCycle();
+    ASSERT_EQ(t.getV()[0x5], randomValue);
+}
+
 TEST(chip_test, drawing_a_sprite)
 {
-    ASSERT_TRUE(false);
+    CHIP8_Mediator m;
+	CHIP8_test t(m);
+
+    uint8_t instr[] = { 0x60, 0x3e, // V[0x0] = 62
+                        0x61, 0x1f, // V[0x1] = 31
+                        0xf2, 0x29, // I = address of the font sprite for V[0x2] = 0
+                        0xd0, 0x12, // draw 2 rows of the sprite at (V[0x0], V[0x1])
+                        0xd0, 0x12  // draw it again
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    for(int i = 0; i < 4; i++)
+        t.clockCycle();
+
+    // 0xf0 and 0x90 wrap around both edges of the screen
+    auto& fb = t.getFrameBuffer();
+    ASSERT_TRUE(getPixel(fb, 62, 31) && getPixel(fb, 63, 31) && getPixel(fb, 0, 31) && getPixel(fb, 1, 31));
+    ASSERT_FALSE(getPixel(fb, 2, 31));
+    ASSERT_TRUE(getPixel(fb, 62, 0) && getPixel(fb, 1, 0));
+    ASSERT_FALSE(getPixel(fb, 63, 0) || getPixel(fb, 0, 0));
+    ASSERT_EQ(t.getV()[0xf], 0x0);
+
+    uint32_t changedRows;
+    m.getNewFrameBuffer(changedRows);
+    ASSERT_EQ(changedRows, (1u << 0) | (1u << 31));
+
+    // drawing the same sprite again erases it and reports a collision
+    t.clockCycle();
+    for(auto row : fb)
+        ASSERT_EQ(row, 0);
+    ASSERT_EQ(t.getV()[0xf], 0x1);
+}
+
+TEST(chip_test, display_wait_publishes_once_per_tick)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    t.setDisplayWait(true);
+
+    uint8_t instr[] = { 0x00, 0xe0, // clear the screen
+                        0xd0, 0x15, // draw a sprite
+                        0xd0, 0x15  // and another one
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    const uint64_t generation = m.getFrameGeneration();
+
+    for(int i = 0; i < 3; i++)
+        t.clockCycle();
+    ASSERT_FALSE(m.hasFrameBufferChanged());
+    ASSERT_EQ(m.getFrameGeneration(), generation);
+
+    t.tickTimers();
+    ASSERT_TRUE(m.hasFrameBufferChanged());
+    ASSERT_EQ(m.getFrameGeneration(), generation + 1);
+
+    // nothing was drawn since the last tick
+    t.tickTimers();
+    ASSERT_EQ(m.getFrameGeneration(), generation + 1);
+}
+
+TEST(chip_test, run_frame_yields_on_key_wait)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    t.setInstructionsPerFrame(4);
+
+    uint8_t instr[] = { 0x60, 0x01, // V[0x0] = 0x01
+                        0xf5, 0x0a, // V[0x5] = wait for a key
+                        0x70, 0x01, // V[0x0] += 0x01
+                        0x70, 0x01, // V[0x0] += 0x01
+                        0x70, 0x01  // V[0x0] += 0x01
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    ASSERT_EQ(t.runFrame(), CHIP8_YieldReason::KeyWait);
+    ASSERT_EQ(t.getPC(), 0x202);
+    ASSERT_EQ(t.runFrame(), CHIP8_YieldReason::KeyWait);
+
+    std::vector<bool> keys(CHIP8_CONSTANTS::keyArraySize, false);
+    keys[0x7] = true;
+    m.updateKeyArray(keys);
+
+    // the frame continues where it stopped: FX0A and two more instructions
+    ASSERT_EQ(t.runFrame(), CHIP8_YieldReason::FrameEnd);
+    ASSERT_EQ(t.getV()[0x5], 0x7);
+    ASSERT_EQ(t.getV()[0x0], 0x3);
+    ASSERT_EQ(t.getCycleCount(), 4);
+}
+
+TEST(chip_test, cosmac_vip_timing_budgets_cycles)
+{
+    ASSERT_EQ(CHIP8_TIMING::getCycleCost(0x6005), CHIP8_TIMING::fetchCycles + 6);
+    ASSERT_EQ(CHIP8_TIMING::getCycleCost(0xd125) - CHIP8_TIMING::getCycleCost(0xd121), 4 * CHIP8_TIMING::spriteRowCycles);
+    ASSERT_EQ(CHIP8_TIMING::getCycleCost(0x3000, 0x200, 0x204), CHIP8_TIMING::getCycleCost(0x3000) + CHIP8_TIMING::skipCycles);
+    ASSERT_EQ(CHIP8_TIMING::getCycleCost(0x3000, 0x200, 0x202), CHIP8_TIMING::getCycleCost(0x3000));
+    ASSERT_GT(CHIP8_TIMING::getCycleCost(0x00e0), CHIP8_TIMING::cyclesPerFrame / 2);
+
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    t.setTiming(CHIP8_Timing::CosmacVIP);
+
+    uint8_t instr[] = { 0x70, 0x01, // V[0x0] += 0x01
+                        0x12, 0x00  // jump to 0x200
+                      };
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    // the frame ends with the instruction that uses up the budget, the excess is taken from the next frame
+    uint64_t expectedCycles = 0;
+    int progress = 0;
+    for(int frame = 0; frame < 3; frame++)
+    {
+        while(progress < CHIP8_TIMING::cyclesPerFrame)
+            progress += CHIP8_TIMING::getCycleCost(expectedCycles++ % 2 ? 0x1200 : 0x7001);
+        progress -= CHIP8_TIMING::cyclesPerFrame;
+
+        ASSERT_EQ(t.runFrame(), CHIP8_YieldReason::FrameEnd);
+        ASSERT_EQ(t.getCycleCount(), expectedCycles);
+    }
+
+    // with display wait a sprite ends the frame
+    uint8_t draw[] = { 0xd0, 0x15, // draw the font sprite at I = 0x000
+                       0x12, 0x00  // jump to 0x200
+                     };
+    t.reset();
+    t.setDisplayWait(true);
+    t.getRAM().write(t.getPC(), draw, sizeof(draw));
+    for(int frame = 0; frame < 3; frame++)
+        ASSERT_EQ(t.runFrame(), CHIP8_YieldReason::FrameEnd);
+    ASSERT_EQ(t.getCycleCount(), 5);
+}
+
+TEST(chip_test, executor_interleaves_many_vms)
+{
+    const int vmCount = 64;
+    const int frames = 30;
+
+    uint8_t program[] = { 0x70, 0x01, // V[0x0] += 0x01
+                          0xc1, 0xff, // V[0x1] = rand() & 0xff
+                          0x81, 0x14, // V[0x1] += V[0x1]
+                          0x12, 0x00  // jump to 0x200
+                        };
+
+    std::vector<std::unique_ptr<CHIP8_Mediator>> mediators;
+    std::vector<std::unique_ptr<CHIP8>> vms;
+    std::vector<std::unique_ptr<CHIP8_Mediator>> expectedMediators;
+    std::vector<std::unique_ptr<CHIP8>> expectedVMs;
+
+    for(int i = 0; i < vmCount; i++)
+    {
+        mediators.emplace_back(new CHIP8_Mediator());
+        vms.emplace_back(new CHIP8(*mediators.back()));
+        expectedMediators.emplace_back(new CHIP8_Mediator());
+        expectedVMs.emplace_back(new CHIP8(*expectedMediators.back()));
+
+        for(CHIP8* vm : { vms.back().get(), expectedVMs.back().get() })
+        {
+            vm->seedRNG(i);
+            vm->loadMemoryImage(program, sizeof(program));
+        }
+
+        for(int f = 0; f < frames; f++)
+            expectedVMs.back()->runFrame();
+    }
+
+    {
+        CHIP8_Executor executor(3);
+        for(auto& vm : vms)
+            executor.add(*vm, frames);
+        executor.waitAll();
+
+        for(int i = 0; i < vmCount; i++)
+        {
+            ASSERT_TRUE(executor.isFinished(i));
+            ASSERT_EQ(executor.getFramesRun(i), frames);
+        }
+    }
+
+    for(int i = 0; i < vmCount; i++)
+        ASSERT_EQ(vms[i]->saveState(), expectedVMs[i]->saveState());
+}
+
+TEST(chip_test, incremental_state_hash)
+{
+    CHIP8_Mediator mediator;
+    CHIP8 chip8(mediator);
+    chip8.setFaultLog(nullptr);
+    chip8.seedRNG(7);
+
+    //LD V0, 0x7B; LD I, 0x300; LD B, V0; LD [I], V2; LD F, V0; DRW V3, V4, 5; CLS; DRW V3, V4, 5
+    const uint8_t rom[] = { 0x60, 0x7b, 0xa3, 0x00, 0xf0, 0x33, 0xf2, 0x55, 0xf0, 0x29, 0xd3, 0x45, 0x00, 0xe0, 0xd3, 0x45 };
+    ASSERT_TRUE(chip8.loadMemoryImage(rom, sizeof(rom)));
+
+    const CHIP8_State loaded = chip8.saveState();
+    std::vector<uint64_t> hashes;
+    for(int i = 0; i < 8; i++)
+    {
+        chip8.step();
+        ASSERT_EQ(chip8.getStateHash(), chip8.saveState().hash());
+        hashes.push_back(chip8.getStateHash());
+    }
+
+    //a restored state brings its memory hash along
+    const uint64_t last = chip8.getStateHash();
+    chip8.restoreState(loaded);
+    ASSERT_EQ(chip8.getStateHash(), loaded.hash());
+    chip8.runCycles(8);
+    ASSERT_EQ(chip8.getStateHash(), last);
+
+    std::sort(hashes.begin(), hashes.end());
+    ASSERT_EQ(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+    //the cycle count does not take part in the hash
+    const CHIP8_State state = chip8.saveState();
+    CHIP8_State copy = state;
+    copy.cycleCount = 0;
+    ASSERT_EQ(copy.hash(), state.hash());
+    copy.RAM.write(0x301, copy.RAM[0x301] ^ 1);
+    ASSERT_NE(copy.hash(), state.hash());
+}
+
+TEST(chip_test, copy_on_write_memory)
+{
+    CHIP8_Mediator mediator;
+    CHIP8 chip8(mediator);
+    chip8.setFaultLog(nullptr);
+
+    //LD V0, 0xAB; LD I, 0x3FF; LD [I], V1 - the store crosses from page 3 to page 4
+    const uint8_t rom[] = { 0x60, 0xab, 0xa3, 0xff, 0xf1, 0x55 };
+    ASSERT_TRUE(chip8.loadMemoryImage(rom, sizeof(rom)));
+
+    const CHIP8_State parent = chip8.saveState();
+    CHIP8_State fork = parent;
+    for(int page = 0; page < CHIP8_Memory::pageCount; page++)
+        ASSERT_TRUE(fork.RAM.sharesPage(page, parent.RAM));
+
+    chip8.loadState(fork);
+    chip8.runCycles(3);
+    const CHIP8_State child = chip8.saveState();
+
+    ASSERT_EQ(child.RAM[0x3ff], 0xab);
+    ASSERT_EQ(parent.RAM[0x3ff], 0);
+    for(int page = 0; page < CHIP8_Memory::pageCount; page++)
+        ASSERT_EQ(child.RAM.sharesPage(page, parent.RAM), page != 3);
+
+    //V1 is zero, so page 4 stays the shared zero page
+    CHIP8_Memory empty;
+    ASSERT_TRUE(child.RAM.sharesPage(4, empty));
+    ASSERT_NE(child.RAM, parent.RAM);
+}
+
+TEST(chip_test, memory_regions)
+{
+    ASSERT_EQ(CHIP8_Memory::getAccess(0x050), CHIP8_Memory::readable);
+    ASSERT_EQ(CHIP8_Memory::getAccess(0x1050), CHIP8_Memory::readable); // data addresses wrap
+    ASSERT_EQ(CHIP8_Memory::getAccess(0x1fe, 3), CHIP8_Memory::readable);
+    ASSERT_EQ(CHIP8_Memory::getAccess(0x200, 16) & CHIP8_Memory::writable, CHIP8_Memory::writable);
+    ASSERT_EQ(CHIP8_Memory::getAccess(0xffe, 3), CHIP8_Memory::readable); // wraps into the interpreter area
+    ASSERT_TRUE(CHIP8_Memory::canExecute(0xffe));
+    ASSERT_FALSE(CHIP8_Memory::canExecute(0xfff)); // instruction fetches do not
+    ASSERT_FALSE(CHIP8_Memory::canExecute(0x1200));
+
+    CHIP8_Mediator mediator;
+    CHIP8 chip8(mediator);
+    chip8.setFaultLog(nullptr);
+
+    //LD V0, 0x07; LD F, V0; LD V3, [I] - the font is readable
+    const uint8_t readFont[] = { 0x60, 0x07, 0xf0, 0x29, 0xf3, 0x65 };
+    ASSERT_TRUE(chip8.loadMemoryImage(readFont, sizeof(readFont)));
+    chip8.runCycles(3);
+    ASSERT_FALSE(chip8.hasFaulted());
+    ASSERT_EQ(chip8.getRegisters()[0x0], 0xf0);
+    ASSERT_EQ(chip8.getRegisters()[0x1], 0x10);
+
+    //LD V0, 0x0B; LD F, V0; LD B, V0 - but it is not writable
+    const uint8_t writeFont[] = { 0x60, 0x0b, 0xf0, 0x29, 0xf0, 0x33 };
+    chip8.reset();
+    ASSERT_TRUE(chip8.loadMemoryImage(writeFont, sizeof(writeFont)));
+    chip8.runCycles(3);
+    ASSERT_TRUE(chip8.hasFaulted());
+    ASSERT_EQ(chip8.getFault().kind, CHIP8_FaultKind::ForbiddenMemoryAccess);
+    ASSERT_EQ(chip8.getFault().opcode, 0xf033);
+
+    //LD I, 0xFFE; LD [I], V3 - the store wraps to 0x000
+    const uint8_t wrap[] = { 0xaf, 0xfe, 0xf3, 0x55 };
+    chip8.reset();
+    ASSERT_TRUE(chip8.loadMemoryImage(wrap, sizeof(wrap)));
+    chip8.runCycles(2);
+    ASSERT_TRUE(chip8.hasFaulted());
+    ASSERT_EQ(chip8.getMemory()[0xffe], 0);
+}
+
+TEST(chip_test, fused_engine_matches_interpreter)
+{
+    const uint8_t rom[] = {
+        0x60, 0x05, 0xf0, 0x15,                         // DT = 5
+        0xf1, 0x07, 0x31, 0x00, 0x12, 0x04,             // timer poll until DT is 0
+        0x6a, 0x01, 0x6b, 0x02, 0xa0, 0x00, 0xda, 0xb5, // fused draw at 0x20A
+        0x72, 0x01, 0x32, 0x02, 0x12, 0x0a,             // V2 += 1, loop twice
+        0x60, 0x6b, 0x61, 0x07, 0x62, 0xa0, 0x63, 0x05,
+        0xa2, 0x0c, 0xf3, 0x55,                         // rewrite 0x20C as 6B07 A005
+        0x62, 0x00,
+        0x74, 0x01, 0x34, 0x03, 0x12, 0x0a,             // V4 += 1, back to the draw until V4 is 3
+        0x12, 0x2c
+    };
+
+    CHIP8_Mediator interpreterMediator, fusedMediator;
+    CHIP8 interpreter(interpreterMediator), fused(fusedMediator);
+    fused.setEngine(CHIP8_Engine::Fused);
+
+    for(CHIP8* vm : { &interpreter, &fused })
+    {
+        vm->seedRNG(3);
+        ASSERT_TRUE(vm->loadMemoryImage(rom, sizeof(rom)));
+    }
+
+    for(int frame = 0; frame < 40; frame++)
+    {
+        ASSERT_EQ(interpreter.runFrame(), CHIP8_YieldReason::FrameEnd);
+        ASSERT_EQ(fused.runFrame(), CHIP8_YieldReason::FrameEnd);
+        ASSERT_EQ(fused.saveState(), interpreter.saveState()) << "frame " << frame;
+    }
+
+    const CHIP8_State state = fused.saveState();
+    ASSERT_EQ(state.PC, 0x22c);
+    ASSERT_EQ(state.V[0xb], 0x07);
+    ASSERT_EQ(state.I, 0x20c);
+}
+
+TEST(chip_test, tiered_engine_compiles_hot_blocks)
+{
+    const uint8_t rom[] = {
+        0x62, 0x00,
+        0x72, 0x01, 0x74, 0x00, 0x32, 0x64, 0x12, 0x02, // V4 += 0 in a hot loop of 100 iterations
+        0x60, 0x74, 0x61, 0x05, 0xa2, 0x04, 0xf1, 0x55, // rewrite it as V4 += 5
+        0x62, 0x00,
+        0x73, 0x01, 0x33, 0x02, 0x12, 0x02,             // run the loop a second time
+        0x12, 0x1a
+    };
+
+    CHIP8_BlockCompiler compiler;
+    CHIP8_Mediator interpreterMediator, tieredMediator;
+    CHIP8 interpreter(interpreterMediator), tiered(tieredMediator);
+    tiered.setBlockCompiler(&compiler);
+    tiered.setEngine(CHIP8_Engine::Tiered);
+
+    for(CHIP8* vm : { &interpreter, &tiered })
+    {
+        vm->seedRNG(3);
+        ASSERT_TRUE(vm->loadMemoryImage(rom, sizeof(rom)));
+    }
+
+    std::size_t compiledBlocks = 0;
+    for(int frame = 0; frame < 120; frame++)
+    {
+        ASSERT_EQ(interpreter.runFrame(), CHIP8_YieldReason::FrameEnd);
+        ASSERT_EQ(tiered.runFrame(), CHIP8_YieldReason::FrameEnd);
+        ASSERT_EQ(tiered.saveState(), interpreter.saveState()) << "frame " << frame;
+
+        //makes the frame a block is installed at deterministic
+        compiler.waitIdle();
+        compiledBlocks = std::max(compiledBlocks, tiered.getCompiledBlockCount());
+    }
+
+    ASSERT_GE(compiledBlocks, 2);
+
+    const CHIP8_State state = tiered.saveState();
+    ASSERT_EQ(state.PC, 0x21a);
+    ASSERT_EQ(state.V[0x4], (uint8_t)(100 * 5));
+}
+
+TEST(chip_test, block_compiler_stops_at_interpreted_instructions)
+{
+    //LD V0, 1; ADD V0, V1; DRW; CALL 0x300
+    const std::vector<uint8_t> source = { 0x60, 0x01, 0x80, 0x14, 0xd0, 0x15, 0x23, 0x00, 0x60, 0x02 };
+    CHIP8_CompiledBlockPtr block = CHIP8_BlockCompiler::compile(0x200, source);
+
+    ASSERT_EQ(block->ops.size(), 3);
+    ASSERT_EQ(block->ops[1].kind, CHIP8_CompiledOpKind::Add);
+    ASSERT_EQ(block->source.size(), 6);
+
+    //a skip is the last instruction of a block
+    block = CHIP8_BlockCompiler::compile(0x200, { 0x30, 0x01, 0x60, 0x01 });
+    ASSERT_EQ(block->ops.size(), 1);
+
+    block = CHIP8_BlockCompiler::compile(0x200, { 0xf0, 0x0a });
+    ASSERT_TRUE(block->ops.empty());
+}
+
+TEST(chip_test, block_compiler_retries_blocks_a_full_queue_refused)
+{
+    CHIP8_BlockCompiler compiler;
+    std::shared_ptr<CHIP8_CompiledBlockQueue> queue = std::make_shared<CHIP8_CompiledBlockQueue>(2);
+
+    for(uint16_t start = 0x200; start < 0x208; start += 2)
+        compiler.submit(queue, start, { 0x60, 0x01 });
+    compiler.waitIdle();
+
+    //the two blocks that didn't fit arrive once there is room
+    std::vector<uint16_t> starts;
+    CHIP8_CompiledBlockPtr block;
+    for(int attempt = 0; attempt < 1000 && starts.size() < 4; attempt++)
+    {
+        while(queue->tryPop(block))
+            starts.push_back(block->start);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::sort(starts.begin(), starts.end());
+    ASSERT_EQ(starts, std::vector<uint16_t>({ 0x200, 0x202, 0x204, 0x206 }));
+}
+
+TEST(chip_test, search_finds_key_sequence)
+{
+    //waits for key 5, then for key 7, then sets V2
+    const uint8_t rom[] = {
+        0x60, 0x05, 0x61, 0x07,
+        0xe0, 0x9e, 0x12, 0x04,
+        0xe1, 0x9e, 0x12, 0x08,
+        0x62, 0x01, 0x12, 0x0e
+    };
+
+    CHIP8_Mediator mediator;
+    CHIP8 chip8(mediator);
+    chip8.seedRNG(1);
+    ASSERT_TRUE(chip8.loadMemoryImage(rom, sizeof(rom)));
+
+    for(unsigned threads : { 1u, 4u })
+    {
+        CHIP8_Search search(chip8.saveState());
+        search.setThreadCount(threads);
+        search.setMaxDepth(10);
+
+        const CHIP8_SearchResult result = search.run([](const CHIP8_State& state){
+            return state.V[2] == 1;
+        });
+
+        ASSERT_TRUE(result.found);
+        ASSERT_EQ(result.inputs, std::vector<uint16_t>({ 1 << 0x5, 1 << 0x7 }));
+        ASSERT_EQ(result.state.PC, 0x20e);
+        ASSERT_GT(result.duplicateStates, 0);
+    }
+
+    //without a goal the search stops once every reachable state was visited
+    CHIP8_Search search(chip8.saveState());
+    search.setThreadCount(2);
+    const CHIP8_SearchResult result = search.run(CHIP8_Search::Goal());
+    ASSERT_FALSE(result.found);
+    ASSERT_EQ(result.statesVisited, result.statesExpanded);
+}
+
+TEST(chip_test, bisect_finds_first_divergent_instruction)
+{
+    //waits for key 5, counts V1 to 0x64, then draws a random number
+    const std::vector<uint8_t> rom = {
+        0x60, 0x05, 0xe0, 0x9e,
+        0x12, 0x02, 0x71, 0x01,
+        0x31, 0x64, 0x12, 0x06,
+        0xc2, 0xff, 0x12, 0x0e
+    };
+
+    // same RNG state, different numbers
+    class SkewedRNG : public CHIP8_XorShiftRNG
+    {
+    public:
+        uint8_t nextByte() override
+        {
+            return CHIP8_XorShiftRNG::nextByte() ^ 1;
+        }
+    } skewed;
+
+    CHIP8_InputLog inputs;
+    inputs.hold(50, 1 << 5);
+    ASSERT_EQ(inputs.getKeyMask(49), 0);
+    ASSERT_EQ(inputs.getKeyMask(1000), 1 << 5);
+
+    const std::string path = ::testing::TempDir() + "chip8_bisect_inputs.txt";
+    ASSERT_TRUE(inputs.save(path));
+    CHIP8_InputLog loaded;
+    ASSERT_TRUE(loaded.load(path));
+    std::remove(path.c_str());
+    ASSERT_EQ(loaded.getChangeCount(), 1);
+    ASSERT_EQ(loaded.getKeyMask(50), 1 << 5);
+
+    CHIP8_Bisect bisect(rom, loaded);
+    bisect.setCheckpointFrames(16);
+    bisect.setConfigurations([](CHIP8& vm){ vm.setEngine(CHIP8_Engine::Interpreter); },
+        [](CHIP8& vm){ vm.setEngine(CHIP8_Engine::Fused); });
+    CHIP8_BisectResult result = bisect.run(1000);
+    ASSERT_FALSE(result.diverged);
+    ASSERT_EQ(result.frames, 1000);
+
+    // 400 instructions wait for the key, 301 more reach CXNN, the 702nd instruction
+    bisect.setConfigurations(CHIP8_Bisect::Configuration(), [&skewed](CHIP8& vm){ vm.setRNG(&skewed); });
+    result = bisect.run(1000);
+    ASSERT_TRUE(result.diverged);
+    ASSERT_EQ(result.frames, 88);
+    ASSERT_EQ(result.instruction, 6);
+    ASSERT_EQ(result.before.PC, 0x20c);
+    ASSERT_EQ(result.before.cycleCount, 701);
+    ASSERT_EQ(result.first.V[2] ^ result.second.V[2], 1);
+    ASSERT_NE(result.report.find("RND V2, 0xFF"), std::string::npos);
+    ASSERT_NE(result.report.find("\nV2 "), std::string::npos);
+
+    // without the key nothing is drawn
+    CHIP8_Bisect idle(rom, CHIP8_InputLog());
+    idle.setConfigurations(CHIP8_Bisect::Configuration(), [&skewed](CHIP8& vm){ vm.setRNG(&skewed); });
+    ASSERT_FALSE(idle.run(1000).diverged);
+}
+
+TEST(chip_test, debugger_breakpoints_and_watchpoints)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    CHIP8_Debugger debugger(t);
+
+    uint8_t instr[] = { 0x60, 0x05, // V[0x0] = 0x05
+                        0xa3, 0x00, // I = 0x300
+                        0x70, 0x01, // V[0x0] += 0x01
+                        0x30, 0x08, // skip if V[0x0] == 0x08
+                        0x12, 0x04, // jump to 0x204
+                        0xf0, 0x55, // store V[0x0] at I
+                        0x12, 0x0c  // jump to 0x20C
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    debugger.addBreakpoint(0x204);
+    ASSERT_EQ(debugger.continueExecution(100), CHIP8_StopReason::Breakpoint);
+    ASSERT_EQ(t.getPC(), 0x204);
+    ASSERT_EQ(t.getCycleCount(), 2);
+
+    // continuing steps over the breakpoint it stopped at
+    ASSERT_EQ(debugger.continueExecution(100), CHIP8_StopReason::Breakpoint);
+    ASSERT_EQ(t.getV()[0x0], 0x6);
+
+    debugger.removeBreakpoint(0x204);
+    debugger.addRegisterCondition(0x0, CHIP8_RegisterCondition::Equals, 0x08);
+    ASSERT_EQ(debugger.continueExecution(100), CHIP8_StopReason::RegisterCondition);
+    ASSERT_EQ(debugger.getLastStop().PC, 0x204);
+    ASSERT_EQ(t.getV()[0x0], 0x8);
+
+    // the watchpoint stops before FX55 writes
+    debugger.clearRegisterConditions();
+    debugger.addWatchpoint(0x300, 0x301, CHIP8_WatchKind::Write);
+    ASSERT_EQ(debugger.continueExecution(100), CHIP8_StopReason::WriteWatchpoint);
+    ASSERT_EQ(debugger.getLastStop().address, 0x300);
+    ASSERT_EQ(t.getPC(), 0x20a);
+    ASSERT_EQ(t.getRAM()[0x300], 0x0);
+
+    debugger.clearAll();
+    ASSERT_FALSE(debugger.isArmed());
+    const uint64_t cycles = t.getCycleCount();
+    ASSERT_EQ(debugger.continueExecution(10), CHIP8_StopReason::None);
+    ASSERT_EQ(t.getCycleCount(), cycles + 10);
+    ASSERT_EQ(t.getRAM()[0x300], 0x8);
+
+    ASSERT_EQ(debugger.stepInstruction(), CHIP8_StopReason::Step);
+    ASSERT_EQ(t.getCycleCount(), cycles + 11);
+
+    const CHIP8_MemoryAccess draw = CHIP8_Debugger::decodeMemoryAccess(0xd125, 0x300);
+    ASSERT_EQ(draw.start, 0x300);
+    ASSERT_EQ(draw.end, 0x305);
+    ASSERT_FALSE(draw.write);
+}
+
+TEST(chip_test, debugger_stops_at_a_breakpoint_on_the_current_instruction)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    CHIP8_Debugger debugger(t);
+
+    uint8_t instr[] = { 0x60, 0x05, // V[0x0] = 0x05
+                        0x70, 0x01, // V[0x0] += 0x01
+                        0x12, 0x02  // jump to 0x202
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    // the entry instruction stops the first continue
+    debugger.addBreakpoint(0x200);
+    ASSERT_EQ(debugger.continueExecution(100), CHIP8_StopReason::Breakpoint);
+    ASSERT_EQ(t.getCycleCount(), 0);
+
+    // and so does one at the PC a step stopped at
+    debugger.addBreakpoint(0x202);
+    ASSERT_EQ(debugger.stepInstruction(), CHIP8_StopReason::Step);
+    ASSERT_EQ(debugger.continueExecution(100), CHIP8_StopReason::Breakpoint);
+    ASSERT_EQ(t.getCycleCount(), 1);
+
+    ASSERT_EQ(debugger.continueExecution(100), CHIP8_StopReason::Breakpoint);
+    ASSERT_EQ(t.getCycleCount(), 3);
+    ASSERT_EQ(t.getV()[0x0], 0x6);
+}
+
+TEST(chip_test, debugger_checks_watchpoints_when_resuming)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    CHIP8_Debugger debugger(t);
+
+    uint8_t instr[] = { 0xa3, 0x00, // I = 0x300
+                        0xf0, 0x55, // store V[0x0] at I
+                        0x70, 0x01, // V[0x0] += 0x01
+                        0x12, 0x02  // jump to 0x202
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+    debugger.addWatchpoint(0x300, 0x301, CHIP8_WatchKind::Write);
+
+    // stepping reports the hit, the next step lets the store through
+    ASSERT_EQ(debugger.stepInstruction(), CHIP8_StopReason::Step);
+    ASSERT_EQ(debugger.stepInstruction(), CHIP8_StopReason::WriteWatchpoint);
+    ASSERT_EQ(t.getCycleCount(), 1);
+    ASSERT_EQ(debugger.stepInstruction(), CHIP8_StopReason::Step);
+    ASSERT_EQ(t.getCycleCount(), 2);
+
+    ASSERT_EQ(debugger.stepInstruction(), CHIP8_StopReason::Step);
+    ASSERT_EQ(debugger.stepInstruction(), CHIP8_StopReason::Step);
+    ASSERT_EQ(t.getPC(), 0x202);
+
+    // continuing after a step still checks the instruction it starts at
+    ASSERT_EQ(debugger.continueExecution(100), CHIP8_StopReason::WriteWatchpoint);
+    ASSERT_EQ(t.getCycleCount(), 4);
+
+    ASSERT_EQ(debugger.continueExecution(100), CHIP8_StopReason::WriteWatchpoint);
+    ASSERT_EQ(t.getCycleCount(), 7);
+    ASSERT_EQ(t.getRAM()[0x300], 0x1);
+}
+
+TEST(chip_test, metrics_count_instructions_and_frames)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    t.setInstructionsPerFrame(4);
+
+    uint8_t instr[] = { 0xd0, 0x15, // draw the font sprite at I = 0x000
+                        0x70, 0x01, // V[0x0] += 0x01
+                        0x12, 0x00  // jump to 0x200
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    for(int frame = 0; frame < 4; frame++)
+        ASSERT_EQ(t.runFrame(), CHIP8_YieldReason::FrameEnd);
+    t.runCycles(3);
+
+    const CHIP8_Metrics& metrics = m.getMetrics();
+    ASSERT_EQ(metrics.get(CHIP8_Metric::InstructionsExecuted), 19);
+    ASSERT_EQ(metrics.get(CHIP8_Metric::TimerTicks), 4);
+
+    // nobody takes the frames, so every one after the first replaces an unread frame
+    const uint64_t published = metrics.get(CHIP8_Metric::FramesPublished);
+    ASSERT_GT(published, 1);
+    ASSERT_EQ(metrics.get(CHIP8_Metric::FramesDropped), published - 1);
+
+    const std::string text = metrics.toPrometheus();
+    ASSERT_NE(text.find("# TYPE chip8_instructions_total counter\nchip8_instructions_total 19\n"), std::string::npos);
+    ASSERT_NE(text.find("chip8_timer_ticks_total 4\n"), std::string::npos);
+
+    const std::string path = ::testing::TempDir() + "chip8_metrics.prom";
+    {
+        CHIP8_MetricsExporter exporter(metrics, path, CHIP8_MetricsTarget::File, 10);
+        ASSERT_TRUE(exporter.isOpen());
+    }
+
+    std::ifstream file(path);
+    const std::string exported((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(exported, text);
+    std::remove(path.c_str());
+}
+
+TEST(chip_test, wait_for_frame_buffer)
+{
+    CHIP8_Mediator m;
+    const CHIP8_FrameBuffer frame(CHIP8_CONSTANTS::frameHeight, 1);
+
+    // nothing published, the wait ends at the deadline
+    ASSERT_FALSE(m.waitForFrameBuffer(std::chrono::steady_clock::now() + std::chrono::milliseconds(1)));
+
+    std::thread publisher([&m, &frame](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        m.updateFrameBuffer(frame);
+    });
+    ASSERT_TRUE(m.waitForFrameBuffer(std::chrono::steady_clock::now() + std::chrono::seconds(10)));
+    publisher.join();
+
+    // an untaken frame ends the wait at once
+    ASSERT_TRUE(m.waitForFrameBuffer(std::chrono::steady_clock::now()));
+    ASSERT_EQ(m.getNewFrameBuffer(), frame);
+    ASSERT_FALSE(m.waitForFrameBuffer(std::chrono::steady_clock::now()));
+}
+
+TEST(chip_test, latency_stages_and_percentiles)
+{
+    CHIP8_LatencyHistogram histogram;
+    for(uint64_t microseconds = 1; microseconds <= 1000; microseconds++)
+        histogram.record(microseconds * 100);
+
+    // buckets are at most 12.5% wide
+    ASSERT_GE(histogram.getPercentile(0.5), 50000);
+    ASSERT_LE(histogram.getPercentile(0.5), 50000 * 9 / 8);
+    ASSERT_GE(histogram.getPercentile(0.99), 99000);
+    ASSERT_LE(histogram.getPercentile(0.99), 100000);
+    ASSERT_EQ(histogram.getMaximum(), 100000);
+    ASSERT_EQ(CHIP8_LatencyHistogram::getBucket(CHIP8_LatencyHistogram::getBucketLimit(100)), 100);
+    ASSERT_EQ(CHIP8_LatencyHistogram::getBucket(CHIP8_LatencyHistogram::getBucketLimit(100) + 1), 101);
+
+    CHIP8_Mediator m;
+    CHIP8_LatencyTracker& latency = m.getLatency();
+    std::vector<bool> keys(CHIP8_CONSTANTS::keyArraySize, false);
+    keys[0x5] = true;
+
+    // stages out of order are ignored
+    latency.framePresented();
+    m.updateFrameBuffer(CHIP8_FrameBuffer(CHIP8_CONSTANTS::frameHeight, 0));
+    ASSERT_EQ(latency.getSampleCount(), 0);
+
+    m.updateKeyArray(keys, CHIP8_LatencyTracker::Clock::now() - std::chrono::milliseconds(5));
+    m.getNewFrameBuffer();
+    latency.framePresented();
+    ASSERT_TRUE(m.isKeyPressed(0x5));
+    m.updateKeyArray(keys, CHIP8_LatencyTracker::Clock::now()); // not sampled, one input is followed at a time
+    m.updateFrameBuffer(CHIP8_FrameBuffer(CHIP8_CONSTANTS::frameHeight, 0));
+    m.getNewFrameBuffer();
+    latency.framePresented();
+
+    ASSERT_EQ(latency.getSampleCount(), 1);
+    ASSERT_GE(latency.getHistogram(CHIP8_LatencyStage::Total).getMaximum(), 5000);
+    ASSERT_GE(latency.getHistogram(CHIP8_LatencyStage::Mediator).getMaximum(), 5000);
+    ASSERT_NE(latency.report().find("1 SAMPLES"), std::string::npos);
+}
+
+TEST(chip_test, frame_blender_fades_dark_pixels)
+{
+    CHIP8_FrameBlender blender(66, 253, 110);
+    blender.setKernel(CHIP8_BlendKernel::Scalar);
+    CHIP8_FrameBuffer frame(CHIP8_CONSTANTS::frameHeight, 0);
+    frame[3] = 1ull << 63; // x = 0, y = 3
+    std::vector<uint8_t> rgba(CHIP8_FrameBlender::pixelCount * 4);
+    const uint8_t* pixel = &rgba[3 * CHIP8_FrameBlender::rowBytes];
+
+    ASSERT_FALSE(blender.blend(frame, rgba.data()));
+    ASSERT_EQ(pixel[0], 66);
+    ASSERT_EQ(pixel[1], 253);
+    ASSERT_EQ(pixel[2], 110);
+    ASSERT_EQ(pixel[3], 0xff);
+    ASSERT_EQ(pixel[5], 0);
+
+    // erased, the pixel halves its brightness every blend until it is gone
+    frame[3] = 0;
+    ASSERT_TRUE(blender.blend(frame, rgba.data()));
+    ASSERT_EQ(pixel[1], 253 * 128 / 256);
+    int blends = 1;
+    while(blender.blend(frame, rgba.data()))
+        blends++;
+    ASSERT_EQ(blends, 7); // 127, 63, 31, 15, 7, 3, 1
+    ASSERT_EQ(pixel[1], 0);
+
+    // every kernel the CPU has matches the scalar one, into a wider atlas as well
+    const std::size_t stride = CHIP8_FrameBlender::rowBytes + 12;
+    std::vector<uint8_t> expected(stride * CHIP8_CONSTANTS::frameHeight, 0xaa);
+    CHIP8_XorShiftRNG rng(7);
+    for(CHIP8_BlendKernel kernel : {CHIP8_BlendKernel::SSE2, CHIP8_BlendKernel::AVX2})
+    {
+        CHIP8_FrameBlender scalar(66, 253, 110, 200);
+        scalar.setKernel(CHIP8_BlendKernel::Scalar);
+        CHIP8_FrameBlender simd(66, 253, 110, 200);
+        if(simd.setKernel(kernel) == false)
+            continue;
+
+        std::vector<uint8_t> actual(expected);
+        for(int i = 0; i < 20; i++)
+        {
+            for(uint64_t& row : frame)
+                for(int byte = 0; byte < 8; byte++)
+                    row = (row << 8) | rng.nextByte();
+            ASSERT_EQ(scalar.blend(frame, expected.data(), stride), simd.blend(frame, actual.data(), stride));
+            ASSERT_EQ(actual, expected);
+        }
+    }
+}
+
+#ifndef _WIN32
+TEST(chip_test, state_store_deduplicates_and_reopens)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    t.seedRNG(7);
+
+    uint8_t instr[] = { 0xc0, 0x03, // V[0x0] = random & 0x03
+                        0xa0, 0x00, // I = 0x000
+                        0xd0, 0x05, // draw the font sprite at V[0x0], V[0x0]
+                        0x12, 0x00  // jump to 0x200
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    const std::string path = ::testing::TempDir() + "chip8_state_store";
+    std::vector<CHIP8_State> states;
+    {
+        CHIP8_StateStore store;
+        ASSERT_TRUE(store.create(path, t.saveState()));
+
+        // far more checkpoints than the initial index holds, so it has to grow
+        for(uint64_t frame = 0; frame < 2000; frame++)
+        {
+            t.runCycles(4);
+            states.push_back(t.saveState());
+            ASSERT_TRUE(store.put(1, frame, states.back()));
+        }
+
+        // the same state under another run is stored once
+        ASSERT_TRUE(store.put(2, 0, states[10]));
+        ASSERT_EQ(store.getCheckpointCount(), 2001);
+        ASSERT_EQ(store.getStateCount(), 2000);
+    }
+
+    CHIP8_StateStore store;
+    ASSERT_TRUE(store.open(path));
+    ASSERT_EQ(store.getCheckpointCount(), 2001);
+
+    // only the bytes that differ from the base are stored
+    ASSERT_LT(store.getDataSize(), states.size() * CHIP8_State::serializedSize / 20);
+
+    CHIP8_State state;
+    for(uint64_t frame = 0; frame < states.size(); frame += 97)
+    {
+        ASSERT_TRUE(store.get(1, frame, state));
+        ASSERT_EQ(state, states[frame]);
+    }
+    ASSERT_TRUE(store.get(2, 0, state));
+    ASSERT_EQ(state, states[10]);
+    ASSERT_FALSE(store.get(3, 0, state));
+
+    // a record that doesn't match its hash, like one lost in a crash, is missing until stored again
+    {
+        std::fstream data(path + ".dat", std::ios::in | std::ios::out | std::ios::binary);
+        data.seekg(-1, std::ios::end);
+        const char last = (char)data.get();
+        data.seekp(-1, std::ios::end);
+        data.put(~last);
+    }
+    ASSERT_FALSE(store.get(1, states.size() - 1, state));
+    ASSERT_TRUE(store.put(3, 0, states.back()));
+    ASSERT_EQ(store.getStateCount(), 2000);
+    ASSERT_TRUE(store.get(1, states.size() - 1, state));
+    ASSERT_EQ(state, states.back());
+
+    store.close();
+    std::remove((path + ".dat").c_str());
+    std::remove((path + ".idx").c_str());
+}
+
+TEST(chip_test, shared_memory_frames_and_keys)
+{
+    CHIP8_Mediator m;
+    CHIP8_test t(m);
+    t.setDisplayWait(true);
+
+    uint8_t instr[] = { 0xd0, 0x15, // draw the font sprite at I = 0x000
+                        0x70, 0x08, // V[0x0] += 0x08
+                        0x12, 0x00  // jump to 0x200
+                      };
+
+    t.getRAM().write(t.getPC(), instr, sizeof(instr));
+
+    const std::string name = "/chip8_test_" + std::to_string(getpid());
+    CHIP8_SharedMemoryServer server(m, name);
+    ASSERT_TRUE(server.isOpen());
+
+    // two viewers map the same frame
+    CHIP8_SharedMemoryViewer viewer(name);
+    CHIP8_SharedMemoryViewer secondViewer(name);
+    ASSERT_TRUE(viewer.isOpen());
+    ASSERT_EQ(viewer.getFrameSequence(), 0);
+
+    for(int frame = 0; frame < 3; frame++)
+        ASSERT_EQ(t.runFrame(), CHIP8_YieldReason::FrameEnd);
+
+    CHIP8_FrameBuffer frameBuffer;
+    uint64_t frameSequence;
+    ASSERT_TRUE(viewer.readFrame(frameBuffer, frameSequence));
+    ASSERT_EQ(frameSequence, 3);
+    ASSERT_EQ(frameBuffer, t.getFrameBuffer());
+    ASSERT_TRUE(secondViewer.readFrame(frameBuffer, frameSequence));
+    ASSERT_EQ(frameSequence, 3);
+
+    // the server forwards the key mask to the mediator
+    secondViewer.setKeyMask(1 << 0xa);
+    for(int wait = 0; wait < 1000 && m.isKeyPressed(0xa) == false; wait++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_TRUE(m.isKeyPressed(0xa));
+    ASSERT_FALSE(m.isKeyPressed(0x0));
+}
+
+#endif
+
+TEST(analyzer_test, control_flow_graph)
+{
+    uint8_t rom[] = { 0x12, 0x04, // 200: jump over the data
+                      0xf0, 0x90, // 202: sprite data
+                      0x22, 0x0e, // 204: call 0x20e
+                      0x30, 0x01, // 206: skip if V[0x0] == 0x01
+                      0x12, 0x06, // 208: jump back to 0x206
+                      0xb2, 0x00, // 20a: jump to 0x200 + V[0x0]
+                      0x00, 0x00, // 20c: padding
+                      0xa2, 0x04, // 20e: I = 0x204
+                      0xf0, 0x33, // 210: store BCD of V[0x0] over the call
+                      0x00, 0xee  // 212: return
+                    };
+
+    CHIP8_Analyzer analyzer(rom, sizeof(rom));
+    const CHIP8_Analysis analysis = analyzer.analyze();
+
+    ASSERT_EQ(analysis.blocks.size(), 6);
+    ASSERT_EQ(analysis.findBlock(0x204)->terminator, CHIP8_BlockTerminator::Call);
+    ASSERT_EQ(analysis.findBlock(0x204)->successors, std::vector<uint16_t>({ 0x20e, 0x206 }));
+    ASSERT_EQ(analysis.findBlock(0x206)->successors, std::vector<uint16_t>({ 0x208, 0x20a }));
+    ASSERT_EQ(analysis.findBlock(0x212)->start, 0x20e);
+    ASSERT_EQ(analysis.findBlock(0x212)->terminator, CHIP8_BlockTerminator::Return);
+    ASSERT_EQ(analysis.findBlock(0x202), nullptr);
+
+    ASSERT_EQ(analysis.dataRegions.size(), 2);
+    ASSERT_EQ(analysis.dataRegions[0].start, 0x202);
+    ASSERT_EQ(analysis.dataRegions[0].end, 0x204);
+    ASSERT_EQ(analysis.dataRegions[1].start, 0x20c);
+
+    ASSERT_EQ(analysis.indirectJumps, std::vector<uint16_t>({ 0x20a }));
+
+    ASSERT_EQ(analysis.selfModifyingStores.size(), 1);
+    ASSERT_EQ(analysis.selfModifyingStores[0].address, 0x210);
+    ASSERT_EQ(analysis.selfModifyingStores[0].target.start, 0x204);
+}
+
+TEST(analyzer_test, disassemble)
+{
+    ASSERT_EQ(CHIP8_Analyzer::disassemble(0x00e0), "CLS");
+    ASSERT_EQ(CHIP8_Analyzer::disassemble(0x6a02), "LD VA, 0x2");
+    ASSERT_EQ(CHIP8_Analyzer::disassemble(0xdab6), "DRW VA, VB, 0x6");
+    ASSERT_EQ(CHIP8_Analyzer::disassemble(0x8ab7), "SUBN VA, VB");
+    ASSERT_EQ(CHIP8_Analyzer::disassemble(0xf565), "LD V5, [I]");
+    ASSERT_EQ(CHIP8_Analyzer::disassemble(0x8008 | 0x0f00), "DW 0x8F08");
+}
+TEST(libchip8_test, run_save_and_restore)
+{
+    //LD V0, 0x0A; LD F, V0; DRW V1, V1, 5; FX0A -> V2; 1NNN self loop
+    const uint8_t rom[] = { 0x60, 0x0a, 0xf0, 0x29, 0xd1, 0x15, 0xf2, 0x0a, 0x12, 0x08 };
+
+    chip8_vm* vm = chip8_create();
+    ASSERT_NE(vm, nullptr);
+    ASSERT_EQ(chip8_load(vm, rom, sizeof(rom)), CHIP8_OK);
+
+    const uint64_t* frameBuffer = chip8_framebuffer(vm);
+    ASSERT_EQ(chip8_step_frames(vm, 1), CHIP8_KEY_WAIT);
+    ASSERT_EQ(frameBuffer[0], 0xf0ull << 56); //top row of the glyph A
+    ASSERT_EQ(chip8_cycle_count(vm), 3);
+
+    std::vector<uint8_t> state(chip8_state_size());
+    ASSERT_EQ(chip8_save_state(vm, state.data(), state.size()), CHIP8_OK);
+
+    chip8_set_keys(vm, 1 << 0x7);
+    ASSERT_EQ(chip8_step_frames(vm, 2), CHIP8_OK);
+    ASSERT_EQ(chip8_cycle_count(vm), 2 * CHIP8::defaultInstructionsPerFrame); //the key wait resumes mid frame
+
+    ASSERT_EQ(chip8_load_state(vm, state.data(), state.size()), CHIP8_OK);
+    ASSERT_EQ(chip8_cycle_count(vm), 3);
+    ASSERT_EQ(chip8_framebuffer(vm), frameBuffer);
+
+    state[0] = 'X';
+    ASSERT_EQ(chip8_load_state(vm, state.data(), state.size()), CHIP8_ERROR);
+
+    const uint8_t invalid[] = { 0x85, 0x18 };
+    ASSERT_EQ(chip8_load(vm, invalid, sizeof(invalid)), CHIP8_OK);
+    ASSERT_EQ(chip8_framebuffer(vm)[0], 0);
+
+    uint64_t executed;
+    ASSERT_EQ(chip8_step_cycles(vm, 10, &executed), CHIP8_FAULT);
+    ASSERT_EQ(executed, 0);
+
+    chip8_fault fault;
+    ASSERT_EQ(chip8_get_fault(vm, &fault), CHIP8_FAULT);
+    ASSERT_EQ(fault.kind, (uint8_t)CHIP8_FaultKind::InvalidOpcode);
+    ASSERT_EQ(fault.pc, 0x200);
+
+    chip8_destroy(vm);
+}
+
+TEST(libchip8_test, capture_y4m)
+{
+    chip8_vm* vm = chip8_create();
+    ASSERT_NE(vm, nullptr);
+
+    const uint8_t rom[] = { 0xd0, 0x15, // draw the font sprite at I = 0x000
+                            0x70, 0x08, // V[0x0] += 0x08
+                            0x12, 0x00  // jump to 0x200
+                          };
+    ASSERT_EQ(chip8_load(vm, rom, sizeof(rom)), CHIP8_OK);
+
+    const std::string path = ::testing::TempDir() + "chip8_capture.y4m";
+    ASSERT_EQ(chip8_capture_start(vm, path.c_str(), CHIP8_CAPTURE_Y4M, 0), CHIP8_ERROR);
+    ASSERT_EQ(chip8_capture_start(vm, path.c_str(), CHIP8_CAPTURE_Y4M, 2), CHIP8_OK);
+    ASSERT_EQ(chip8_step_frames(vm, 5), CHIP8_OK);
+    chip8_capture_stop(vm);
+    chip8_destroy(vm);
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    const std::string video((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(path.c_str());
+
+    const std::string header = "YUV4MPEG2 W128 H64 F60:1 Ip A1:1 C420jpeg\n";
+    const std::size_t frameSize = std::string("FRAME\n").size() + 128 * 64 * 3 / 2;
+    ASSERT_EQ(video.compare(0, header.size(), header), 0);
+
+    // display wait is on, so each of the 5 frames is published once
+    ASSERT_EQ(video.size(), header.size() + 5 * frameSize);
+
+    // the first frame starts with a "0" sprite at 0,0, its top row is 0xF0: 4 lit pixels,
+    // each 2x2 in the video
+    const std::size_t luma = header.size() + std::string("FRAME\n").size();
+    ASSERT_EQ((uint8_t)video[luma + 7], (uint8_t)video[luma]);
+    ASSERT_NE((uint8_t)video[luma + 8], (uint8_t)video[luma]);
+    ASSERT_GT((uint8_t)video[luma], 0);
 }
-*/
\ No newline at end of file
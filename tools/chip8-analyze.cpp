@@ -0,0 +1,51 @@
+#include "../src/CHIP8_Analyzer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+
+int main(int argc, char **argv)
+{
+    const bool listing = argc == 3 && std::string(argv[1]) == "--listing";
+
+    if(argc != 2 && listing == false)
+    {
+        std::cout << "Usage: chip8-analyze [--listing] [FILE]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream romFile(argv[argc - 1], std::ios::in | std::ios::binary);
+    if(romFile.good() == false)
+    {
+        std::cout << "UNABLE TO OPEN A FILE!" << std::endl;
+        return 1;
+    }
+
+    const std::vector<uint8_t> rom((std::istreambuf_iterator<char>(romFile)), std::istreambuf_iterator<char>());
+
+    CHIP8_Analyzer analyzer(rom.data(), rom.size());
+    const CHIP8_Analysis analysis = analyzer.analyze();
+
+    if(listing == false)
+    {
+        std::cout << CHIP8_Analyzer::toJSON(analysis, analyzer);
+        return 0;
+    }
+
+    std::cout << std::hex << std::uppercase << std::setfill('0');
+
+    for(const CHIP8_BasicBlock& block : analysis.blocks)
+    {
+        std::cout << "\nblock_" << std::setw(3) << block.start << ":\n";
+        for(uint16_t address = block.start; address < block.end; address += 2)
+            std::cout << "    " << std::setw(3) << address << "  " << std::setw(4) << analyzer.fetch(address)
+                << "  " << CHIP8_Analyzer::disassemble(analyzer.fetch(address)) << "\n";
+        std::cout << "    ; " << CHIP8_Analyzer::getTerminatorName(block.terminator) << "\n";
+    }
+
+    for(const CHIP8_MemoryRange& range : analysis.dataRegions)
+        std::cout << "\ndata " << std::setw(3) << range.start << "-" << std::setw(3) << range.end - 1;
+    std::cout << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "../src/CHIP8_Bisect.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace
+{
+    // comma separated: interpreter|fused|tiered, display-wait, vip, ipf=N
+    bool parseConfiguration(const std::string& spec, CHIP8_Bisect::Configuration& configuration)
+    {
+        CHIP8_Engine engine = CHIP8_Engine::Interpreter;
+        CHIP8_Timing timing = CHIP8_Timing::Instructions;
+        bool displayWait = false;
+        int instructionsPerFrame = CHIP8::defaultInstructionsPerFrame;
+
+        std::istringstream words(spec);
+        std::string word;
+        while(std::getline(words, word, ','))
+        {
+            if(word == "interpreter")
+                engine = CHIP8_Engine::Interpreter;
+            else if(word == "fused")
+                engine = CHIP8_Engine::Fused;
+            else if(word == "tiered")
+                engine = CHIP8_Engine::Tiered;
+            else if(word == "display-wait")
+                displayWait = true;
+            else if(word == "vip")
+                timing = CHIP8_Timing::CosmacVIP;
+            else if(word.compare(0, 4, "ipf=") == 0 && word.size() > 4)
+                instructionsPerFrame = std::stoi(word.substr(4));
+            else
+                return false;
+        }
+
+        configuration = [=](CHIP8& vm){
+            vm.setEngine(engine);
+            vm.setTiming(timing);
+            vm.setDisplayWait(displayWait);
+            vm.setInstructionsPerFrame(instructionsPerFrame);
+        };
+        return true;
+    }
+
+    // no key or one key at random, held for period frames each
+    CHIP8_InputLog makeRandomInputs(uint64_t seed, uint64_t frames, uint64_t period)
+    {
+        CHIP8_XorShiftRNG rng(seed);
+        CHIP8_InputLog inputs;
+
+        for(uint64_t frame = 0; frame < frames; frame += period)
+        {
+            const uint8_t key = rng.nextByte() % (CHIP8_CONSTANTS::keyArraySize + 1);
+            inputs.hold(frame, key < CHIP8_CONSTANTS::keyArraySize ? 1 << key : 0);
+        }
+        return inputs;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string romPath;
+    std::string inputPath;
+    std::string firstSpec = "interpreter";
+    std::string secondSpec = "tiered";
+    uint64_t frames = 1000000;
+    uint64_t checkpointFrames = CHIP8_Bisect::defaultCheckpointFrames;
+    uint64_t randomKeyFrames = 0;
+    uint64_t seed = CHIP8_Bisect::defaultRNGSeed;
+    bool usage = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if(arg == "--frames" && i + 1 < argc)
+            frames = std::stoull(argv[++i]);
+        else if(arg == "--checkpoint" && i + 1 < argc)
+            checkpointFrames = std::stoull(argv[++i]);
+        else if(arg == "--inputs" && i + 1 < argc)
+            inputPath = argv[++i];
+        else if(arg == "--random-keys" && i + 1 < argc)
+            randomKeyFrames = std::stoull(argv[++i]);
+        else if(arg == "--seed" && i + 1 < argc)
+            seed = std::stoull(argv[++i]);
+        else if(arg == "--first" && i + 1 < argc)
+            firstSpec = argv[++i];
+        else if(arg == "--second" && i + 1 < argc)
+            secondSpec = argv[++i];
+        else if(romPath.empty())
+            romPath = arg;
+        else
+            usage = true;
+    }
+
+    CHIP8_Bisect::Configuration first, second;
+    if(usage || romPath.empty() || parseConfiguration(firstSpec, first) == false
+        || parseConfiguration(secondSpec, second) == false)
+    {
+        std::cout << "Usage: chip8-bisect [--first SPEC] [--second SPEC] [--frames N] [--checkpoint FRAMES] "
+            "[--inputs LOG | --random-keys FRAMES] [--seed N] FILE\n"
+            "SPEC is a comma separated list of interpreter|fused|tiered, display-wait, vip, ipf=N" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(romPath, std::ios::binary);
+    if(file.is_open() == false)
+    {
+        std::cout << "UNABLE TO OPEN A FILE!" << std::endl;
+        return 1;
+    }
+    const std::vector<uint8_t> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    CHIP8_InputLog inputs;
+    if(inputPath.empty() == false)
+    {
+        if(inputs.load(inputPath) == false)
+        {
+            std::cout << "UNABLE TO READ AN INPUT LOG!" << std::endl;
+            return 1;
+        }
+    }
+    else if(randomKeyFrames)
+        inputs = makeRandomInputs(seed, frames, randomKeyFrames);
+
+    CHIP8_Bisect bisect(image, inputs);
+    bisect.setConfigurations(first, second);
+    bisect.setCheckpointFrames(checkpointFrames);
+    bisect.setSeed(seed);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const CHIP8_BisectResult result = bisect.run(frames);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << result.report << "TOOK " << seconds << " S" << std::endl;
+    return result.diverged ? 2 : 0;
+}
@@ -0,0 +1,191 @@
+#include "../src/CHIP8_Debugger.hpp"
+#include "../src/CHIP8_Analyzer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    const uint64_t defaultContinueCycles = 10000000;
+
+    uint16_t parseHex(const std::string& text)
+    {
+        return (uint16_t)std::stoul(text, nullptr, 16);
+    }
+
+    uint16_t fetch(const CHIP8& vm, uint16_t address)
+    {
+        const CHIP8_Memory& RAM = vm.getMemory();
+        return (uint16_t(RAM.at(address & 0xfff)) << 8) | RAM.at((address + 1) & 0xfff);
+    }
+
+    void printInstruction(const CHIP8& vm, uint16_t address)
+    {
+        const uint16_t opcode = fetch(vm, address);
+        std::cout << std::setw(3) << address << "  " << std::setw(4) << opcode << "  "
+            << CHIP8_Analyzer::disassemble(opcode) << "\n";
+    }
+
+    void printStop(const CHIP8_Debugger& debugger, const CHIP8& vm)
+    {
+        const CHIP8_DebugStop& stop = debugger.getLastStop();
+        std::cout << CHIP8_Debugger::getStopReasonName(stop.reason) << " AT " << std::setw(3) << stop.PC;
+
+        if(stop.reason == CHIP8_StopReason::ReadWatchpoint || stop.reason == CHIP8_StopReason::WriteWatchpoint)
+            std::cout << " ADDRESS " << std::setw(3) << stop.address;
+        else if(stop.reason == CHIP8_StopReason::RegisterCondition)
+            std::cout << " V" << (int)stop.reg << "=" << std::setw(2) << (int)vm.getRegisters()[stop.reg];
+        else if(stop.reason == CHIP8_StopReason::Fault)
+            std::cout << " " << getFaultKindName(vm.getFault().kind);
+        std::cout << "\n";
+
+        printInstruction(vm, vm.getProgramCounter());
+    }
+
+    void printRegisters(const CHIP8& vm)
+    {
+        const std::vector<uint8_t>& V = vm.getRegisters();
+        for(std::size_t i = 0; i < V.size(); i++)
+            std::cout << "V" << i << "=" << std::setw(2) << (int)V[i] << (i % 8 == 7 ? "\n" : " ");
+        std::cout << "PC=" << std::setw(3) << vm.getProgramCounter() << " I=" << std::setw(3) << vm.getIndexRegister()
+            << " CYCLES=" << std::dec << vm.getCycleCount() << std::hex << "\n";
+    }
+
+    void printMemory(const CHIP8& vm, uint16_t start, uint16_t length)
+    {
+        const CHIP8_Memory& RAM = vm.getMemory();
+        for(uint16_t offset = 0; offset < length && start + offset < RAM.size(); offset++)
+        {
+            if(offset % 16 == 0)
+                std::cout << (offset ? "\n" : "") << std::setw(3) << start + offset << ":";
+            std::cout << " " << std::setw(2) << (int)RAM[start + offset];
+        }
+        std::cout << "\n";
+    }
+
+    void printScreen(const CHIP8& vm)
+    {
+        const CHIP8_FrameBuffer& frameBuffer = vm.getFrameBuffer();
+        for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+        {
+            for(int x = 0; x < CHIP8_CONSTANTS::frameWidth; x++)
+                std::cout << (getPixel(frameBuffer, x, y) ? '#' : '.');
+            std::cout << "\n";
+        }
+    }
+
+    void printHelp()
+    {
+        std::cout <<
+            "break ADDR            stop before the instruction at ADDR\n"
+            "delete ADDR           remove a breakpoint\n"
+            "watch ADDR [LEN] [r|w|rw]\n"
+            "                      stop before RAM in [ADDR, ADDR+LEN) is accessed\n"
+            "unwatch ADDR [LEN]    remove a watchpoint\n"
+            "cond X [NN]           stop when VX changes, or changes to NN\n"
+            "clear                 remove all breakpoints, watchpoints and conditions\n"
+            "step [N]              run N instructions\n"
+            "continue [N]          run until something fires, at most N instructions\n"
+            "keys MASK             set the pressed keys, bit N is key N\n"
+            "regs | mem ADDR [LEN] | dis [ADDR] [N] | screen | quit\n"
+            "numbers are hexadecimal\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if(argc != 2)
+    {
+        std::cout << "Usage: chip8-debug [FILE]" << std::endl;
+        return 1;
+    }
+
+    CHIP8_Mediator mediator;
+    CHIP8 vm(mediator);
+
+    if(vm.loadMemoryImage(argv[1]) == false)
+    {
+        std::cout << "UNABLE TO OPEN A FILE!" << std::endl;
+        return 1;
+    }
+
+    CHIP8_Debugger debugger(vm);
+
+    std::cout << std::hex << std::uppercase << std::setfill('0');
+    printInstruction(vm, vm.getProgramCounter());
+
+    std::string line;
+    while(std::cout << "> " << std::flush && std::getline(std::cin, line))
+    {
+        std::istringstream args(line);
+        std::string command, first, second, third;
+        args >> command >> first >> second >> third;
+
+        try
+        {
+            if(command == "break" || command == "b")
+                debugger.addBreakpoint(parseHex(first));
+            else if(command == "delete" || command == "d")
+                debugger.removeBreakpoint(parseHex(first));
+            else if(command == "watch" || command == "w")
+            {
+                const uint16_t start = parseHex(first);
+                const uint16_t length = second.empty() ? 1 : parseHex(second);
+                const CHIP8_WatchKind kind = third == "r" ? CHIP8_WatchKind::Read :
+                    third == "w" ? CHIP8_WatchKind::Write : CHIP8_WatchKind::ReadWrite;
+                debugger.addWatchpoint(start, start + length, kind);
+            }
+            else if(command == "unwatch")
+            {
+                const uint16_t start = parseHex(first);
+                debugger.removeWatchpoint(start, start + (second.empty() ? 1 : parseHex(second)));
+            }
+            else if(command == "cond")
+            {
+                if(second.empty())
+                    debugger.addRegisterCondition(parseHex(first), CHIP8_RegisterCondition::Changed);
+                else
+                    debugger.addRegisterCondition(parseHex(first), CHIP8_RegisterCondition::Equals, parseHex(second));
+            }
+            else if(command == "clear")
+                debugger.clearAll();
+            else if(command == "step" || command == "s")
+            {
+                uint16_t count = first.empty() ? 1 : parseHex(first);
+                while(count-- > 0 && debugger.stepInstruction() == CHIP8_StopReason::Step);
+                printStop(debugger, vm);
+            }
+            else if(command == "continue" || command == "c")
+            {
+                debugger.continueExecution(first.empty() ? defaultContinueCycles : std::stoull(first, nullptr, 16));
+                printStop(debugger, vm);
+            }
+            else if(command == "keys")
+                mediator.updateKeyMask(parseHex(first));
+            else if(command == "regs" || command == "r")
+                printRegisters(vm);
+            else if(command == "mem" || command == "m")
+                printMemory(vm, parseHex(first), second.empty() ? 0x10 : parseHex(second));
+            else if(command == "dis")
+            {
+                const uint16_t start = first.empty() ? vm.getProgramCounter() : parseHex(first);
+                const uint16_t count = second.empty() ? 8 : parseHex(second);
+                for(uint16_t i = 0; i < count; i++)
+                    printInstruction(vm, (start + i * 2) & 0xfff);
+            }
+            else if(command == "screen")
+                printScreen(vm);
+            else if(command == "quit" || command == "q")
+                break;
+            else if(command.empty() == false)
+                printHelp();
+        }
+        catch(const std::exception&)
+        {
+            std::cout << "INVALID NUMBER\n";
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "../src/CHIP8.hpp"
+
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Headless input latency benchmark: the VM runs on its own thread exactly as under the GUI,
+// while this thread presses and releases keys and takes frames at the GUI redraw rate.
+namespace
+{
+    const int redrawMiliseconds = 10; // the GUI frame rate limit is 100
+
+    // mirrors the CHIP8_GUI::run() loop without a window
+    void redrawFor(CHIP8_Mediator& mediator, int miliseconds, bool frameReady)
+    {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::time_point end = Clock::now() + std::chrono::milliseconds(miliseconds);
+        const std::chrono::milliseconds tick(CHIP8_CONSTANTS::timersTickDurationInMiliseconds);
+        Clock::time_point lastPresent;
+
+        while(Clock::now() < end)
+        {
+            if(frameReady)
+            {
+                if(mediator.waitForFrameBuffer(Clock::now() + tick) == false)
+                    continue;
+                std::this_thread::sleep_until(lastPresent + tick);
+            }
+
+            if(mediator.hasFrameBufferChanged())
+                mediator.getNewFrameBuffer();
+            mediator.getLatency().framePresented();
+            lastPresent = Clock::now();
+
+            if(frameReady == false)
+                std::this_thread::sleep_for(std::chrono::milliseconds(redrawMiliseconds));
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string romPath;
+    uint16_t keyMask = 1 << 5;
+    int presses = 100;
+    int holdMiliseconds = 100;
+    bool frameReady = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if(arg == "--keys" && i + 1 < argc)
+            keyMask = (uint16_t)std::stoul(argv[++i], nullptr, 16);
+        else if(arg == "--presses" && i + 1 < argc)
+            presses = std::stoi(argv[++i]);
+        else if(arg == "--hold" && i + 1 < argc)
+            holdMiliseconds = std::stoi(argv[++i]);
+        else if(arg == "--pacing" && i + 1 < argc)
+            frameReady = std::string(argv[++i]) == "frame";
+        else if(romPath.empty())
+            romPath = arg;
+    }
+
+    if(romPath.empty())
+    {
+        std::cout << "Usage: chip8-latency [--keys HEX_MASK] [--presses N] [--hold MS] [--pacing fixed|frame] FILE" << std::endl;
+        return 1;
+    }
+
+    CHIP8_Mediator mediator;
+    CHIP8 chip8VM(mediator);
+    if(chip8VM.loadMemoryImage(romPath) == false)
+    {
+        std::cout << "UNABLE TO OPEN A FILE!" << std::endl;
+        return 1;
+    }
+
+    std::thread chip8Thread([&chip8VM](){
+        chip8VM.run();
+    });
+
+    //a press and a release are one sample each, as long as the ROM redraws after reading them
+    for(int press = 0; press < presses && mediator.shouldCHIP8Stop() == false; press++)
+    {
+        mediator.updateKeyMask(keyMask);
+        redrawFor(mediator, holdMiliseconds, frameReady);
+        mediator.updateKeyMask(0);
+        redrawFor(mediator, holdMiliseconds, frameReady);
+    }
+
+    mediator.stopCHIP8();
+    chip8Thread.join();
+
+    std::cout << mediator.getLatency().report() << std::flush;
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "../src/CHIP8_SharedMemory.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+namespace
+{
+    void printFrame(const CHIP8_FrameBuffer& frameBuffer, uint64_t frameSequence)
+    {
+        std::cout << "FRAME " << std::dec << frameSequence << "\n";
+        for(int y = 0; y < CHIP8_CONSTANTS::frameHeight; y++)
+        {
+            for(int x = 0; x < CHIP8_CONSTANTS::frameWidth; x++)
+                std::cout << (getPixel(frameBuffer, x, y) ? '#' : '.');
+            std::cout << "\n";
+        }
+        std::cout << std::flush;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string name;
+    std::string keys;
+    bool follow = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if(arg == "--keys" && i + 1 < argc)
+            keys = argv[++i];
+        else if(arg == "--follow")
+            follow = true;
+        else if(name.empty())
+            name = arg;
+    }
+
+    if(name.empty())
+    {
+        std::cout << "Usage: chip8-shm-view [--keys HEX_MASK] [--follow] NAME" << std::endl;
+        return 1;
+    }
+
+    CHIP8_SharedMemoryViewer viewer(name);
+    if(viewer.isOpen() == false)
+    {
+        std::cout << "UNABLE TO OPEN SHARED MEMORY!" << std::endl;
+        return 1;
+    }
+
+    if(keys.empty() == false)
+        viewer.setKeyMask((uint16_t)std::stoul(keys, nullptr, 16));
+
+    CHIP8_FrameBuffer frameBuffer;
+    uint64_t frameSequence = 0;
+    uint64_t shownSequence = 0;
+
+    do
+    {
+        if(viewer.readFrame(frameBuffer, frameSequence) && (frameSequence != shownSequence || follow == false))
+        {
+            printFrame(frameBuffer, frameSequence);
+            shownSequence = frameSequence;
+        }
+
+        if(follow)
+            std::this_thread::sleep_for(std::chrono::milliseconds(CHIP8_CONSTANTS::timersTickDurationInMiliseconds));
+    } while(follow);
+
+    return 0;
+}
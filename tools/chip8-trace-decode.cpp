@@ -0,0 +1,48 @@
+#include "../src/CHIP8_Tracer.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+int main(int argc, char **argv)
+{
+    if(argc != 2)
+    {
+        std::cout << "Usage: chip8-trace-decode [TRACE_FILE]" << std::endl;
+        return 1;
+    }
+
+    CHIP8_TraceReader reader(argv[1]);
+    if(reader.isValid() == false)
+    {
+        std::cout << "UNABLE TO READ A TRACE FILE!" << std::endl;
+        return 1;
+    }
+
+    CHIP8_TraceRecord traceRecord;
+    uint64_t expectedCycle = 0;
+    bool first = true;
+
+    std::cout << std::hex << std::setfill('0');
+
+    while(reader.next(traceRecord))
+    {
+        if(first == false && traceRecord.cycle > expectedCycle)
+            std::cout << "-- " << std::dec << traceRecord.cycle - expectedCycle << std::hex << " records dropped --\n";
+
+        std::cout << std::dec << traceRecord.cycle << std::hex
+            << " PC=" << std::setw(3) << traceRecord.PC
+            << " OP=" << std::setw(4) << traceRecord.opcode
+            << " I=" << std::setw(3) << traceRecord.I;
+
+        for(int i = 0; i < 16; i++)
+            if(traceRecord.changedRegisters & (1 << i))
+                std::cout << " V" << std::uppercase << i << std::nouppercase << "=" << std::setw(2) << (int)traceRecord.V[i];
+
+        std::cout << '\n';
+
+        expectedCycle = traceRecord.cycle + 1;
+        first = false;
+    }
+
+    return 0;
+}